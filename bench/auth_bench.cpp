@@ -0,0 +1,160 @@
+// Drives RADIUS authentication through AAA and AuthClient at a fixed request rate and
+// reports the achieved rate with latency percentiles. The servers come from the
+// aaa_conf of the configuration, usually radius_responder on the same host; every
+// accepted session is stopped right away so accounting sees a Start and a Stop.
+//
+// Usage: auth_bench -c config.yaml [-r rate] [-t seconds] [--chap]
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include "runtime.hpp"
+#include "aaa.hpp"
+#include "session.hpp"
+#include "log.hpp"
+
+std::shared_ptr<PPPOERuntime> runtime;
+std::atomic_bool interrupted;
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr std::chrono::milliseconds tick { 1 };
+    // Longest a request may wait for AuthClient to answer or give up after the last one is sent
+    constexpr std::chrono::seconds drain { 30 };
+}
+
+static double percentile( const std::vector<bench_clock::duration> &sorted, double p ) {
+    if( sorted.empty() ) {
+        return 0.0;
+    }
+    auto idx = std::min( sorted.size() - 1, static_cast<size_t>( p * sorted.size() ) );
+    return std::chrono::duration<double,std::milli>( sorted[ idx ] ).count();
+}
+
+int main( int argc, char *argv[] ) {
+    std::string path_config { "config.yaml" };
+    uint32_t rate = 1000;
+    uint32_t seconds = 10;
+
+    boost::program_options::options_description desc { "RADIUS authentication benchmark" };
+    desc.add_options()
+    ( "config,c", boost::program_options::value( &path_config ), "Path to config with aaa_conf pointing to the servers" )
+    ( "rate,r", boost::program_options::value( &rate ), "Access-Requests per second to send" )
+    ( "time,t", boost::program_options::value( &seconds ), "Seconds to send for" )
+    ( "chap", "Send CHAP instead of PAP" )
+    ( "help,h", "Print this message" );
+
+    boost::program_options::variables_map vm;
+    try {
+        boost::program_options::store( boost::program_options::parse_command_line( argc, argv, desc ), vm );
+        boost::program_options::notify( vm );
+    } catch( std::exception &e ) {
+        std::cerr << "Error on parsing arguments: " << e.what() << std::endl;
+        return -1;
+    }
+    if( vm.count( "help" ) ) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+    bool chap = vm.count( "chap" ) > 0;
+
+    io_service io;
+    runtime = std::make_shared<PPPOERuntime>( path_config, io );
+    runtime->logger->setLevel( LOGL::ERROR );
+    if( std::find( runtime->conf.aaa_conf.method.begin(), runtime->conf.aaa_conf.method.end(), AAA_METHODS::RADIUS ) == runtime->conf.aaa_conf.method.end() ) {
+        std::cerr << "RADIUS is not in aaa_conf.method of " << path_config << std::endl;
+        return -1;
+    }
+    // AAA falls back to the next method on its own, RADIUS is the only one measured
+    runtime->conf.aaa_conf.method = { AAA_METHODS::RADIUS };
+
+    // Requests only need a PPPoE session for Calling-Station-Id and NAS-Port-Id
+    std::vector<uint8_t> raw( 64, 0 );
+    encapsulation_t encap { raw, 0, 0 };
+    encap.destination_mac = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    auto const &[ psid, alloc_err ] = runtime->allocateSession( encap );
+    if( !alloc_err.empty() ) {
+        std::cerr << "Cannot allocate PPPoE session: " << alloc_err << std::endl;
+        return -1;
+    }
+    auto session = runtime->findSession( psid )->second;
+
+    std::string challenge( 16, '\x5a' );
+    std::string response( 17, '\xa5' );
+
+    uint64_t sent = 0;
+    uint64_t ok = 0;
+    uint64_t failed = 0;
+    std::vector<bench_clock::duration> latencies;
+    latencies.reserve( static_cast<size_t>( rate ) * seconds );
+
+    auto issue = [ & ]() {
+        auto user = "bench" + std::to_string( sent++ );
+        auto started = bench_clock::now();
+        auto callback = [ &, started ]( uint32_t sid, std::string err ) {
+            latencies.push_back( bench_clock::now() - started );
+            if( !err.empty() ) {
+                failed++;
+                return;
+            }
+            ok++;
+            runtime->aaa->stopSession( sid );
+        };
+        if( chap ) {
+            runtime->aaa->startSessionCHAP( user, challenge, response, *session, callback );
+        } else {
+            runtime->aaa->startSession( user, "password", *session, callback );
+        }
+    };
+
+    // Requests due so far are sent every tick, the pace holds even when a tick is late
+    auto const duration = std::chrono::seconds( seconds );
+    auto const total = static_cast<uint64_t>( rate ) * seconds;
+    auto const begin = bench_clock::now();
+    boost::asio::steady_timer timer { io };
+    std::function<void( boost::system::error_code )> on_tick = [ & ]( boost::system::error_code ec ) {
+        if( ec ) {
+            return;
+        }
+        auto elapsed = std::min<bench_clock::duration>( bench_clock::now() - begin, duration );
+        auto due = static_cast<uint64_t>( rate * std::chrono::duration<double>( elapsed ).count() );
+        while( sent < due ) {
+            issue();
+        }
+        if( sent < total ) {
+            timer.expires_after( tick );
+            timer.async_wait( on_tick );
+        }
+    };
+    timer.expires_after( tick );
+    timer.async_wait( on_tick );
+
+    while( ok + failed < total && bench_clock::now() - begin < duration + drain ) {
+        if( io.run_one_for( tick ) == 0 ) {
+            io.restart();
+        }
+    }
+    auto spent = bench_clock::now() - begin;
+
+    std::sort( latencies.begin(), latencies.end() );
+    auto secs = std::chrono::duration<double>( spent ).count();
+    std::cout << "sent " << sent << " in " << seconds << " s at " << rate << " req/s target" << std::endl;
+    std::cout << "accepted " << ok << ", failed " << failed << ", unanswered " << sent - ok - failed << std::endl;
+    // Counted up to the last answer, retransmissions of lost requests stretch the run
+    std::cout << "achieved " << ok / secs << " req/s over " << secs << " s" << std::endl;
+    std::cout << "latency ms: p50 " << percentile( latencies, 0.50 ) << ", p90 " << percentile( latencies, 0.90 )
+        << ", p99 " << percentile( latencies, 0.99 ) << ", max " << percentile( latencies, 1.0 ) << std::endl;
+
+    timer.cancel();
+    runtime->cleanup();
+    runtime.reset();
+    return 0;
+}
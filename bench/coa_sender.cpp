@@ -0,0 +1,338 @@
+// Sends a burst of Disconnect-Requests or CoA-Requests (RFC 5176) to the CoA port of
+// pppcpd and reports how they were answered. Sessions are picked by Acct-Session-Id or
+// User-Name made of a prefix and a counter, or by Framed-IP-Address counting up; a CoA
+// carries the template and DNS servers to switch to. Up to window requests are
+// outstanding at once, an unanswered request is counted as a timeout and not resent.
+//
+// Usage: coa_sender -d dictionary [-d ...] [-S server] [-p port] [-s secret] [--disconnect]
+//        [--by session|user|ip] [--prefix text] [--first n] [--first-ip address] [-n count]
+//        [--template name] [--dns1 address] [--dns2 address] [-w window] [--timeout ms]
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include "runtime.hpp"
+#include "radius_dict.hpp"
+#include "radius_avp.hpp"
+#include "radius_packet.hpp"
+#include "request_response.hpp"
+#include "md5.hpp"
+
+// Linked in with the dictionary code, never set here
+std::shared_ptr<PPPOERuntime> runtime;
+std::atomic_bool interrupted;
+
+using bench_clock = std::chrono::steady_clock;
+
+enum class COA_TARGET {
+    SESSION,
+    USER,
+    IP
+};
+
+struct SenderConf {
+    std::string secret { "testing123" };
+    RADIUS_CODE code { RADIUS_CODE::COA_REQUEST };
+    COA_TARGET by { COA_TARGET::SESSION };
+    std::string prefix;
+    uint32_t first { 0 };
+    address_v4_t first_ip;
+    uint32_t count { 1 };
+    // Attributes to change, identification is filled per request
+    CoARequest change;
+    uint32_t window { 256 };
+    std::chrono::milliseconds timeout { 3000 };
+};
+
+struct SenderStats {
+    uint64_t sent { 0 };
+    uint64_t acks { 0 };
+    uint64_t naks { 0 };
+    uint64_t timeouts { 0 };
+    // Unknown identifier, wrong code or authenticator
+    uint64_t dropped { 0 };
+    std::map<uint32_t,uint64_t> error_causes;
+    std::vector<bench_clock::duration> latency;
+};
+
+class Sender {
+public:
+    Sender( boost::asio::io_context &i, const SenderConf &c, std::shared_ptr<const RadiusDict> d, boost::asio::ip::udp::endpoint s ):
+        conf( c ),
+        dict( std::move( d ) ),
+        server( std::move( s ) ),
+        socket( i, boost::asio::ip::udp::endpoint { boost::asio::ip::udp::v4(), 0 } ),
+        timer( i )
+    {
+        for( uint32_t id = 0; id < std::min<uint32_t>( conf.window, 256 ); id++ ) {
+            free_ids.push_back( id );
+        }
+    }
+
+    void start( std::function<void()> done ) {
+        on_done = std::move( done );
+        started = bench_clock::now();
+        fill();
+        receive();
+        arm_timer();
+    }
+
+    const SenderStats& stats() const {
+        return counters;
+    }
+
+    bench_clock::duration elapsed() const {
+        return finished - started;
+    }
+
+private:
+    struct Outstanding {
+        bench_clock::time_point sent;
+        authenticator_t auth;
+    };
+
+    CoARequest target( uint32_t n ) const {
+        CoARequest req = conf.change;
+        switch( conf.by ) {
+        case COA_TARGET::SESSION:
+            req.session_id = conf.prefix + std::to_string( conf.first + n );
+            break;
+        case COA_TARGET::USER:
+            req.username = conf.prefix + std::to_string( conf.first + n );
+            break;
+        case COA_TARGET::IP:
+            req.framed_ip = address_v4_t { conf.first_ip.to_uint() + n };
+            break;
+        }
+        return req;
+    }
+
+    void fill() {
+        while( next < conf.count && !free_ids.empty() ) {
+            auto id = free_ids.front();
+            free_ids.pop_front();
+            send( id, target( next++ ) );
+        }
+        if( next == conf.count && outstanding.empty() ) {
+            finished = bench_clock::now();
+            timer.cancel();
+            socket.cancel();
+            on_done();
+        }
+    }
+
+    void send( uint8_t id, const CoARequest &req ) {
+        std::array<uint8_t,RADIUS_MAX_PACKET> buf;
+        auto hdr = reinterpret_cast<RadiusPacket*>( buf.data() );
+        hdr->code = conf.code;
+        hdr->id = id;
+        // RFC 5176 3.5: hashed with the authenticator as zeroes, like an Accounting-Request
+        hdr->authenticator.fill( 0 );
+        AVPWriter avp { buf.data() + sizeof( RadiusPacket ), buf.size() - sizeof( RadiusPacket ) };
+        serialize( *dict, req, avp );
+        hdr->length = sizeof( RadiusPacket ) + avp.size();
+
+        auto pkt = reinterpret_cast<const char*>( buf.data() );
+        Md5Job job { { { pkt, sizeof( RadiusPacket ) + avp.size() }, conf.secret }, hdr->authenticator };
+        md5_batch( &job, 1 );
+
+        outstanding[ id ] = Outstanding { bench_clock::now(), hdr->authenticator };
+        counters.sent++;
+        boost::system::error_code ec;
+        socket.send_to( boost::asio::buffer( buf.data(), sizeof( RadiusPacket ) + avp.size() ), server, 0, ec );
+        if( ec ) {
+            std::cerr << "Cannot send to " << server << ": " << ec.message() << std::endl;
+        }
+    }
+
+    void receive() {
+        socket.async_receive( boost::asio::buffer( rx_buf ), std::bind( &Sender::on_rcv, this, std::placeholders::_1, std::placeholders::_2 ) );
+    }
+
+    void on_rcv( boost::system::error_code ec, size_t size ) {
+        if( ec ) {
+            if( ec != boost::asio::error::operation_aborted ) {
+                std::cerr << "Socket error: " << ec.message() << std::endl;
+                receive();
+            }
+            return;
+        }
+        auto pkt = reinterpret_cast<const RadiusPacket*>( rx_buf.data() );
+        auto it = outstanding.find( pkt->id );
+        if( size < sizeof( RadiusPacket ) || pkt->length.native() < sizeof( RadiusPacket ) || pkt->length.native() > size || it == outstanding.end() ) {
+            counters.dropped++;
+            receive();
+            return;
+        }
+        size_t len = pkt->length.native();
+        auto raw = reinterpret_cast<const char*>( rx_buf.data() );
+        authenticator_t digest;
+        Md5Job job { {
+            { raw, 4 },
+            { reinterpret_cast<const char*>( it->second.auth.data() ), it->second.auth.size() },
+            { raw + sizeof( RadiusPacket ), len - sizeof( RadiusPacket ) },
+            conf.secret
+        }, digest };
+        md5_batch( &job, 1 );
+        auto ack = conf.code == RADIUS_CODE::COA_REQUEST ? RADIUS_CODE::COA_ACK : RADIUS_CODE::DISCONNECT_ACK;
+        auto nak = conf.code == RADIUS_CODE::COA_REQUEST ? RADIUS_CODE::COA_NAK : RADIUS_CODE::DISCONNECT_NAK;
+        if( digest != pkt->authenticator || ( pkt->code != ack && pkt->code != nak ) ) {
+            counters.dropped++;
+            receive();
+            return;
+        }
+
+        counters.latency.push_back( bench_clock::now() - it->second.sent );
+        if( pkt->code == ack ) {
+            counters.acks++;
+        } else {
+            counters.naks++;
+            auto res = deserialize<CoAResponse>( *dict, AVPReader { rx_buf.data() + sizeof( RadiusPacket ), len - sizeof( RadiusPacket ) } );
+            counters.error_causes[ res.error_cause ]++;
+        }
+        outstanding.erase( it );
+        free_ids.push_back( pkt->id );
+        receive();
+        fill();
+    }
+
+    void arm_timer() {
+        timer.expires_after( std::chrono::milliseconds( 100 ) );
+        timer.async_wait( [ this ]( boost::system::error_code ec ) {
+            if( ec ) {
+                return;
+            }
+            auto now = bench_clock::now();
+            for( auto it = outstanding.begin(); it != outstanding.end(); ) {
+                if( now - it->second.sent < conf.timeout ) {
+                    it++;
+                    continue;
+                }
+                counters.timeouts++;
+                free_ids.push_back( it->first );
+                it = outstanding.erase( it );
+            }
+            arm_timer();
+            fill();
+        });
+    }
+
+    const SenderConf &conf;
+    std::shared_ptr<const RadiusDict> dict;
+    boost::asio::ip::udp::endpoint server;
+    boost::asio::ip::udp::socket socket;
+    boost::asio::steady_timer timer;
+    std::function<void()> on_done;
+
+    uint32_t next { 0 };
+    // Identifiers are reused in FIFO order, so a late answer is unlikely to match a new request
+    std::deque<uint8_t> free_ids;
+    std::map<uint8_t,Outstanding> outstanding;
+    std::array<uint8_t,RADIUS_MAX_PACKET> rx_buf;
+    SenderStats counters;
+    bench_clock::time_point started;
+    bench_clock::time_point finished;
+};
+
+static double percentile( const std::vector<bench_clock::duration> &sorted, double p ) {
+    if( sorted.empty() ) {
+        return 0.0;
+    }
+    auto idx = std::min( sorted.size() - 1, static_cast<size_t>( p * sorted.size() ) );
+    return std::chrono::duration<double,std::milli>( sorted[ idx ] ).count();
+}
+
+int main( int argc, char *argv[] ) {
+    std::vector<std::string> dictionaries;
+    std::string address { "127.0.0.1" };
+    uint16_t port = 3799;
+    std::string by { "session" };
+    std::string first_ip;
+    std::string dns1;
+    std::string dns2;
+    uint32_t timeout_ms = 3000;
+    SenderConf conf;
+
+    boost::program_options::options_description desc { "RADIUS Disconnect and CoA sender for benchmarks" };
+    desc.add_options()
+    ( "dictionary,d", boost::program_options::value( &dictionaries )->required(), "FreeRADIUS dictionary file, may be repeated" )
+    ( "server,S", boost::program_options::value( &address ), "Address of the CoA server" )
+    ( "port,p", boost::program_options::value( &port ), "CoA port" )
+    ( "secret,s", boost::program_options::value( &conf.secret ), "Shared secret" )
+    ( "disconnect", "Send Disconnect-Request instead of CoA-Request" )
+    ( "by", boost::program_options::value( &by ), "Identify sessions by session (Acct-Session-Id), user (User-Name) or ip (Framed-IP-Address)" )
+    ( "prefix", boost::program_options::value( &conf.prefix ), "Text before the counter of Acct-Session-Id or User-Name, session_ by default for session" )
+    ( "first", boost::program_options::value( &conf.first ), "First counter value" )
+    ( "first-ip", boost::program_options::value( &first_ip ), "Framed-IP-Address of the first request, the next ones count up" )
+    ( "count,n", boost::program_options::value( &conf.count ), "Requests to send" )
+    ( "template", boost::program_options::value( &conf.change.pppoe_template ), "Subscriber-Profile-Name of every CoA" )
+    ( "dns1", boost::program_options::value( &dns1 ), "Primary DNS of every CoA" )
+    ( "dns2", boost::program_options::value( &dns2 ), "Secondary DNS of every CoA" )
+    ( "window,w", boost::program_options::value( &conf.window ), "Requests outstanding at once, up to 256" )
+    ( "timeout", boost::program_options::value( &timeout_ms ), "Milliseconds to wait for an answer" )
+    ( "help,h", "Print this message" );
+
+    boost::program_options::variables_map vm;
+    try {
+        boost::program_options::store( boost::program_options::parse_command_line( argc, argv, desc ), vm );
+        if( vm.count( "help" ) ) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        boost::program_options::notify( vm );
+        if( by == "session" ) {
+            conf.by = COA_TARGET::SESSION;
+            if( !vm.count( "prefix" ) ) {
+                conf.prefix = "session_";
+            }
+        } else if( by == "user" ) {
+            conf.by = COA_TARGET::USER;
+        } else if( by == "ip" ) {
+            conf.by = COA_TARGET::IP;
+            conf.first_ip = address_v4_t::from_string( first_ip );
+        } else {
+            throw std::invalid_argument( "unknown --by " + by );
+        }
+        if( !dns1.empty() ) {
+            conf.change.dns1 = address_v4_t::from_string( dns1 );
+        }
+        if( !dns2.empty() ) {
+            conf.change.dns2 = address_v4_t::from_string( dns2 );
+        }
+    } catch( std::exception &e ) {
+        std::cerr << "Error on parsing arguments: " << e.what() << std::endl;
+        return -1;
+    }
+    if( vm.count( "disconnect" ) ) {
+        conf.code = RADIUS_CODE::DISCONNECT_REQUEST;
+        conf.change = {};
+    }
+    conf.window = std::clamp<uint32_t>( conf.window, 1, 256 );
+    conf.timeout = std::chrono::milliseconds( timeout_ms );
+
+    boost::asio::io_context io;
+    Sender sender { io, conf, RadiusDict::load( dictionaries, "" ), { address_v4_t::from_string( address ), port } };
+    sender.start( [ &io ]() { io.stop(); } );
+    io.run();
+
+    auto s = sender.stats();
+    std::sort( s.latency.begin(), s.latency.end() );
+    auto seconds = std::chrono::duration<double>( sender.elapsed() ).count();
+    std::cout << ( conf.code == RADIUS_CODE::COA_REQUEST ? "CoA" : "Disconnect" ) << ": sent " << s.sent << ", ack " << s.acks << ", nak " << s.naks
+        << ", timeout " << s.timeouts << ", dropped " << s.dropped << " in " << seconds << " s, " << ( seconds > 0 ? s.sent / seconds : 0.0 ) << " req/s" << std::endl;
+    for( auto const &[ cause, n ]: s.error_causes ) {
+        std::cout << "Error-Cause " << cause << ": " << n << std::endl;
+    }
+    std::cout << "Latency ms: p50 " << percentile( s.latency, 0.5 ) << ", p99 " << percentile( s.latency, 0.99 ) << ", max " << percentile( s.latency, 1.0 ) << std::endl;
+    return 0;
+}
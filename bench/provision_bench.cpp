@@ -0,0 +1,142 @@
+// Measures PPPoE sessions provisioned per second against a local VPP (or the
+// in-memory backend with simulated latency): one blocking round trip per call
+// versus the batched provisioning queue.
+//
+// Usage: provision_bench [-n sessions] [-b batch] [-w window_us] [-u unnumbered_iface] [--fake -l latency_us]
+
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include "config.hpp"
+#include "log.hpp"
+#include "dp_backend.hpp"
+#include "fake_backend.hpp"
+#include "provision_queue.hpp"
+#ifdef WITH_VPP
+#include "vpp.hpp"
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+static ProvisionRequest make_request( uint32_t i, const std::string &unnumbered ) {
+    ProvisionRequest req;
+    req.address = 0x64400000 + i + 1; // 100.64.0.0/10
+    req.session_id = static_cast<uint16_t>( i + 1 );
+    req.mac = { 0x02, 0x00, 0x00, static_cast<uint8_t>( i >> 16 ), static_cast<uint8_t>( i >> 8 ), static_cast<uint8_t>( i ) };
+    req.unnumbered = unnumbered;
+    return req;
+}
+
+static void report( const std::string &name, uint32_t count, bench_clock::duration d ) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>( d ).count();
+    std::cout << name << ": " << count << " sessions in " << us / 1000.0 << " ms, "
+        << ( us ? count * 1000000.0 / us : 0.0 ) << " sessions/s" << std::endl;
+}
+
+// run_one() stops the context once it runs out of work, restart it to pick up new requests
+static void run_until( boost::asio::io_context &io, std::function<bool()> done ) {
+    while( !done() ) {
+        if( io.run_one() == 0 ) {
+            io.restart();
+        }
+    }
+}
+
+int main( int argc, char *argv[] ) {
+    uint32_t count = 4000;
+    std::string unnumbered;
+    VPPConf conf;
+
+    boost::program_options::options_description desc { "Session provisioning benchmark" };
+    desc.add_options()
+    ( "sessions,n", boost::program_options::value( &count ), "Number of sessions" )
+    ( "batch,b", boost::program_options::value( &conf.provision_batch ), "Provisioning batch size" )
+    ( "window,w", boost::program_options::value( &conf.provision_window_us ), "Provisioning window in microseconds" )
+    ( "unnumbered,u", boost::program_options::value( &unnumbered ), "Interface to borrow address from" )
+    ( "fake", "Use in-memory data plane instead of VPP" )
+    ( "latency,l", boost::program_options::value( &conf.fake_latency_us ), "Simulated round trip of in-memory data plane in microseconds" )
+    ( "help,h", "Print this message" );
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store( boost::program_options::parse_command_line( argc, argv, desc ), vm );
+    boost::program_options::notify( vm );
+    if( vm.count( "help" ) ) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    boost::asio::io_context io;
+    auto logger = std::make_unique<Logger>();
+    logger->setLevel( LOGL::ERROR );
+    std::unique_ptr<DPBackend> backend;
+#ifdef WITH_VPP
+    if( !vm.count( "fake" ) ) {
+        backend = std::make_unique<VPPAPI>( io, logger );
+    }
+#endif
+    if( !backend ) {
+        InterfaceConf hw;
+        hw.device = "G0";
+        backend = std::make_unique<FakeBackend>( io, logger, conf, std::vector<InterfaceConf>{ hw } );
+        if( !unnumbered.empty() ) {
+            // In-memory data plane has only what we create, give it an interface to borrow address from
+            backend->add_subif( 1, 0, 0, 0 );
+            unnumbered = "G0.0";
+        }
+    }
+    auto &vpp = *backend;
+
+    // Serial: every request waits for its reply
+    auto start = bench_clock::now();
+    for( uint32_t i = 0; i < count; i++ ) {
+        auto req = make_request( i, unnumbered );
+        auto [ ret, ifi ] = vpp.add_pppoe_session( req.address, req.session_id, req.mac, req.vrf, true );
+        if( ret && !unnumbered.empty() ) {
+            if( auto [ uifi, found ] = vpp.get_iface_by_name( unnumbered ); found ) {
+                vpp.set_unnumbered( ifi, uifi );
+            }
+        }
+    }
+    report( "serial add", count, bench_clock::now() - start );
+
+    start = bench_clock::now();
+    for( uint32_t i = 0; i < count; i++ ) {
+        auto req = make_request( i, unnumbered );
+        vpp.add_pppoe_session( req.address, req.session_id, req.mac, req.vrf, false );
+    }
+    report( "serial del", count, bench_clock::now() - start );
+
+    // Batched: requests are pipelined, completions come back on the loop
+    ProvisionQueue queue { io, vpp, logger, conf };
+    uint32_t done = 0;
+    uint32_t failed = 0;
+
+    start = bench_clock::now();
+    for( uint32_t i = 0; i < count; i++ ) {
+        queue.add( make_request( i, unnumbered ), [ &done, &failed ]( const std::string &err, const DPBindings& ) {
+            done++;
+            if( !err.empty() ) {
+                failed++;
+            }
+        });
+    }
+    run_until( io, [ &done, count ]() { return done >= count; } );
+    report( "batched add", count, bench_clock::now() - start );
+
+    start = bench_clock::now();
+    for( uint32_t i = 0; i < count; i++ ) {
+        queue.del( make_request( i, unnumbered ) );
+    }
+    queue.flush();
+    run_until( io, [ &vpp ]() { return vpp.inflight_requests() == 0; } );
+    report( "batched del", count, bench_clock::now() - start );
+
+    auto const &stats = queue.stats();
+    std::cout << "batches: " << stats.batches << " coalesced: " << stats.coalesced << " failed: " << failed << std::endl;
+    return 0;
+}
@@ -0,0 +1,356 @@
+// Minimal RADIUS server to benchmark authentication without a FreeRADIUS box: every
+// Access-Request gets an Access-Accept with the configured Framed-IP-Address range,
+// Framed-Pool and Subscriber-Profile-Name, every Accounting-Request gets its response.
+// Answers are held back by a simulated server latency or lost on purpose; user names
+// and passwords are not checked.
+//
+// Usage: radius_responder -d dictionary [-d ...] [-a auth_port] [-c acct_port] [-s secret]
+//        [-l latency_us] [-j jitter_us] [--exponential] [--loss ratio]
+//        [--first-ip address] [--pool name] [--template name]
+
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <queue>
+#include <cstring>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include "runtime.hpp"
+#include "auth_client.hpp"
+#include "radius_dict.hpp"
+#include "radius_avp.hpp"
+#include "request_response.hpp"
+#include "md5.hpp"
+
+// Linked in with the dictionary code, never set here
+std::shared_ptr<PPPOERuntime> runtime;
+std::atomic_bool interrupted;
+
+using bench_clock = std::chrono::steady_clock;
+
+struct ResponderConf {
+    std::string secret { "testing123" };
+    uint32_t latency_us { 0 };
+    uint32_t jitter_us { 0 };
+    bool exponential { false };
+    double loss { 0.0 };
+    RadiusResponse accept;
+};
+
+struct ResponderStats {
+    uint64_t access { 0 };
+    uint64_t accounting { 0 };
+    uint64_t lost { 0 };
+    uint64_t malformed { 0 };
+};
+
+class Responder {
+public:
+    Responder( boost::asio::io_context &i, const ResponderConf &c, std::shared_ptr<const RadiusDict> d ):
+        conf( c ),
+        dict( std::move( d ) ),
+        sockets { boost::asio::ip::udp::socket { i }, boost::asio::ip::udp::socket { i } },
+        timer( i )
+    {
+        for( size_t i = 0; i < RADIUS_RX_BATCH; i++ ) {
+            rx_iovs[ i ] = { rx_bufs[ i ].data(), rx_bufs[ i ].size() };
+        }
+    }
+
+    std::string open( size_t index, uint16_t port ) {
+        boost::system::error_code ec;
+        boost::asio::ip::udp::endpoint local { boost::asio::ip::udp::v4(), port };
+        auto &socket = sockets[ index ];
+        socket.open( local.protocol(), ec );
+        if( !ec ) {
+            socket.bind( local, ec );
+        }
+        if( ec ) {
+            return "Cannot listen on port " + std::to_string( port ) + ": " + ec.message();
+        }
+        boost::system::error_code ignored;
+        socket.set_option( boost::asio::socket_base::receive_buffer_size( 4 << 20 ), ignored );
+        receive( index );
+        return {};
+    }
+
+    const ResponderStats& stats() const {
+        return counters;
+    }
+
+    size_t pending() const {
+        return delayed.size();
+    }
+
+private:
+    struct Slot {
+        bool ok { false };
+        boost::asio::ip::udp::endpoint from;
+        authenticator_t digest;
+        std::vector<uint8_t> reply;
+    };
+
+    struct Delayed {
+        bench_clock::time_point due;
+        size_t index;
+        boost::asio::ip::udp::endpoint to;
+        std::vector<uint8_t> reply;
+
+        bool operator>( const Delayed &r ) const {
+            return due > r.due;
+        }
+    };
+
+    void receive( size_t index ) {
+        sockets[ index ].async_wait( boost::asio::ip::udp::socket::wait_read,
+            std::bind( &Responder::on_readable, this, index, std::placeholders::_1 ) );
+    }
+
+    bench_clock::duration latency() {
+        uint64_t us = conf.latency_us;
+        if( conf.jitter_us != 0 ) {
+            if( conf.exponential ) {
+                us += static_cast<uint64_t>( std::exponential_distribution<double>{ 1.0 / conf.jitter_us }( rng ) );
+            } else {
+                us += std::uniform_int_distribution<uint64_t>{ 0, conf.jitter_us }( rng );
+            }
+        }
+        return std::chrono::microseconds( us );
+    }
+
+    void on_readable( size_t index, boost::system::error_code ec ) {
+        if( ec ) {
+            if( ec != boost::asio::error::operation_aborted ) {
+                std::cerr << "Socket error: " << ec.message() << std::endl;
+            }
+            return;
+        }
+
+        auto fd = sockets[ index ].native_handle();
+        while( true ) {
+            for( size_t i = 0; i < RADIUS_RX_BATCH; i++ ) {
+                rx_msgs[ i ] = {};
+                rx_msgs[ i ].msg_hdr.msg_iov = &rx_iovs[ i ];
+                rx_msgs[ i ].msg_hdr.msg_iovlen = 1;
+                rx_msgs[ i ].msg_hdr.msg_name = &rx_addrs[ i ];
+                rx_msgs[ i ].msg_hdr.msg_namelen = sizeof( rx_addrs[ i ] );
+            }
+            auto n = recvmmsg( fd, rx_msgs.data(), RADIUS_RX_BATCH, MSG_DONTWAIT, nullptr );
+            if( n < 0 ) {
+                if( errno == EINTR ) {
+                    continue;
+                }
+                if( errno != EAGAIN && errno != EWOULDBLOCK ) {
+                    std::cerr << "Cannot receive requests: " << strerror( errno ) << std::endl;
+                }
+                break;
+            }
+
+            md5_jobs.clear();
+            for( int i = 0; i < n; i++ ) {
+                auto &slot = slots[ i ];
+                slot.ok = false;
+                auto pkt = reinterpret_cast<const RadiusPacket*>( rx_bufs[ i ].data() );
+                size_t size = rx_msgs[ i ].msg_len;
+                if( ( rx_msgs[ i ].msg_hdr.msg_flags & MSG_TRUNC ) || size < sizeof( RadiusPacket ) ||
+                    pkt->length.native() < sizeof( RadiusPacket ) || pkt->length.native() > size ||
+                    ( pkt->code != RADIUS_CODE::ACCESS_REQUEST && pkt->code != RADIUS_CODE::ACCOUNTING_REQUEST ) )
+                {
+                    counters.malformed++;
+                    continue;
+                }
+                if( conf.loss > 0 && std::bernoulli_distribution{ conf.loss }( rng ) ) {
+                    counters.lost++;
+                    continue;
+                }
+                slot.ok = true;
+                slot.from = boost::asio::ip::udp::endpoint {
+                    address_v4_t { ntohl( rx_addrs[ i ].sin_addr.s_addr ) }, ntohs( rx_addrs[ i ].sin_port ) };
+                answer( pkt, slot );
+
+                // Response Authenticator covers the answer with the request authenticator in place
+                auto reply = reinterpret_cast<const char*>( slot.reply.data() );
+                md5_jobs.push_back( { {
+                    { reply, 4 },
+                    { reinterpret_cast<const char*>( pkt->authenticator.data() ), pkt->authenticator.size() },
+                    { reply + sizeof( RadiusPacket ), slot.reply.size() - sizeof( RadiusPacket ) },
+                    conf.secret
+                }, slot.digest } );
+            }
+            md5_batch( md5_jobs.data(), md5_jobs.size() );
+
+            auto now = bench_clock::now();
+            for( int i = 0; i < n; i++ ) {
+                auto &slot = slots[ i ];
+                if( !slot.ok ) {
+                    continue;
+                }
+                reinterpret_cast<RadiusPacket*>( slot.reply.data() )->authenticator = slot.digest;
+                auto due = now + latency();
+                if( due <= now ) {
+                    send( index, slot.from, slot.reply );
+                    continue;
+                }
+                bool earliest = delayed.empty() || due < delayed.top().due;
+                delayed.push( Delayed { due, index, slot.from, std::move( slot.reply ) } );
+                if( earliest ) {
+                    timer.expires_at( due );
+                    timer.async_wait( std::bind( &Responder::on_timer, this, std::placeholders::_1 ) );
+                }
+            }
+            if( static_cast<size_t>( n ) < RADIUS_RX_BATCH ) {
+                break;
+            }
+        }
+        receive( index );
+    }
+
+    void answer( const RadiusPacket *pkt, Slot &slot ) {
+        slot.reply.resize( RADIUS_MAX_PACKET );
+        auto hdr = reinterpret_cast<RadiusPacket*>( slot.reply.data() );
+        hdr->id = pkt->id;
+        hdr->authenticator.fill( 0 );
+        AVPWriter avp { slot.reply.data() + sizeof( RadiusPacket ), slot.reply.size() - sizeof( RadiusPacket ) };
+        if( pkt->code == RADIUS_CODE::ACCESS_REQUEST ) {
+            counters.access++;
+            hdr->code = RADIUS_CODE::ACCESS_ACCEPT;
+            auto res = conf.accept;
+            if( !res.framed_ip.is_unspecified() ) {
+                res.framed_ip = address_v4_t { res.framed_ip.to_uint() + next_ip++ };
+            }
+            serialize( *dict, res, avp );
+        } else {
+            counters.accounting++;
+            hdr->code = RADIUS_CODE::ACCOUNTING_RESPONSE;
+        }
+        hdr->length = sizeof( RadiusPacket ) + avp.size();
+        slot.reply.resize( sizeof( RadiusPacket ) + avp.size() );
+    }
+
+    void on_timer( boost::system::error_code ec ) {
+        if( ec ) {
+            return;
+        }
+        auto now = bench_clock::now();
+        while( !delayed.empty() && delayed.top().due <= now ) {
+            auto const &d = delayed.top();
+            send( d.index, d.to, d.reply );
+            delayed.pop();
+        }
+        if( !delayed.empty() ) {
+            timer.expires_at( delayed.top().due );
+            timer.async_wait( std::bind( &Responder::on_timer, this, std::placeholders::_1 ) );
+        }
+    }
+
+    void send( size_t index, const boost::asio::ip::udp::endpoint &to, const std::vector<uint8_t> &reply ) {
+        boost::system::error_code ec;
+        sockets[ index ].send_to( boost::asio::buffer( reply ), to, 0, ec );
+        if( ec ) {
+            std::cerr << "Cannot answer " << to << ": " << ec.message() << std::endl;
+        }
+    }
+
+    const ResponderConf &conf;
+    std::shared_ptr<const RadiusDict> dict;
+    std::array<boost::asio::ip::udp::socket,2> sockets;
+    boost::asio::steady_timer timer;
+    std::mt19937_64 rng { std::random_device{}() };
+    uint32_t next_ip { 0 };
+    ResponderStats counters;
+
+    std::priority_queue<Delayed,std::vector<Delayed>,std::greater<Delayed>> delayed;
+
+    std::array<std::array<uint8_t,RADIUS_MAX_PACKET>,RADIUS_RX_BATCH> rx_bufs;
+    std::array<iovec,RADIUS_RX_BATCH> rx_iovs;
+    std::array<sockaddr_in,RADIUS_RX_BATCH> rx_addrs;
+    std::array<mmsghdr,RADIUS_RX_BATCH> rx_msgs;
+    std::array<Slot,RADIUS_RX_BATCH> slots;
+    std::vector<Md5Job> md5_jobs;
+};
+
+int main( int argc, char *argv[] ) {
+    std::vector<std::string> dictionaries;
+    uint16_t auth_port = 1812;
+    uint16_t acct_port = 1813;
+    std::string first_ip;
+    ResponderConf conf;
+
+    boost::program_options::options_description desc { "RADIUS responder for benchmarks" };
+    desc.add_options()
+    ( "dictionary,d", boost::program_options::value( &dictionaries )->required(), "FreeRADIUS dictionary file, may be repeated" )
+    ( "auth-port,a", boost::program_options::value( &auth_port ), "Authentication port" )
+    ( "acct-port,c", boost::program_options::value( &acct_port ), "Accounting port, 0 to disable" )
+    ( "secret,s", boost::program_options::value( &conf.secret ), "Shared secret" )
+    ( "latency,l", boost::program_options::value( &conf.latency_us ), "Fixed part of the answer delay in microseconds" )
+    ( "jitter,j", boost::program_options::value( &conf.jitter_us ), "Random part of the answer delay in microseconds, uniform up to this value" )
+    ( "exponential", "Random part of the delay is exponential with the jitter as its mean" )
+    ( "loss", boost::program_options::value( &conf.loss ), "Share of requests dropped without an answer, 0 to 1" )
+    ( "first-ip", boost::program_options::value( &first_ip ), "Framed-IP-Address of the first Accept, the next ones count up" )
+    ( "pool", boost::program_options::value( &conf.accept.framed_pool ), "Framed-Pool of every Accept" )
+    ( "template", boost::program_options::value( &conf.accept.pppoe_template ), "Subscriber-Profile-Name of every Accept" )
+    ( "help,h", "Print this message" );
+
+    boost::program_options::variables_map vm;
+    try {
+        boost::program_options::store( boost::program_options::parse_command_line( argc, argv, desc ), vm );
+        if( vm.count( "help" ) ) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        boost::program_options::notify( vm );
+        if( !first_ip.empty() ) {
+            conf.accept.framed_ip = address_v4_t::from_string( first_ip );
+        }
+    } catch( std::exception &e ) {
+        std::cerr << "Error on parsing arguments: " << e.what() << std::endl;
+        return -1;
+    }
+    conf.exponential = vm.count( "exponential" ) > 0;
+
+    boost::asio::io_context io;
+    Responder responder { io, conf, RadiusDict::load( dictionaries, "" ) };
+    for( auto const &[ index, port ]: { std::make_pair( 0, auth_port ), std::make_pair( 1, acct_port ) } ) {
+        if( port == 0 ) {
+            continue;
+        }
+        if( auto const &err = responder.open( index, port ); !err.empty() ) {
+            std::cerr << err << std::endl;
+            return -1;
+        }
+    }
+
+    // Rates once per second until interrupted
+    boost::asio::steady_timer report { io };
+    ResponderStats last;
+    std::function<void( boost::system::error_code )> on_report = [ & ]( boost::system::error_code ec ) {
+        if( ec ) {
+            return;
+        }
+        auto const &s = responder.stats();
+        if( s.access != last.access || s.accounting != last.accounting || s.lost != last.lost ) {
+            std::cout << "access " << s.access - last.access << "/s, accounting " << s.accounting - last.accounting
+                << "/s, lost " << s.lost - last.lost << "/s, waiting " << responder.pending() << std::endl;
+        }
+        last = s;
+        report.expires_after( std::chrono::seconds( 1 ) );
+        report.async_wait( on_report );
+    };
+    report.expires_after( std::chrono::seconds( 1 ) );
+    report.async_wait( on_report );
+
+    boost::asio::signal_set signals { io, SIGINT, SIGTERM };
+    signals.async_wait( [ & ]( boost::system::error_code ec, int ) {
+        io.stop();
+    });
+    io.run();
+
+    auto const &s = responder.stats();
+    std::cout << "Total: access " << s.access << ", accounting " << s.accounting << ", lost " << s.lost << ", malformed " << s.malformed << std::endl;
+    return 0;
+}
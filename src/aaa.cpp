@@ -1,12 +1,14 @@
 #include <iostream>
 #include <memory>
 #include <functional>
+#include <charconv>
 
 #include "aaa.hpp"
 #include "aaa_session.hpp"
 #include "radius_dict.hpp"
 #include "request_response.hpp"
 #include "runtime.hpp"
+#include "admission.hpp"
 #include "log.hpp"
 #include "string_helpers.hpp"
 
@@ -39,26 +41,26 @@ AAA::AAA( io_service &i, AAAConf &c ):
     io( i ),
     conf( c )
 {
-    if( !conf.dictionaries.empty() ) {
-        dict.emplace( conf.dictionaries );
-    }
-
-    if( !dict.has_value() ) {
+    if( conf.dictionaries.empty() ) {
         runtime->logger->logInfo() << LOGS::AAA << "No RADIUS dictionaries provided. RADIUS won't be working." << std::endl;
     }
+    dict = RadiusDict::load( conf.dictionaries, conf.dictionary_cache );
+
+    auto retransmit = []( const AAARadConf &v ) -> RadiusRetransmitConf {
+        return { std::chrono::milliseconds( v.retransmit_interval ), v.retransmits, std::chrono::milliseconds( v.timeout ) };
+    };
 
+    auth = std::make_shared<RadiusServerGroup>( io, conf.server_selection, conf.dead_threshold, std::chrono::seconds( conf.dead_time ) );
     for( auto const &[ k, v ]: conf.auth_servers ) {
-        auth.emplace( std::piecewise_construct, 
-            std::forward_as_tuple( k ),
-            std::forward_as_tuple( std::make_shared<AuthClient>( io, v.address, v.port, v.secret, *dict ) ) 
-        );
+        auth->add( k, std::make_shared<AuthClient>( io, v.address, v.port, v.secret, dict, v.source_ports, retransmit( v ) ), v.weight );
     }
 
+    acct = std::make_shared<RadiusServerGroup>( io, conf.server_selection, conf.dead_threshold, std::chrono::seconds( conf.dead_time ) );
     for( auto const &[ k, v ]: conf.acct_servers ) {
-        acct.emplace( std::piecewise_construct, 
-            std::forward_as_tuple( k ),
-            std::forward_as_tuple( std::make_shared<AuthClient>( io, v.address, v.port, v.secret, *dict ) ) 
-        );
+        acct->add( k, std::make_shared<AuthClient>( io, v.address, v.port, v.secret, dict, v.source_ports, retransmit( v ) ), v.weight );
+    }
+    if( !acct->empty() ) {
+        accounting = std::make_shared<AcctScheduler>( io, acct, conf );
     }
 }
 
@@ -73,6 +75,16 @@ void AAA::startSession( const std::string &user, const std::string &pass, PPPOES
                 callback( sid, err );
             }
             break;
+        case AAA_METHODS::LOCAL:
+            if( auto const sub = local_users.find( user ); sub == nullptr ) {
+                continue;
+            } else if( !LocalUserDB::checkPAP( *sub, pass ) ) {
+                callback( 0, "Wrong password for local user" );
+            } else {
+                auto const &[ sid, err ] = startSessionLocal( user, *sub );
+                callback( sid, err );
+            }
+            return;
         case AAA_METHODS::RADIUS:
             startSessionRadius( user, pass, sess, std::move( callback ) );
             return;
@@ -94,6 +106,16 @@ void AAA::startSessionCHAP( const std::string &user, const std::string &challeng
                 callback( sid, err );
             }
             break;
+        case AAA_METHODS::LOCAL:
+            if( auto const sub = local_users.find( user ); sub == nullptr ) {
+                continue;
+            } else if( !LocalUserDB::checkCHAP( *sub, challenge, response ) ) {
+                callback( 0, "Wrong CHAP response for local user" );
+            } else {
+                auto const &[ sid, err ] = startSessionLocal( user, *sub );
+                callback( sid, err );
+            }
+            return;
         case AAA_METHODS::RADIUS:
             startSessionRadiusChap( user, challenge, response, sess, std::move( callback ) );
             return;
@@ -126,14 +148,12 @@ void AAA::startSessionRadius( const std::string &user, const std::string &pass,
         req.nas_port_id = str.str();
     }
 
-    for( auto &[ id, serv ]: auth ) {
-        serv->request( 
-            req, 
-            std::bind( &AAA::processRadiusAnswer, this, callback, user, std::placeholders::_1, std::placeholders::_2 ),
-            std::bind( &AAA::processRadiusError, this, callback, std::placeholders::_1 )
-        );
-        break;
-    }
+    auto started = runtime->admission->authStarted();
+    auth->request( 
+        req, 
+        std::bind( &AAA::processRadiusAnswer, this, callback, user, started, std::placeholders::_1, std::placeholders::_2 ),
+        std::bind( &AAA::processRadiusError, this, callback, started, std::placeholders::_1 )
+    );
 }
 
 void AAA::startSessionRadiusChap( const std::string &user, const std::string &challenge, const std::string &response, PPPOESession &sess, aaa_callback callback ) {
@@ -159,18 +179,17 @@ void AAA::startSessionRadiusChap( const std::string &user, const std::string &ch
         req.nas_port_id = str.str();
     }
 
-    for( auto &[ id, serv ]: auth ) {
-        serv->request( 
-            req, 
-            std::bind( &AAA::processRadiusAnswer, this, callback, user, std::placeholders::_1, std::placeholders::_2 ),
-            std::bind( &AAA::processRadiusError, this, callback, std::placeholders::_1 )
-        );
-        break;
-    }
+    auto started = runtime->admission->authStarted();
+    auth->request( 
+        req, 
+        std::bind( &AAA::processRadiusAnswer, this, callback, user, started, std::placeholders::_1, std::placeholders::_2 ),
+        std::bind( &AAA::processRadiusError, this, callback, started, std::placeholders::_1 )
+    );
 }
 
-void AAA::processRadiusAnswer( aaa_callback callback, std::string user, RADIUS_CODE code, std::vector<uint8_t> v ) {
-    auto res = deserialize<RadiusResponse>( *dict, v );
+void AAA::processRadiusAnswer( aaa_callback callback, std::string user, std::chrono::steady_clock::time_point started, RADIUS_CODE code, AVPReader avps ) {
+    runtime->admission->authFinished( started );
+    auto res = deserialize<RadiusResponse>( *dict, avps );
 
     if( code != RADIUS_CODE::ACCESS_ACCEPT ) {
         callback( 0, "RADIUS answered with no accept" );
@@ -191,18 +210,20 @@ void AAA::processRadiusAnswer( aaa_callback callback, std::string user, RADIUS_C
     if( auto const &[ it, ret ] = sessions.emplace( 
         std::piecewise_construct, 
         std::forward_as_tuple( i ), 
-        std::forward_as_tuple( std::make_shared<AAA_Session>( io, i, user, conf.local_template, res, acct.begin()->second ) )
+        std::forward_as_tuple( std::make_shared<AAA_Session>( io, i, user, conf.local_template, res, accounting ) )
     ); !ret ) {
         runtime->logger->logError() << LOGS::AAA << "failed to emplace user " << user << std::endl;
         callback( SESSION_ERROR, "Failed to emplace user" );
         return;
     } else {
+        indexSession( *it->second );
         it->second->start();
     }
     callback( i, "" );
 }
 
-void AAA::processRadiusError( aaa_callback callback, const std::string &error ) {
+void AAA::processRadiusError( aaa_callback callback, std::chrono::steady_clock::time_point started, const std::string &error ) {
+    runtime->admission->authFinished( started );
     callback( 0, "RADIUS error: " + error );
 }
 
@@ -230,10 +251,68 @@ std::tuple<uint32_t,std::string> AAA::startSessionNone( const std::string &user,
     ); !ret ) {
         runtime->logger->logError() << LOGS::AAA <<  "failer to emplace user " << user << std::endl;
         return { SESSION_ERROR, "Failed to emplace user" };
+    } else {
+        indexSession( *it->second );
+    }
+    return { i, "" };
+}
+
+std::tuple<uint32_t,std::string> AAA::startSessionLocal( const std::string &user, const LocalSubscriber &sub ) {
+    runtime->logger->logDebug() << LOGS::AAA << "LOCAL auth, starting session user: " << user << std::endl;
+
+    // Local subscriber is given the same attributes as a RADIUS accept would carry
+    RadiusResponse res;
+    res.framed_ip = sub.framed_ip;
+    res.framed_pool = sub.framed_pool;
+    res.pppoe_template = sub.pppoe_template;
+
+    uint32_t i;
+    for( i = 0; i < UINT32_MAX; i++ ) {
+        if( auto const &it = sessions.find( i ); it == sessions.end() ) {
+            break;
+        }
+    }
+    if( i == UINT32_MAX ) {
+        return { SESSION_ERROR, "No space for new sessions" };
+    }
+
+    if( auto const &[ it, ret ] = sessions.emplace( 
+        std::piecewise_construct,
+        std::forward_as_tuple( i ), 
+        std::forward_as_tuple( std::make_shared<AAA_Session>( io, i, user, conf.local_template, res, accounting ) ) 
+    ); !ret ) {
+        runtime->logger->logError() << LOGS::AAA << "failed to emplace user " << user << std::endl;
+        return { SESSION_ERROR, "Failed to emplace user" };
+    } else {
+        indexSession( *it->second );
+        it->second->start();
     }
     return { i, "" };
 }
 
+std::string AAA::reloadLocalUsers() {
+    if( conf.local_users.empty() ) {
+        return {};
+    }
+    auto const &[ stats, err ] = local_users.load( conf.local_users );
+    if( !err.empty() ) {
+        return err;
+    }
+    std::ostringstream out;
+    out << "Local users: " << local_users.size() << " total, " << stats.added << " added, " << stats.changed << " changed, " << stats.removed << " removed";
+    if( stats.ignored > 0 ) {
+        out << ", " << stats.ignored << " malformed lines ignored";
+    }
+    return out.str();
+}
+
+std::string AAA::openAcctSpool() {
+    if( !accounting ) {
+        return {};
+    }
+    return accounting->openSpool();
+}
+
 std::tuple<std::shared_ptr<AAA_Session>,std::string> AAA::getSession( uint32_t sid ) {
     if( auto const &it = sessions.find( sid); it == sessions.end() ) {
         return { nullptr, "Cannot find session id " + std::to_string( sid ) };
@@ -245,6 +324,7 @@ std::tuple<std::shared_ptr<AAA_Session>,std::string> AAA::getSession( uint32_t s
 void AAA::stopSession( uint32_t sid ) {
     if( auto const &it = sessions.find( sid ); it != sessions.end() ) {
         it->second->stop();
+        unindexSession( *it->second );
         sessions.erase( it );
     }
 }
@@ -261,4 +341,78 @@ void AAA::stopAllSessions() {
         session->stop();
     }
     sessions.clear();
-}
\ No newline at end of file
+    by_username.clear();
+    by_address.clear();
+}
+
+void AAA::indexSession( const AAA_Session &session ) {
+    by_username.emplace( session.username, session.session_id );
+    if( session.address.to_uint() != 0 ) {
+        by_address.insert_or_assign( session.address.to_uint(), session.session_id );
+    }
+}
+
+void AAA::unindexSession( const AAA_Session &session ) {
+    auto [ begin, end ] = by_username.equal_range( session.username );
+    for( auto it = begin; it != end; it++ ) {
+        if( it->second == session.session_id ) {
+            by_username.erase( it );
+            break;
+        }
+    }
+    if( auto const &it = by_address.find( session.address.to_uint() ); it != by_address.end() && it->second == session.session_id ) {
+        by_address.erase( it );
+    }
+}
+
+std::vector<uint32_t> AAA::findSessions( const CoARequest &req ) const {
+    // Candidates come from the most specific attribute, the others have to match them
+    std::vector<uint32_t> found;
+    InternedString username { req.username };
+    if( !req.session_id.empty() ) {
+        static const std::string prefix { "session_" };
+        if( req.session_id.compare( 0, prefix.size(), prefix ) != 0 ) {
+            return {};
+        }
+        uint32_t sid;
+        auto const *first = req.session_id.data() + prefix.size();
+        auto const *last = req.session_id.data() + req.session_id.size();
+        if( auto const &[ ptr, ec ] = std::from_chars( first, last, sid ); ec != std::errc() || ptr != last ) {
+            return {};
+        }
+        found.push_back( sid );
+    } else if( req.framed_ip.to_uint() != 0 ) {
+        if( auto const &it = by_address.find( req.framed_ip.to_uint() ); it != by_address.end() ) {
+            found.push_back( it->second );
+        }
+    } else if( !username.empty() ) {
+        auto [ begin, end ] = by_username.equal_range( username );
+        for( auto it = begin; it != end; it++ ) {
+            found.push_back( it->second );
+        }
+    }
+
+    std::vector<uint32_t> out;
+    for( auto sid: found ) {
+        auto const &it = sessions.find( sid );
+        if( it == sessions.end() ) {
+            continue;
+        }
+        auto const &session = *it->second;
+        if( !username.empty() && session.username != username ) {
+            continue;
+        }
+        if( req.framed_ip.to_uint() != 0 && session.address != req.framed_ip ) {
+            continue;
+        }
+        out.push_back( sid );
+    }
+    return out;
+}
+const RadiusServerGroup& AAA::authServers() const {
+    return *auth;
+}
+
+const RadiusServerGroup& AAA::acctServers() const {
+    return *acct;
+}
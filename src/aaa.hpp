@@ -2,12 +2,17 @@
 #define AAA_HPP_
 
 #include <optional>
+#include <unordered_map>
 #include "auth_client.hpp"
+#include "radius_group.hpp"
+#include "acct_scheduler.hpp"
 #include "session.hpp"
+#include "local_users.hpp"
 
 struct AAAConf;
 struct PPPOELocalTemplate;
 struct RadiusResponse;
+struct CoARequest;
 class AAA_Session;
 
 #define SESSION_ERROR UINT32_MAX
@@ -20,17 +25,25 @@ class AAA {
     io_service &io;
     AAAConf &conf;
     std::map<uint32_t,std::shared_ptr<AAA_Session>> sessions;
-    std::map<std::string,std::shared_ptr<AuthClient>> auth;
-    std::map<std::string,std::shared_ptr<AuthClient>> acct;
+    std::shared_ptr<RadiusServerGroup> auth;
+    std::shared_ptr<RadiusServerGroup> acct;
+    std::shared_ptr<AcctScheduler> accounting;
+    LocalUserDB local_users;
+    // Lookups for Disconnect and CoA requests, Acct-Session-Id carries the key of sessions
+    std::unordered_multimap<InternedString,uint32_t> by_username;
+    std::unordered_map<uint32_t,uint32_t> by_address;
 
+    void indexSession( const AAA_Session &session );
+    void unindexSession( const AAA_Session &session );
 
     // radius methods
     void startSessionRadius( const std::string &user, const std::string &pass, PPPOESession &sess, aaa_callback callback );
     void startSessionRadiusChap( const std::string &user, const std::string &challenge, const std::string &response, PPPOESession &sess, aaa_callback callback );
-    void processRadiusAnswer( aaa_callback callback, std::string user, RADIUS_CODE code, std::vector<uint8_t> v );
-    void processRadiusError( aaa_callback callback, const std::string &error );
+    void processRadiusAnswer( aaa_callback callback, std::string user, std::chrono::steady_clock::time_point started, RADIUS_CODE code, AVPReader avps );
+    void processRadiusError( aaa_callback callback, std::chrono::steady_clock::time_point started, const std::string &error );
     // local and none methods
     std::tuple<uint32_t,std::string> startSessionNone( const std::string &user, const std::string &pass );
+    std::tuple<uint32_t,std::string> startSessionLocal( const std::string &user, const LocalSubscriber &sub );
 
 public:
     AAA( io_service &i, AAAConf &c );
@@ -41,8 +54,16 @@ public:
     void stopSession( uint32_t sid );
     void mapIfaceToSession( uint32_t session_id, uint32_t ifindex );
     void stopAllSessions();
+    // Sessions matching every identification attribute of the request, RFC 5176 3
+    std::vector<uint32_t> findSessions( const CoARequest &req ) const;
+    const RadiusServerGroup& authServers() const;
+    const RadiusServerGroup& acctServers() const;
+    // Loads the LOCAL subscribers file again if it changed, returns a line for the log
+    std::string reloadLocalUsers();
+    // Picks up accounting records spooled by an earlier run, returns a line for the log
+    std::string openAcctSpool();
 
-    std::optional<RadiusDict> dict;
+    std::shared_ptr<const RadiusDict> dict;
 };
 
 #endif
\ No newline at end of file
@@ -7,57 +7,54 @@
 #include "radius_dict.hpp"
 #include "request_response.hpp"
 #include "vpp_types.hpp"
-#include "vpp.hpp"
+#include "dp_backend.hpp"
 #include "runtime.hpp"
 
 extern std::shared_ptr<PPPOERuntime> runtime;
 
 AAA_Session::AAA_Session( io_service &i, uint32_t sid, const std::string &u, const std::string &template_name ):
     io( i ),
-    timer( io ),
     session_id( sid ),
     username( u )
 {
-    if( auto const &tIt = runtime->conf.pppoe_templates.find( template_name ); tIt != runtime->conf.pppoe_templates.end() ) {
-        dns1 = tIt->second.dns1;
-        dns2 = tIt->second.dns2;
-        framed_pool = tIt->second.framed_pool;
-        vrf = tIt->second.vrf;
+    tmpl = runtime->templates.findTemplate( template_name );
+    if( auto const t = runtime->templates.get( tmpl ); t != nullptr ) {
+        dns1 = t->dns1;
+        dns2 = t->dns2;
+        pool = t->pool;
+        tmpl_vrf = t->vrf;
+        tmpl_unnumbered = t->unnumbered;
     }
-    auto const &fr_pool = runtime->conf.aaa_conf.pools.find( framed_pool );
-    if( fr_pool == runtime->conf.aaa_conf.pools.end() ) {
+    auto fr_pool = runtime->templates.pool( pool );
+    if( fr_pool == nullptr ) {
         return;
     }
-    address = address_v4_t{ fr_pool->second.allocate_ip() };
+    address = address_v4_t{ fr_pool->allocate_ip() };
     runtime->logger->logDebug() << LOGS::AAA << "Allocated IP: " << address.to_string() << std::endl;
     free_ip = true;
 
-    runtime->logger->logInfo() << "Creating new AAA session: " << username << " " << address.to_string() << " vrf: " << vrf << std::endl;
+    runtime->logger->logInfo() << "Creating new AAA session: " << username << " " << address.to_string() << " vrf: " << vrf() << std::endl;
 }
 
-AAA_Session::AAA_Session( io_service &i, uint32_t sid, const std::string &u, const std::string &template_name, RadiusResponse resp, std::shared_ptr<AuthClient> s ):
+AAA_Session::AAA_Session( io_service &i, uint32_t sid, const std::string &u, const std::string &template_name, RadiusResponse resp, std::shared_ptr<AcctScheduler> s ):
     io( i ),
-    timer( io ),
     session_id( sid ),
     username( u ),
     address( resp.framed_ip ),
     acct( s )
 {
-    auto template_to_find = template_name;
-    if( !resp.pppoe_template.empty() ) {
-        template_to_find = resp.pppoe_template;
-    }
-    if( auto const &tIt = runtime->conf.pppoe_templates.find( template_to_find ); tIt != runtime->conf.pppoe_templates.end() ) {
-        dns1 = tIt->second.dns1;
-        dns2 = tIt->second.dns2;
-        framed_pool = tIt->second.framed_pool;
-        vrf = tIt->second.vrf;
-        unnumbered = tIt->second.unnumbered;
+    tmpl = runtime->templates.findTemplate( resp.pppoe_template.empty() ? template_name : resp.pppoe_template );
+    if( auto const t = runtime->templates.get( tmpl ); t != nullptr ) {
+        dns1 = t->dns1;
+        dns2 = t->dns2;
+        pool = t->pool;
+        tmpl_vrf = t->vrf;
+        tmpl_unnumbered = t->unnumbered;
     }
 
     // Filling template with RADIUS information
     if( !resp.framed_pool.empty() ) {
-        framed_pool = resp.framed_pool;
+        pool = runtime->templates.findPool( resp.framed_pool );
     }
     if( resp.dns1.to_uint() != 0 ) {
         dns1 = resp.dns1;
@@ -65,151 +62,111 @@ AAA_Session::AAA_Session( io_service &i, uint32_t sid, const std::string &u, con
     if( resp.dns2.to_uint() != 0 ) {
         dns2 = resp.dns2;
     }
-    if( ( address.to_uint() == 0 ) && ( !framed_pool.empty() ) ) {
-        auto const &fr_pool = runtime->conf.aaa_conf.pools.find( framed_pool );
-        if( fr_pool != runtime->conf.aaa_conf.pools.end() ) {
-            address = address_v4_t{ fr_pool->second.allocate_ip() };
+    if( address.to_uint() == 0 ) {
+        if( auto fr_pool = runtime->templates.pool( pool ); fr_pool != nullptr ) {
+            address = address_v4_t{ fr_pool->allocate_ip() };
             free_ip = true;
         }
     }
 
-    runtime->logger->logInfo() << "Creating new AAA session: " << username << " " << address.to_string() << " vrf: " << vrf << std::endl;
+    runtime->logger->logInfo() << "Creating new AAA session: " << username << " " << address.to_string() << " vrf: " << vrf() << std::endl;
 }
 
 AAA_Session::~AAA_Session() {
-    // Cancel the timer to prevent callbacks on destroyed object
-    timer.cancel();
-    
     if( free_ip && runtime ) {
-        auto const &fr_pool = runtime->conf.aaa_conf.pools.find( framed_pool );
-        if( fr_pool == runtime->conf.aaa_conf.pools.end() ) {
+        auto fr_pool = runtime->templates.pool( pool );
+        if( fr_pool == nullptr ) {
             if( runtime->logger ) {
                 runtime->logger->logDebug() << LOGS::AAA << "Can't deallocate IP: " << address.to_string() << ", can't find the pool" << std::endl;
             }
             return;
         }
-        fr_pool->second.deallocate_ip( address.to_uint() );
-    }
-}
-
-void AAA_Session::start() {
-    if( !acct ) {
-        return;
+        fr_pool->deallocate_ip( address.to_uint() );
     }
-
-    AcctRequest req;
-    req.session_id = "session_" + std::to_string( session_id );
-    req.acct_status_type = "Start";
-    req.nas_id = "vBNG";
-    req.username = username;
-    req.in_pkts = 0;
-    req.out_pkts = 0;
-    req.in_bytes = 0;
-    req.out_bytes = 0;
-
-    acct->acct_request( req, 
-        std::bind( &AAA_Session::on_started, shared_from_this(), std::placeholders::_1, std::placeholders::_2 ),
-        std::bind( &AAA_Session::on_failed, shared_from_this(), std::placeholders::_1 )
-    );
 }
 
-void AAA_Session::stop() {
-    // Cancel the interim timer to prevent further updates
-    timer.cancel();
-    
-    if( !acct ) {
-        return;
-    }
-    auto const &[ ret, counters ] = runtime->vpp->get_counters_by_index( ifindex );
-    AcctRequest req;
-    req.session_id = "session_" + std::to_string( session_id );
-    req.acct_status_type = "Stop";
-    req.nas_id = "vBNG";
-    req.username = username;
-    if( !ret ) {
-        req.in_pkts = 0;
-        req.out_pkts = 0;
-        req.in_bytes = 0;
-        req.out_bytes = 0;
-    } else {
-        req.in_pkts = counters.rxPkts;
-        req.out_pkts = counters.txPkts;
-        req.in_bytes = counters.rxBytes;
-        req.out_bytes = counters.txBytes;
-    }
-
-
-    acct->acct_request( req, 
-        std::bind( &AAA_Session::on_stopped, shared_from_this(), std::placeholders::_1, std::placeholders::_2 ),
-        std::bind( &AAA_Session::on_failed, shared_from_this(), std::placeholders::_1 )
-    );
+const std::string& AAA_Session::framed_pool() const {
+    return runtime->templates.poolName( pool );
 }
 
-void AAA_Session::on_started( RADIUS_CODE code, std::vector<uint8_t> pkt ) {
-    auto resp = deserialize<AcctResponse>( *runtime->aaa->dict, pkt );
-    to_stop_acct = true;
-    timer.expires_from_now( std::chrono::seconds( 30 ) );
-    timer.async_wait( std::bind( &AAA_Session::on_interim, shared_from_this(), std::placeholders::_1 ) );
+const InternedString& AAA_Session::vrf() const {
+    return tmpl_vrf;
 }
 
-void AAA_Session::on_interim_answer( RADIUS_CODE code, std::vector<uint8_t> pkt ) {
-    auto resp = deserialize<AcctResponse>( *runtime->aaa->dict, pkt );
-    timer.expires_from_now( std::chrono::seconds( 30 ) );
-    timer.async_wait( std::bind( &AAA_Session::on_interim, shared_from_this(), std::placeholders::_1 ) );
+const InternedString& AAA_Session::unnumbered() const {
+    return tmpl_unnumbered;
 }
 
-void AAA_Session::on_interim( const boost::system::error_code& ec ) {
-    if( ec ) {
-        // Timer 被 cancel 是正常的（会话删除时），只记录非预期错误
-        if( ec != boost::asio::error::operation_aborted ) {
-            runtime->logger->logError() << LOGS::AAA << "Unexpected error on interim timer: " 
-                                         << ec.message() << std::endl;
-        }
+void AAA_Session::start() {
+    if( !acct ) {
         return;
     }
+    acct->start( shared_from_this(), acctRequest( "Start" ) );
+}
 
-    // 防御性检查：NONE 认证的会话不应该发送 accounting
+void AAA_Session::stop() {
     if( !acct ) {
-        runtime->logger->logError() << LOGS::AAA << "on_interim called but acct is nullptr for session " 
-                                     << session_id << std::endl;
         return;
     }
+    acct->stop( session_id, acctRequest( "Stop" ) );
+}
 
-    auto const &[ ret, counters ] = runtime->vpp->get_counters_by_index( ifindex );
+AcctRequest AAA_Session::acctRequest( const std::string &status_type ) const {
     AcctRequest req;
     req.session_id = "session_" + std::to_string( session_id );
-    req.acct_status_type = "Alive";
+    req.acct_status_type = status_type;
     req.nas_id = "vBNG";
     req.username = username;
-    if( !ret ) {
-        req.in_pkts = 0;
-        req.out_pkts = 0;
-        req.in_bytes = 0;
-        req.out_bytes = 0;
-    } else {
-        req.in_pkts = counters.rxPkts;
-        req.out_pkts = counters.txPkts;
-        req.in_bytes = counters.rxBytes;
-        req.out_bytes = counters.txBytes;
+    req.in_pkts = 0;
+    req.out_pkts = 0;
+    req.in_bytes = 0;
+    req.out_bytes = 0;
+    if( status_type == "Start" ) {
+        return req;
     }
-
-    timer.cancel();
-
-    acct->acct_request( req, 
-        std::bind( &AAA_Session::on_interim_answer, shared_from_this(), std::placeholders::_1, std::placeholders::_2 ),
-        std::bind( &AAA_Session::on_failed, shared_from_this(), std::placeholders::_1 )
-    );
-}
-
-void AAA_Session::on_stopped( RADIUS_CODE code, std::vector<uint8_t> pkt ) {
-    auto resp = deserialize<AcctResponse>( *runtime->aaa->dict, pkt );
-    timer.cancel();
-}
-
-void AAA_Session::on_failed( std::string err ) {
-    runtime->logger->logError() << LOGS::SESSION << "Failed to send accounting request: " << err << std::endl;
+    req.in_pkts = base.rxPkts;
+    req.out_pkts = base.txPkts;
+    req.in_bytes = base.rxBytes;
+    req.out_bytes = base.txBytes;
+    if( ifindex == UINT32_MAX ) {
+        return req;
+    }
+    if( auto const &[ ret, counters ] = runtime->vpp->get_counters_by_index( ifindex ); ret ) {
+        req.in_pkts += counters.rxPkts;
+        req.out_pkts += counters.txPkts;
+        req.in_bytes += counters.rxBytes;
+        req.out_bytes += counters.txBytes;
+    }
+    return req;
 }
 
 void AAA_Session::map_iface( uint32_t ifi ) {
+    // Called before the delete reaches the data plane, the last collected counters are still there
+    if( ifi == UINT32_MAX && ifindex != UINT32_MAX ) {
+        if( auto const &[ ret, counters ] = runtime->vpp->get_counters_by_index( ifindex ); ret ) {
+            base.rxPkts += counters.rxPkts;
+            base.rxBytes += counters.rxBytes;
+            base.txPkts += counters.txPkts;
+            base.txBytes += counters.txBytes;
+            base.drops += counters.drops;
+        }
+    }
     ifindex = ifi;
 }
+
+std::string AAA_Session::change( const CoARequest &req ) {
+    if( !req.pppoe_template.empty() ) {
+        auto const h = runtime->templates.findTemplate( req.pppoe_template );
+        if( h == NO_HANDLE ) {
+            return "Unknown template " + req.pppoe_template;
+        }
+        auto const t = runtime->templates.get( h );
+        tmpl = h;
+        dns1 = t->dns1;
+        dns2 = t->dns2;
+        tmpl_vrf = t->vrf;
+        tmpl_unnumbered = t->unnumbered;
+    }
+    runtime->logger->logDebug() << LOGS::AAA << "Changed AAA session: " << username << " " << address.to_string() << " vrf: " << vrf() << std::endl;
+    return {};
+}
@@ -2,13 +2,17 @@
 #define AAA_SESSION
 
 #include "auth_client.hpp"
+#include "acct_scheduler.hpp"
 #include "config.hpp"
+#include "subscriber_templates.hpp"
+#include "vpp_types.hpp"
 
 using aaa_callback = std::function<void(uint32_t,std::string)>;
 
 class AuthClient;
 struct PPPOELocalTemplate;
 struct RadiusResponse;
+struct CoARequest;
 
 class AAA_Session : public std::enable_shared_from_this<AAA_Session> {
 public:
@@ -19,35 +23,44 @@ public:
     AAA_Session& operator=( AAA_Session&& ) = default;
 
     AAA_Session( io_service &i, uint32_t sid, const std::string &u, const std::string &template_name );
-    AAA_Session( io_service &i, uint32_t sid, const std::string &u, const std::string &template_name, RadiusResponse resp, std::shared_ptr<AuthClient> s );
+    AAA_Session( io_service &i, uint32_t sid, const std::string &u, const std::string &template_name, RadiusResponse resp, std::shared_ptr<AcctScheduler> s );
     ~AAA_Session();
 
     uint32_t session_id;
-    std::string username;
+    InternedString username;
     address_v4_t address;
     address_v4_t dns1;
     address_v4_t dns2;
-    std::string framed_pool;
-    std::string vrf;
-    std::string unnumbered;
+    // Into runtime->templates. The pool is where the address came from, a CoA keeps it
+    template_handle_t tmpl { NO_HANDLE };
+    pool_handle_t pool { NO_HANDLE };
 
-    std::shared_ptr<AuthClient> acct { nullptr };
+    std::shared_ptr<AcctScheduler> acct { nullptr };
     bool free_ip { false };
-    bool to_stop_acct{ false };
+
+    const std::string& framed_pool() const;
+    const InternedString& vrf() const;
+    const InternedString& unnumbered() const;
 
     void start();
     void stop();
-    void on_started( RADIUS_CODE code, std::vector<uint8_t> pkt );
-    void on_interim_answer( RADIUS_CODE code, std::vector<uint8_t> pkt );
-    void on_stopped( RADIUS_CODE code, std::vector<uint8_t> pkt );
-    void on_failed( std::string err );
-    void on_interim( const boost::system::error_code& error );
+    // Accounting request with the current counters of the session
+    AcctRequest acctRequest( const std::string &status_type ) const;
+    // UINT32_MAX when the session leaves its interface: what it counted so far is kept
     void map_iface( uint32_t ifi );
+    // Applies the template of a CoA-Request. The address stays, so does the pool it came from.
+    // Empty string on success
+    std::string change( const CoARequest &req );
 
 private:
-    uint32_t ifindex;
+    // Taken from the template when the session starts or a CoA switches it, so a template
+    // edited on SIGHUP changes new sessions only and the data plane matches what we report
+    InternedString tmpl_vrf;
+    InternedString tmpl_unnumbered;
+    uint32_t ifindex { UINT32_MAX };
+    // Totals of the interfaces the session had before, a new one counts from zero
+    VPPIfaceCounters base {};
     io_service &io;
-    boost::asio::steady_timer timer;
 };
 
 #endif
\ No newline at end of file
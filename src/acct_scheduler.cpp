@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <string_view>
+#include <filesystem>
+
+#include "acct_scheduler.hpp"
+#include "aaa_session.hpp"
+#include "radius_group.hpp"
+#include "runtime.hpp"
+#include "string_helpers.hpp"
+
+extern std::shared_ptr<PPPOERuntime> runtime;
+
+namespace {
+    constexpr std::chrono::milliseconds tick { 100 };
+
+    // Spool record: 32 bit length of the rest, created as unix seconds, the strings of the
+    // request with 16 bit lengths and its four counters, all little endian
+    template<typename T>
+    void put( std::string &out, T v ) {
+        for( size_t i = 0; i < sizeof( T ); i++ ) {
+            out.push_back( static_cast<char>( static_cast<uint64_t>( v ) >> ( 8 * i ) ) );
+        }
+    }
+
+    void put( std::string &out, const std::string &v ) {
+        put<uint16_t>( out, v.size() );
+        out += v;
+    }
+
+    std::string encode( const AcctRecord &rec ) {
+        std::string body;
+        put<int64_t>( body, std::chrono::duration_cast<std::chrono::seconds>( rec.created.time_since_epoch() ).count() );
+        auto const &r = rec.req;
+        for( auto const *s: { &r.session_id, &r.username, &r.nas_id, &r.nas_port_id, &r.acct_status_type, &r.calling_station_id } ) {
+            put( body, *s );
+        }
+        for( auto v: { r.in_pkts, r.out_pkts, r.in_bytes, r.out_bytes } ) {
+            put<uint32_t>( body, v );
+        }
+        std::string out;
+        put<uint32_t>( out, body.size() );
+        return out + body;
+    }
+
+    class SpoolReader {
+    public:
+        explicit SpoolReader( std::string_view d ): data( d ) {}
+
+        template<typename T>
+        bool get( T &v ) {
+            if( data.size() < sizeof( T ) ) {
+                return false;
+            }
+            uint64_t x = 0;
+            for( size_t i = 0; i < sizeof( T ); i++ ) {
+                x |= static_cast<uint64_t>( static_cast<uint8_t>( data[ i ] ) ) << ( 8 * i );
+            }
+            v = static_cast<T>( x );
+            data.remove_prefix( sizeof( T ) );
+            return true;
+        }
+
+        bool get( std::string &v ) {
+            uint16_t len;
+            if( !get( len ) || data.size() < len ) {
+                return false;
+            }
+            v = data.substr( 0, len );
+            data.remove_prefix( len );
+            return true;
+        }
+
+        bool empty() const {
+            return data.empty();
+        }
+
+    private:
+        std::string_view data;
+    };
+
+    bool decode( std::string_view body, AcctRecord &rec ) {
+        SpoolReader rd { body };
+        int64_t created;
+        auto &r = rec.req;
+        bool ok = rd.get( created ) &&
+            rd.get( r.session_id ) && rd.get( r.username ) && rd.get( r.nas_id ) &&
+            rd.get( r.nas_port_id ) && rd.get( r.acct_status_type ) && rd.get( r.calling_station_id ) &&
+            rd.get( r.in_pkts ) && rd.get( r.out_pkts ) && rd.get( r.in_bytes ) && rd.get( r.out_bytes );
+        rec.created = std::chrono::system_clock::time_point { std::chrono::seconds( created ) };
+        return ok && rd.empty();
+    }
+
+    // Reads the records of a spool file into out if it is given. A record cut by a crash
+    // ends the file, good_size tells where the readable part ends
+    size_t readSpool( const std::string &path, std::deque<AcctRecord> *out, size_t &good_size ) {
+        good_size = 0;
+        std::ifstream file { path, std::ios::binary };
+        if( !file.is_open() ) {
+            return 0;
+        }
+        std::string content { std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() };
+        SpoolReader rd { content };
+        size_t count = 0;
+        uint32_t len;
+        while( rd.get( len ) ) {
+            auto offset = good_size + sizeof( len );
+            if( content.size() - offset < len ) {
+                break;
+            }
+            AcctRecord rec;
+            if( !decode( std::string_view { content }.substr( offset, len ), rec ) ) {
+                break;
+            }
+            if( out != nullptr ) {
+                out->push_back( std::move( rec ) );
+            }
+            count++;
+            good_size = offset + len;
+            rd = SpoolReader { std::string_view { content }.substr( good_size ) };
+        }
+        return count;
+    }
+}
+
+AcctScheduler::AcctScheduler( boost::asio::io_context &i, std::shared_ptr<RadiusServerGroup> g, const AAAConf &c ):
+    group( std::move( g ) ),
+    conf( c ),
+    timer( i )
+{
+    group->setRate( conf.acct_rate );
+    timer.expires_after( tick );
+    timer.async_wait( std::bind( &AcctScheduler::on_tick, this, std::placeholders::_1 ) );
+}
+
+AcctScheduler::~AcctScheduler() {
+    timer.cancel();
+    // Replayed records are still in the replay file
+    for( auto const &rec: urgent ) {
+        if( !rec.replayed ) {
+            spool( rec );
+        }
+    }
+}
+
+std::string AcctScheduler::openSpool() {
+    spool_path = conf.acct_spool;
+    if( spool_path.empty() ) {
+        return {};
+    }
+    size_t good_size;
+    spooled = readSpool( spool_path, nullptr, good_size );
+    std::error_code ec;
+    if( auto size = std::filesystem::file_size( spool_path, ec ); !ec && size != good_size ) {
+        std::filesystem::resize_file( spool_path, good_size, ec );
+    }
+    replay_pending = std::filesystem::exists( spool_path + ".replay", ec );
+    if( spooled == 0 && !replay_pending ) {
+        return {};
+    }
+    return "Accounting spool " + spool_path + " has " + std::to_string( spooled ) + " records" + ( replay_pending ? " and an unfinished replay" : "" );
+}
+
+void AcctScheduler::start( std::shared_ptr<AAA_Session> session, AcctRequest req ) {
+    active.insert_or_assign( session->session_id, Entry { session, clock::now() } );
+    AcctRecord rec { std::move( req ), std::chrono::system_clock::now() };
+    if( urgent.empty() && group->credit() > 0 ) {
+        send( std::move( rec ) );
+    } else {
+        urgent.push_back( std::move( rec ) );
+    }
+}
+
+void AcctScheduler::stop( uint32_t session_id, AcctRequest req ) {
+    active.erase( session_id );
+    AcctRecord rec { std::move( req ), std::chrono::system_clock::now() };
+    if( urgent.empty() && group->credit() > 0 ) {
+        send( std::move( rec ) );
+    } else {
+        urgent.push_back( std::move( rec ) );
+    }
+}
+
+void AcctScheduler::on_tick( const boost::system::error_code &ec ) {
+    if( ec ) {
+        return;
+    }
+    timer.expires_after( tick );
+    timer.async_wait( std::bind( &AcctScheduler::on_tick, this, std::placeholders::_1 ) );
+
+    group->setRate( conf.acct_rate );
+    auto now = clock::now();
+    if( ( spooled > 0 || replay_pending ) && replaying == 0 && now - last_replay >= std::chrono::seconds( std::max<uint32_t>( conf.dead_time, 1 ) ) ) {
+        replay();
+    }
+
+    auto budget = group->credit();
+    while( budget > 0 && !urgent.empty() ) {
+        auto rec = std::move( urgent.front() );
+        urgent.pop_front();
+        send( std::move( rec ) );
+        budget--;
+    }
+
+    if( active.empty() ) {
+        return;
+    }
+    // Credit does not pile up while sessions are too young or the rate limit holds them,
+    // otherwise they would all go out together afterwards
+    auto interval = std::chrono::seconds( std::max<uint32_t>( conf.interim_interval, 1 ) );
+    double quota = active.size() * std::chrono::duration<double>( tick ) / interval;
+    interim_credit = std::min( interim_credit + quota, quota + 1 );
+    for( size_t left = active.size(); left > 0 && interim_credit >= 1 && budget > 0 && !active.empty(); left-- ) {
+        auto it = active.upper_bound( cursor );
+        if( it == active.end() ) {
+            it = active.begin();
+        }
+        cursor = it->first;
+        auto &entry = it->second;
+        if( entry.session.expired() ) {
+            active.erase( it );
+            continue;
+        }
+        if( now - entry.last < interval / 2 ) {
+            continue;
+        }
+        interim_credit -= 1;
+        if( entry.pending ) {
+            // Still waiting for the previous update, this turn is skipped
+            continue;
+        }
+        send_interim( it->first, entry );
+        budget--;
+    }
+}
+
+void AcctScheduler::send( AcctRecord rec ) {
+    auto waited = std::chrono::system_clock::now() - rec.created;
+    rec.req.delay_time = std::max<int64_t>( std::chrono::duration_cast<std::chrono::seconds>( waited ).count(), 0 );
+    auto req = rec.req;
+    group->acct_request( req,
+        [ this, replayed = rec.replayed ]( RADIUS_CODE code, AVPReader avps ) {
+            on_answer( replayed );
+        },
+        [ this, rec = std::move( rec ) ]( std::string err ) {
+            on_failed( std::move( rec ), err );
+        }
+    );
+}
+
+void AcctScheduler::send_interim( uint32_t sid, Entry &entry ) {
+    auto session = entry.session.lock();
+    entry.pending = true;
+    entry.last = clock::now();
+    group->acct_request( session->acctRequest( "Alive" ),
+        [ this, sid ]( RADIUS_CODE code, AVPReader avps ) {
+            if( auto const &it = active.find( sid ); it != active.end() ) {
+                it->second.pending = false;
+            }
+            on_answer( false );
+        },
+        [ this, sid ]( std::string err ) {
+            if( auto const &it = active.find( sid ); it != active.end() ) {
+                it->second.pending = false;
+            }
+            runtime->logger->logError() << LOGS::SESSION << "Failed to send interim update: " << err << std::endl;
+        }
+    );
+}
+
+void AcctScheduler::on_answer( bool replayed ) {
+    if( replayed ) {
+        replay_done();
+    }
+    // A server is answering, time to send what it missed
+    if( ( spooled > 0 || replay_pending ) && replaying == 0 ) {
+        replay();
+    }
+}
+
+void AcctScheduler::on_failed( AcctRecord rec, const std::string &err ) {
+    if( spool( rec ) ) {
+        runtime->logger->logError() << LOGS::SESSION << "Failed to send accounting " << rec.req.acct_status_type << " of " << rec.req.session_id << ": " << err << ", spooled" << std::endl;
+    } else {
+        runtime->logger->logError() << LOGS::SESSION << "Failed to send accounting " << rec.req.acct_status_type << " of " << rec.req.session_id << ": " << err << std::endl;
+    }
+    if( rec.replayed ) {
+        replay_done();
+    }
+}
+
+bool AcctScheduler::spool( const AcctRecord &rec ) {
+    if( spool_path.empty() || spooled >= conf.acct_spool_limit ) {
+        return false;
+    }
+    if( !spool_file.is_open() ) {
+        spool_file.open( spool_path, std::ios::binary | std::ios::app );
+    }
+    spool_file << encode( rec );
+    spool_file.flush();
+    if( !spool_file ) {
+        spool_file.close();
+        return false;
+    }
+    spooled++;
+    return true;
+}
+
+void AcctScheduler::replay() {
+    last_replay = clock::now();
+    auto replay_path = spool_path + ".replay";
+    if( !replay_pending ) {
+        spool_file.close();
+        if( std::rename( spool_path.c_str(), replay_path.c_str() ) != 0 ) {
+            runtime->logger->logError() << LOGS::AAA << "Cannot move accounting spool " << spool_path << " to " << replay_path << std::endl;
+            return;
+        }
+        spooled = 0;
+    }
+    replay_pending = false;
+
+    std::deque<AcctRecord> recs;
+    size_t good_size;
+    readSpool( replay_path, &recs, good_size );
+    runtime->logger->logInfo() << LOGS::AAA << "Sending " << recs.size() << " spooled accounting records again" << std::endl;
+    if( recs.empty() ) {
+        std::remove( replay_path.c_str() );
+        return;
+    }
+    replaying = recs.size();
+    for( auto &rec: recs ) {
+        rec.replayed = true;
+        urgent.push_back( std::move( rec ) );
+    }
+}
+
+void AcctScheduler::replay_done() {
+    if( replaying > 0 && --replaying == 0 ) {
+        std::remove( ( spool_path + ".replay" ).c_str() );
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef ACCT_SCHEDULER_HPP
+#define ACCT_SCHEDULER_HPP
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <boost/asio.hpp>
+
+#include "auth_client.hpp"
+#include "request_response.hpp"
+
+struct AAAConf;
+class AAA_Session;
+class RadiusServerGroup;
+
+// Start or Stop waiting to be sent
+struct AcctRecord {
+    AcctRequest req;
+    // Wall clock, Acct-Delay-Time is counted from it and it survives restarts in the spool
+    std::chrono::system_clock::time_point created;
+    bool replayed { false };
+};
+
+// Sends all accounting of the sessions towards the accounting group. Start and Stop go
+// out first; every session gets one Interim-Update per interim_interval, the sessions are
+// walked in turn so the updates are spread evenly over the interval whatever the session
+// start times were. A session still waiting for its previous update is skipped, the next
+// one carries the counters anyway. Everything is kept within the group rate limit
+class AcctScheduler {
+public:
+    AcctScheduler( boost::asio::io_context &i, std::shared_ptr<RadiusServerGroup> g, const AAAConf &c );
+    ~AcctScheduler();
+
+    // Counts the records left in the spool by a previous run, returns a line for the log
+    std::string openSpool();
+
+    void start( std::shared_ptr<AAA_Session> session, AcctRequest req );
+    void stop( uint32_t session_id, AcctRequest req );
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::weak_ptr<AAA_Session> session;
+        clock::time_point last;
+        bool pending { false };
+    };
+
+    void on_tick( const boost::system::error_code &ec );
+    void send( AcctRecord rec );
+    void send_interim( uint32_t sid, Entry &entry );
+    void on_answer( bool replayed );
+    void on_failed( AcctRecord rec, const std::string &err );
+
+    bool spool( const AcctRecord &rec );
+    void replay();
+    void replay_done();
+
+    std::shared_ptr<RadiusServerGroup> group;
+    const AAAConf &conf;
+    boost::asio::steady_timer timer;
+
+    std::deque<AcctRecord> urgent;
+    std::map<uint32_t,Entry> active;
+    uint32_t cursor { 0 };
+    double interim_credit { 0 };
+
+    std::string spool_path;
+    std::ofstream spool_file;
+    size_t spooled { 0 };
+    // A replay was cut short by a restart, its file is sent before the spool
+    bool replay_pending { false };
+    // Records taken out of the spool and not finished yet
+    size_t replaying { 0 };
+    clock::time_point last_replay {};
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include <algorithm>
+
+#include "admission.hpp"
+#include "runtime.hpp"
+#include "evloop.hpp"
+#include "string_helpers.hpp"
+
+extern std::shared_ptr<PPPOERuntime> runtime;
+
+static const char* state_name( ADMISSION_STATE s ) {
+    switch( s ) {
+    case ADMISSION_STATE::OPEN: return "open";
+    case ADMISSION_STATE::DELAY: return "delay";
+    case ADMISSION_STATE::SHED: return "shed";
+    }
+    return "unknown";
+}
+
+AdmissionControl::AdmissionControl( boost::asio::io_context &i, const AdmissionConf &c ):
+    conf( c ),
+    timer( i )
+{}
+
+void AdmissionControl::update() {
+    auto next = ADMISSION_STATE::OPEN;
+    if( conf.high_water != 0 && ( in_flight >= conf.high_water || ( current == ADMISSION_STATE::SHED && in_flight > lowWater() ) ) ) {
+        next = ADMISSION_STATE::SHED;
+    } else if( conf.pado_delay != 0 && (
+        ( conf.delay_inflight != 0 && in_flight >= conf.delay_inflight ) ||
+        ( conf.delay_latency != 0 && latency_us >= conf.delay_latency * 1000ULL ) ) )
+    {
+        next = ADMISSION_STATE::DELAY;
+    }
+    if( next == current ) {
+        return;
+    }
+    runtime->logger->logInfo() << LOGS::PPPOED << "Admission " << state_name( current ) << " -> " << state_name( next ) <<
+        ": " << in_flight << " authentications in flight, RADIUS latency " << latency_us / 1000 << " ms" << std::endl;
+    current = next;
+    counters.transitions++;
+}
+
+bool AdmissionControl::admitPADI() {
+    update();
+    if( current == ADMISSION_STATE::SHED ) {
+        counters.padi_dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool AdmissionControl::admitPADR() {
+    update();
+    if( current == ADMISSION_STATE::SHED ) {
+        counters.padr_dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool AdmissionControl::hold( std::vector<uint8_t> &pkt ) {
+    if( current != ADMISSION_STATE::DELAY ) {
+        return false;
+    }
+    // The delay is fixed, so the queue stays in the order of deadlines
+    pados.emplace_back( clock::now() + std::chrono::milliseconds( conf.pado_delay ), std::move( pkt ) );
+    counters.pado_delayed++;
+    if( !timer_armed ) {
+        timer_armed = true;
+        timer.expires_at( pados.front().first );
+        timer.async_wait( std::bind( &AdmissionControl::on_timer, this, std::placeholders::_1 ) );
+    }
+    return true;
+}
+
+void AdmissionControl::on_timer( const boost::system::error_code &ec ) {
+    timer_armed = false;
+    if( ec ) {
+        return;
+    }
+    auto now = clock::now();
+    while( !pados.empty() && pados.front().first <= now ) {
+        runtime->pppoe_outcoming.push( std::move( pados.front().second ) );
+        pados.pop_front();
+    }
+    if( !pados.empty() ) {
+        timer_armed = true;
+        timer.expires_at( pados.front().first );
+        timer.async_wait( std::bind( &AdmissionControl::on_timer, this, std::placeholders::_1 ) );
+    }
+}
+
+AdmissionControl::clock::time_point AdmissionControl::authStarted() {
+    in_flight++;
+    counters.auths++;
+    counters.peak_inflight = std::max<uint64_t>( counters.peak_inflight, in_flight );
+    update();
+    return clock::now();
+}
+
+void AdmissionControl::authFinished( clock::time_point started ) {
+    if( in_flight > 0 ) {
+        in_flight--;
+    }
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>( clock::now() - started ).count();
+    latency_us = latency_us == 0 ? us : ( latency_us * 7 + us ) / 8;
+    update();
+}
+
+ADMISSION_STATE AdmissionControl::state() const {
+    return current;
+}
+
+size_t AdmissionControl::inflight() const {
+    return in_flight;
+}
+
+uint64_t AdmissionControl::srtt_us() const {
+    return latency_us;
+}
+
+size_t AdmissionControl::held() const {
+    return pados.size();
+}
+
+uint32_t AdmissionControl::lowWater() const {
+    return conf.low_water != 0 ? conf.low_water : conf.high_water - conf.high_water / 4;
+}
+
+const AdmissionStats& AdmissionControl::stats() const {
+    return counters;
+}
@@ -0,0 +1,68 @@
+#ifndef ADMISSION_HPP
+#define ADMISSION_HPP
+
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <boost/asio.hpp>
+
+struct AdmissionConf;
+
+enum class ADMISSION_STATE: uint8_t {
+    OPEN,
+    // PADO is held back
+    DELAY,
+    // PADI and PADR are not answered
+    SHED
+};
+
+struct AdmissionStats {
+    uint64_t pado_delayed { 0 };
+    uint64_t padi_dropped { 0 };
+    uint64_t padr_dropped { 0 };
+    uint64_t auths { 0 };
+    uint64_t peak_inflight { 0 };
+    uint64_t transitions { 0 };
+};
+
+// Keeps discovery in step with authentication: counts RADIUS authentications in
+// flight and their smoothed latency, and decides from AdmissionConf whether a new
+// client is answered now, later or not at all
+class AdmissionControl {
+public:
+    using clock = std::chrono::steady_clock;
+
+    AdmissionControl( boost::asio::io_context &i, const AdmissionConf &c );
+
+    bool admitPADI();
+    bool admitPADR();
+    // Takes the PADO when it has to wait, it is sent to pppoe_outcoming later
+    bool hold( std::vector<uint8_t> &pkt );
+
+    clock::time_point authStarted();
+    // Failed authentications count too, their latency is the time until giving up
+    void authFinished( clock::time_point started );
+
+    ADMISSION_STATE state() const;
+    size_t inflight() const;
+    uint64_t srtt_us() const;
+    size_t held() const;
+    uint32_t lowWater() const;
+    const AdmissionStats& stats() const;
+
+private:
+    void update();
+    void on_timer( const boost::system::error_code &ec );
+
+    const AdmissionConf &conf;
+    boost::asio::steady_timer timer;
+    bool timer_armed { false };
+
+    ADMISSION_STATE current { ADMISSION_STATE::OPEN };
+    size_t in_flight { 0 };
+    uint64_t latency_us { 0 };
+    std::deque<std::pair<clock::time_point,std::vector<uint8_t>>> pados;
+    AdmissionStats counters;
+};
+
+#endif
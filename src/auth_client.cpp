@@ -1,5 +1,6 @@
 #include <set>
 #include <iostream>
+#include <cstring>
 
 #include "auth_client.hpp"
 #include "utils.hpp"
@@ -12,98 +13,364 @@
 
 extern std::shared_ptr<PPPOERuntime> runtime;
 
-std::string acct_auth_process( const std::vector<uint8_t> &pkt, const std::vector<uint8_t> req_attrs, const std::string &secret ) {
-    std::string check { pkt.begin(), pkt.begin() + 4 };
-    check.reserve( 128 );
-    check.insert( check.end(), 16, 0 );
-    check.insert( check.end(), req_attrs.begin(), req_attrs.end() );
-    check.insert( check.end(), secret.begin(), secret.end() );
-    return md5( check );
+RadiusSource::RadiusSource( io_service &io ):
+    socket( io, boost::asio::ip::udp::endpoint( boost::asio::ip::udp::v4(), 0 ) )
+{
+    for( int id = 0; id <= UINT8_MAX; id++ ) {
+        free_ids.push_back( id );
+    }
 }
 
-AuthClient::AuthClient( io_service& i, const address_v4_t& ip_address, uint16_t port, std::string s, RadiusDict d ): 
+AuthClient::AuthClient( io_service& i, const address_v4_t& ip_address, uint16_t port, std::string s, std::shared_ptr<const RadiusDict> d, uint16_t max_s, RadiusRetransmitConf rc ): 
     io( i ), 
-    socket( i, boost::asio::ip::udp::endpoint( boost::asio::ip::udp::v4(), 0 ) ),
+    max_sources( std::max<uint16_t>( max_s, 1 ) ),
     endpoint( ip_address, port ),
+    retransmit( rc ),
+    timer( i ),
     secret( std::move( s )),
-    dict( std::move( d ) ),
-    last_id( 0 )
-{}
+    dict( std::move( d ) )
+{
+    for( size_t i = 0; i < RADIUS_RX_BATCH; i++ ) {
+        rx_iovs[ i ] = { rx_bufs[ i ].data(), rx_bufs[ i ].size() };
+    }
+    sources.push_back( std::make_unique<RadiusSource>( io ) );
+    receive( 0 );
+}
 
 AuthClient::~AuthClient()
 {
-	socket.close();
+    timer.cancel();
+    for( auto &src: sources ) {
+        src->socket.close();
+    }
 }
 
-void AuthClient::send( const std::vector<uint8_t> &msg ) {
-	socket.send_to( boost::asio::buffer( msg, msg.size() ), endpoint );
-    receive();
+std::optional<uint32_t> AuthClient::allocate_id() {
+    // Spread requests over source ports we already have
+    for( size_t i = 0; i < sources.size(); i++ ) {
+        auto idx = ( next_source + i ) % sources.size();
+        auto &free_ids = sources[ idx ]->free_ids;
+        if( !free_ids.empty() ) {
+            uint32_t id = free_ids.front();
+            free_ids.pop_front();
+            next_source = idx + 1;
+            return ( idx << 8 ) | id;
+        }
+    }
+    // All identifiers are in use, open one more source port
+    if( sources.size() >= max_sources ) {
+        runtime->logger->logError() << LOGS::RADIUS << "All " << sources.size() * 256 << " RADIUS identifiers are in use" << std::endl;
+        return std::nullopt;
+    }
+    if( !open_source() ) {
+        return std::nullopt;
+    }
+    return allocate_id();
 }
 
-void AuthClient::receive() {
-    socket.async_receive_from( boost::asio::buffer( buf, buf.size() ), endpoint, std::bind( &AuthClient::on_rcv, this, std::placeholders::_1, std::placeholders::_2 ) );
+bool AuthClient::open_source() {
+    try {
+        sources.push_back( std::make_unique<RadiusSource>( io ) );
+    } catch( const boost::system::system_error &e ) {
+        runtime->logger->logError() << LOGS::RADIUS << "Cannot open RADIUS source port: " << e.what() << std::endl;
+        return false;
+    }
+    runtime->logger->logInfo() << LOGS::RADIUS << "Opened RADIUS source port #" << sources.size() << " to " << endpoint << std::endl;
+    receive( sources.size() - 1 );
+    return true;
 }
 
-// Incoming packet should be in buf
-bool AuthClient::checkRadiusAnswer( const authenticator_t &req_auth, const authenticator_t &res_auth, const std::vector<uint8_t> &avp ) {
-    std::string check { buf.begin(), buf.begin() + 4 };
-    check.reserve( 128 );
-    check.insert( check.end(), req_auth.begin(), req_auth.end() );
-    check.insert( check.end(), avp.begin(), avp.end() );
-    check.insert( check.end(), secret.begin(), secret.end() );
-    auto hash_str = md5( check );
-    std::vector<uint8_t> hash_to_check{ hash_str.begin(), hash_str.end() };
+void AuthClient::release_id( uint32_t key ) {
+    sources[ key >> 8 ]->free_ids.push_back( key & 0xFF );
+}
 
-    if( std::equal( res_auth.begin(), res_auth.end(), hash_to_check.begin() ) ) {
-        return true;
-    } 
-    return false;
+void AuthClient::track( uint32_t key, ResponseHandler handler, FailureHandler error, const AVPWriter &avp ) {
+    auto len = sizeof( RadiusPacket ) + avp.size();
+    auto auth = reinterpret_cast<const RadiusPacket*>( tx_buf.data() )->authenticator;
+    auto const &[ it, success ] = callbacks.emplace( 
+        std::piecewise_construct, 
+        std::forward_as_tuple( key ), 
+        std::forward_as_tuple( std::move( handler ), std::move( error ), auth, std::vector<uint8_t>{ tx_buf.begin(), tx_buf.begin() + len }, next_seq++ ) 
+    );
+    if( avp.password_length() > 0 ) {
+        it->second.password_offset = sizeof( RadiusPacket ) + avp.password_offset();
+        it->second.password_length = avp.password_length();
+    }
+    tx_queue.push_back( key );
+    if( !flush_posted ) {
+        flush_posted = true;
+        boost::asio::post( io, std::bind( &AuthClient::flush, this ) );
+    }
 }
 
-void AuthClient::on_rcv( boost::system::error_code ec, size_t size ) {
-    if( ec ) {
-        runtime->logger->logError() << LOGS::RADIUS << "Socket error: " << ec.message() << std::endl;
+// Digests of all the requests queued since the last flush are computed in one md5_batch() per step:
+// Accounting-Request authenticators (RFC 2866 3) and User-Password hiding (RFC 2865 5.2), where
+// every further 16 bytes of a password depend on the previous ones
+void AuthClient::flush() {
+    flush_posted = false;
+    std::vector<uint32_t> keys;
+    keys.swap( tx_queue );
+
+    std::vector<response_t*> reqs;
+    reqs.reserve( keys.size() );
+    for( auto key: keys ) {
+        reqs.push_back( &callbacks.at( key ) );
+    }
+    md5_out.resize( reqs.size() );
+
+    auto view = []( const uint8_t *p, size_t len ) {
+        return std::string_view { reinterpret_cast<const char*>( p ), len };
+    };
+
+    md5_jobs.clear();
+    for( size_t i = 0; i < reqs.size(); i++ ) {
+        auto &r = *reqs[ i ];
+        if( reinterpret_cast<const RadiusPacket*>( r.pkt.data() )->code == RADIUS_CODE::ACCOUNTING_REQUEST ) {
+            md5_jobs.push_back( { { view( r.pkt.data(), r.pkt.size() ), secret }, md5_out[ i ] } );
+        } else if( r.password_length > 0 ) {
+            md5_jobs.push_back( { { secret, view( r.auth.data(), r.auth.size() ) }, md5_out[ i ] } );
+        }
+    }
+    md5_batch( md5_jobs.data(), md5_jobs.size() );
+
+    for( size_t i = 0; i < reqs.size(); i++ ) {
+        auto &r = *reqs[ i ];
+        auto pkt_hdr = reinterpret_cast<RadiusPacket*>( r.pkt.data() );
+        if( pkt_hdr->code == RADIUS_CODE::ACCOUNTING_REQUEST ) {
+            pkt_hdr->authenticator = md5_out[ i ];
+            r.auth = md5_out[ i ];
+        }
+    }
+
+    for( size_t block = 0; ; block += 16 ) {
+        md5_jobs.clear();
+        for( size_t i = 0; i < reqs.size(); i++ ) {
+            auto &r = *reqs[ i ];
+            if( r.password_length <= block ) {
+                continue;
+            }
+            auto p = r.pkt.data() + r.password_offset + block;
+            for( size_t j = 0; j < 16; j++ ) {
+                p[ j ] ^= md5_out[ i ][ j ];
+            }
+            if( r.password_length > block + 16 ) {
+                md5_jobs.push_back( { { secret, view( p, 16 ) }, md5_out[ i ] } );
+            }
+        }
+        if( md5_jobs.empty() ) {
+            break;
+        }
+        md5_batch( md5_jobs.data(), md5_jobs.size() );
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for( size_t i = 0; i < reqs.size(); i++ ) {
+        auto &r = *reqs[ i ];
+        r.sent = now;
+        r.deadline = r.sent + retransmit.deadline;
+        r.rto = retransmit.initial;
+        r.next_event = std::min( r.sent + r.rto, r.deadline );
+        counters.requests++;
+        send( keys[ i ], r.pkt );
+        schedule( keys[ i ], r );
+    }
+}
+
+void AuthClient::schedule( uint32_t key, const response_t &r ) {
+    timers.push( { r.next_event, key, r.seq } );
+    if( !timer_armed.has_value() || r.next_event < *timer_armed ) {
+        arm_timer();
+    }
+}
+
+void AuthClient::arm_timer() {
+    if( timers.empty() ) {
+        timer_armed.reset();
         return;
     }
+    timer_armed = timers.top().when;
+    timer.expires_at( *timer_armed );
+    timer.async_wait( std::bind( &AuthClient::on_timer, this, std::placeholders::_1 ) );
+}
 
-    auto pkt = reinterpret_cast<RadiusPacket*>( buf.data() );
-    
-    auto const &it = callbacks.find( pkt->id );
-    if( it == callbacks.end() ) {
-        // 收到未请求的 RADIUS 包，忽略（可能是延迟的响应或其他进程的请求）
+void AuthClient::on_timer( boost::system::error_code ec ) {
+    if( ec ) {
+        if( ec != boost::asio::error::operation_aborted ) {
+            runtime->logger->logError() << LOGS::RADIUS << "Error on retransmission timer: " << ec.message() << std::endl;
+        }
+        // Aborted waits were replaced by an earlier one
         return;
     }
-    
-    // 只在有对应请求时才打印日志
-    runtime->logger->logInfo() << LOGS::RADIUS << pkt << std::endl;
-    auto &auth_authenticator = it->second.auth;
 
-    std::vector<uint8_t> avp_buf { buf.begin() + sizeof( RadiusPacket ), buf.begin() + pkt->length.native() };
+    auto now = std::chrono::steady_clock::now();
+    while( !timers.empty() && timers.top().when <= now ) {
+        auto entry = timers.top();
+        timers.pop();
+        auto it = callbacks.find( entry.key );
+        if( it == callbacks.end() || it->second.seq != entry.seq ) {
+            continue;
+        }
+        auto &r = it->second;
+        if( now >= r.deadline || r.retransmits >= retransmit.max_retransmits ) {
+            if( now < r.deadline ) {
+                // Out of retransmissions, wait for the answer until the deadline
+                r.next_event = r.deadline;
+                timers.push( { r.next_event, entry.key, r.seq } );
+                continue;
+            }
+            counters.timeouts++;
+            auto error = std::move( r.error );
+            callbacks.erase( it );
+            release_id( entry.key );
+            error( RADIUS_FAILURE::TIMEOUT, "Timeout for this radius request" );
+            continue;
+        }
+        r.retransmits++;
+        counters.retransmits++;
+        send( entry.key, r.pkt );
+        r.rto *= 2;
+        r.next_event = std::min( now + r.rto, r.deadline );
+        timers.push( { r.next_event, entry.key, r.seq } );
+    }
+    arm_timer();
+}
+
+size_t AuthClient::outstanding() const {
+    return callbacks.size();
+}
 
-    if( !checkRadiusAnswer( it->second.auth, pkt->authenticator, avp_buf ) ) {
-        runtime->logger->logError() << LOGS::RADIUS << "Answer is not correct, check the RADIUS secret" << std::endl;
-        return;
+const RadiusServerStats& AuthClient::stats() const {
+    return counters;
+}
+
+const boost::asio::ip::udp::endpoint& AuthClient::server() const {
+    return endpoint;
+}
+
+void AuthClient::send( uint32_t key, const std::vector<uint8_t> &msg ) {
+    boost::system::error_code ec;
+    sources[ key >> 8 ]->socket.send_to( boost::asio::buffer( msg, msg.size() ), endpoint, 0, ec );
+    if( ec ) {
+        runtime->logger->logError() << LOGS::RADIUS << "Cannot send request to " << endpoint << ": " << ec.message() << std::endl;
     }
+}
 
-    it->second.response( pkt->code, std::move( avp_buf ) );
-    it->second.timer.cancel();
+// Every source socket has exactly one wait armed for its whole life, answers are read by on_readable()
+void AuthClient::receive( size_t src ) {
+    sources[ src ]->socket.async_wait( boost::asio::ip::udp::socket::wait_read, std::bind( &AuthClient::on_readable, this, std::placeholders::_1, src ) );
 }
 
-void AuthClient::expire_check( boost::system::error_code ec, uint8_t id ) {
-    auto const &it = callbacks.find( id );
+void AuthClient::on_readable( boost::system::error_code ec, size_t src ) {
     if( ec ) {
-        if( ec != boost::system::errc::operation_canceled ) {
-            runtime->logger->logError() << LOGS::RADIUS << "Error on expiring timer: " << ec.message() << std::endl;
+        // Aborted only when the socket is closed, otherwise the source must keep receiving
+        if( ec != boost::asio::error::operation_aborted ) {
+            runtime->logger->logError() << LOGS::RADIUS << "Socket error: " << ec.message() << std::endl;
+            receive( src );
+        }
+        return;
+    }
+
+    auto fd = sources[ src ]->socket.native_handle();
+    while( true ) {
+        for( size_t i = 0; i < RADIUS_RX_BATCH; i++ ) {
+            rx_msgs[ i ] = {};
+            rx_msgs[ i ].msg_hdr.msg_iov = &rx_iovs[ i ];
+            rx_msgs[ i ].msg_hdr.msg_iovlen = 1;
+        }
+        auto n = recvmmsg( fd, rx_msgs.data(), RADIUS_RX_BATCH, MSG_DONTWAIT, nullptr );
+        if( n < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            if( errno != EAGAIN && errno != EWOULDBLOCK ) {
+                runtime->logger->logError() << LOGS::RADIUS << "Cannot receive from " << endpoint << ": " << strerror( errno ) << std::endl;
+            }
+            break;
         }
-    } else {
-        if( it != callbacks.end() ) {
-            it->second.error( "Timeout for this radius request" );
+        // Authenticators of the whole batch are checked with one md5_batch()
+        md5_jobs.clear();
+        for( int i = 0; i < n; i++ ) {
+            auto &check = rx_checks[ i ];
+            check.ok = false;
+            if( rx_msgs[ i ].msg_hdr.msg_flags & MSG_TRUNC ) {
+                counters.dropped++;
+                continue;
+            }
+            auto pkt = reinterpret_cast<const RadiusPacket*>( rx_bufs[ i ].data() );
+            size_t size = rx_msgs[ i ].msg_len;
+            if( size < sizeof( RadiusPacket ) || pkt->length.native() < sizeof( RadiusPacket ) || pkt->length.native() > size ) {
+                runtime->logger->logError() << LOGS::RADIUS << "Dropping malformed RADIUS packet of " << size << " bytes" << std::endl;
+                counters.dropped++;
+                continue;
+            }
+            auto const &it = callbacks.find( ( src << 8 ) | pkt->id );
+            if( it == callbacks.end() ) {
+                // 收到未请求的 RADIUS 包，忽略（可能是延迟的响应或其他进程的请求）
+                counters.dropped++;
+                continue;
+            }
+            check.ok = true;
+            check.seq = it->second.seq;
+            // Bytes after the RADIUS length are padding and are not covered by the authenticator
+            md5_jobs.push_back( answerDigest( rx_bufs[ i ].data(), pkt->length.native(), it->second.auth, check.digest ) );
         }
+        md5_batch( md5_jobs.data(), md5_jobs.size() );
+        for( int i = 0; i < n; i++ ) {
+            if( rx_checks[ i ].ok ) {
+                on_rcv( src, rx_bufs[ i ].data(), rx_checks[ i ] );
+            }
+        }
+        if( static_cast<size_t>( n ) < RADIUS_RX_BATCH ) {
+            break;
+        }
+    }
+    receive( src );
+}
+
+// Response Authenticator from RFC 2865 3: MD5 over the answer with the request authenticator in place
+Md5Job AuthClient::answerDigest( const uint8_t *pkt, size_t len, const authenticator_t &req_auth, authenticator_t &out ) {
+    auto hdr = reinterpret_cast<const char*>( pkt );
+    return { {
+        { hdr, 4 },
+        { reinterpret_cast<const char*>( req_auth.data() ), req_auth.size() },
+        { hdr + sizeof( RadiusPacket ), len - sizeof( RadiusPacket ) },
+        secret
+    }, out };
+}
+
+void AuthClient::on_rcv( size_t src, const uint8_t *buf, const RadiusRxCheck &check ) {
+    auto pkt = reinterpret_cast<const RadiusPacket*>( buf );
+    auto key = ( src << 8 ) | pkt->id;
+
+    // An earlier answer of the same batch may have completed the request and a new one took the id
+    auto const &it = callbacks.find( key );
+    if( it == callbacks.end() || it->second.seq != check.seq ) {
+        counters.dropped++;
+        return;
     }
-    if( it != callbacks.end() ) {
-        callbacks.erase( it );
+    
+    // 只在有对应请求时才打印日志
+    runtime->logger->logInfo() << LOGS::RADIUS << pkt << std::endl;
+
+    if( !std::equal( check.digest.begin(), check.digest.end(), pkt->authenticator.begin() ) ) {
+        runtime->logger->logError() << LOGS::RADIUS << "Answer is not correct, check the RADIUS secret" << std::endl;
+        counters.dropped++;
+        return;
     }
-    if( callbacks.empty() ) {
-        socket.cancel();
+
+    size_t len = pkt->length.native();
+    AVPReader avps { buf + sizeof( RadiusPacket ), len - sizeof( RadiusPacket ) };
+    if( !avps.valid() ) {
+        runtime->logger->logError() << LOGS::RADIUS << "Dropping RADIUS answer with malformed attributes" << std::endl;
+        counters.dropped++;
+        return;
     }
-}
\ No newline at end of file
+
+    counters.replies++;
+    counters.latency_us.record( std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - it->second.sent ).count() );
+
+    auto response = std::move( it->second.response );
+    callbacks.erase( it );
+    release_id( key );
+    response( pkt->code, avps );
+}
@@ -2,6 +2,10 @@
 #define AUTH_CLIENT_HPP
 
 #include <map>
+#include <deque>
+#include <queue>
+#include <optional>
+#include <sys/socket.h>
 #include <boost/asio.hpp>
 
 using io_service = boost::asio::io_service;
@@ -9,113 +13,200 @@ using address_v4_t = boost::asio::ip::address_v4;
 using network_v4_t = boost::asio::ip::network_v4;
 
 #include "log.hpp"
+#include "histogram.hpp"
 #include "radius_packet.hpp"
 #include "radius_dict.hpp"
+#include "radius_avp.hpp"
+#include "request_response.hpp"
+#include "md5.hpp"
 
 class RadiusDict;
 
-using ResponseHandler = std::function<void( RADIUS_CODE, std::vector<uint8_t> )>;
+// Attributes of the answer are only valid until the handler returns
+using ResponseHandler = std::function<void( RADIUS_CODE, AVPReader )>;
 using ErrorHandler = std::function<void( std::string )>;
 
+// Only a timeout tells something about the server, the others fail before sending
+enum class RADIUS_FAILURE: uint8_t {
+    TIMEOUT,
+    // No free identifier on this client
+    BUSY,
+    // Request does not fit into a packet, on any server
+    ENCODING
+};
+using FailureHandler = std::function<void( RADIUS_FAILURE, std::string )>;
+
 struct response_t {
     ResponseHandler response;
-    ErrorHandler error;
-    boost::asio::steady_timer timer;
+    FailureHandler error;
     authenticator_t auth;
-
-    response_t( io_service &io, ResponseHandler r, ErrorHandler t, authenticator_t a ):
+    // Retransmissions are byte for byte copies, so the server can detect duplicates
+    std::vector<uint8_t> pkt;
+    uint64_t seq;
+    std::chrono::steady_clock::time_point sent { std::chrono::steady_clock::now() };
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::time_point next_event;
+    std::chrono::milliseconds rto;
+    uint32_t retransmits { 0 };
+    // User-Password value inside pkt, hidden when the request is flushed
+    size_t password_offset { 0 };
+    size_t password_length { 0 };
+
+    response_t( ResponseHandler r, FailureHandler t, authenticator_t a, std::vector<uint8_t> p, uint64_t s ):
         response( std::move( r ) ),
         error( std::move( t ) ),
-        timer( io ),
-        auth( std::move( a ) )
+        auth( std::move( a ) ),
+        pkt( std::move( p ) ),
+        seq( s )
     {}
 };
 
-std::string acct_auth_process( const std::vector<uint8_t> &pkt, const std::vector<uint8_t> req_attrs, const std::string &secret );
+struct RadiusRetransmitConf {
+    // First retransmission after initial, then the interval doubles
+    std::chrono::milliseconds initial { 1000 };
+    uint32_t max_retransmits { 3 };
+    // Request fails when there is no answer after deadline, counting from the first send
+    std::chrono::milliseconds deadline { 5000 };
+};
+
+// Pending retransmission or expiry. Entries are never removed from the heap, they are
+// skipped when seq does not match the request any more
+struct RadiusTimerEntry {
+    std::chrono::steady_clock::time_point when;
+    uint32_t key;
+    uint64_t seq;
+
+    bool operator>( const RadiusTimerEntry &rhs ) const {
+        return when > rhs.when;
+    }
+};
+
+// One source port: RADIUS identifier is 8 bits, so each port can have 256 requests in flight
+struct RadiusSource {
+    boost::asio::ip::udp::socket socket;
+    // Identifiers are reused in FIFO order, so a late answer is unlikely to match a new request
+    std::deque<uint8_t> free_ids;
+
+    RadiusSource( io_service &io );
+};
+
+struct RadiusServerStats {
+    uint64_t requests { 0 };
+    uint64_t replies { 0 };
+    uint64_t retransmits { 0 };
+    uint64_t timeouts { 0 };
+    // Malformed, unexpected or not authenticated answers
+    uint64_t dropped { 0 };
+    Histogram latency_us;
+};
+
+// Answer of a receive batch which matched a request, its digest is computed with the rest of the batch
+struct RadiusRxCheck {
+    bool ok { false };
+    uint64_t seq { 0 };
+    authenticator_t digest;
+};
+
+// Datagrams taken from a socket with one recvmmsg() call
+inline constexpr size_t RADIUS_RX_BATCH { 16 };
+inline constexpr size_t RADIUS_MAX_PACKET { 4096 };
 
 class AuthClient
 {
 public:
-	AuthClient( io_service &i, const address_v4_t &ip_address, uint16_t port, std::string s, RadiusDict d );
+	AuthClient( io_service &i, const address_v4_t &ip_address, uint16_t port, std::string s, std::shared_ptr<const RadiusDict> d, uint16_t max_sources = 1, RadiusRetransmitConf rc = {} );
 	~AuthClient();
 
     template<typename T>
-    void request( const T &req, ResponseHandler handler, ErrorHandler error ) {
-        last_id++;
-        std::vector<uint8_t> pkt;
-        pkt.resize( sizeof( RadiusPacket ) );
-        auto pkt_hdr = reinterpret_cast<RadiusPacket*>( pkt.data() );
-        pkt_hdr->code = RADIUS_CODE::ACCESS_REQUEST;
-        pkt_hdr->id = last_id;
-        pkt_hdr->authenticator = generateAuthenticator();
-
-        auto seravp = serialize( dict, req, pkt_hdr->authenticator, secret );
-        pkt.insert( pkt.end(), seravp.begin(), seravp.end() );
-
-        pkt_hdr = reinterpret_cast<RadiusPacket*>( pkt.data() );
-        pkt_hdr->length = pkt.size();
-
-        if( auto const &[ it, success ] = callbacks.emplace( 
-            std::piecewise_construct, 
-            std::forward_as_tuple( last_id ), 
-            std::forward_as_tuple( io, std::move( handler ), std::move( error ), pkt_hdr->authenticator ) 
-        ); success ) {
-            it->second.timer.expires_from_now( std::chrono::seconds( 5 ) );
-            it->second.timer.async_wait( std::bind( &AuthClient::expire_check, this, std::placeholders::_1, last_id ) );
-        } else {
-            // todo: err handling
-            return;
-        }
-        send( pkt );
+    void request( const T &req, ResponseHandler handler, FailureHandler error ) {
+        enqueue( RADIUS_CODE::ACCESS_REQUEST, req, std::move( handler ), std::move( error ) );
+    }
+
+    template<typename T>
+    void acct_request( const T &req, ResponseHandler handler, FailureHandler error ) {
+        enqueue( RADIUS_CODE::ACCOUNTING_REQUEST, req, std::move( handler ), std::move( error ) );
     }
 
+    size_t outstanding() const;
+    const RadiusServerStats& stats() const;
+    const boost::asio::ip::udp::endpoint& server() const;
+
+private:
+    // Encodes the request, authenticator digests and password hiding are left to flush()
     template<typename T>
-    void acct_request( const T &req, ResponseHandler handler, ErrorHandler error ) {
-        last_id++;
-        std::vector<uint8_t> pkt;
-        pkt.resize( sizeof( RadiusPacket ) );
-        auto pkt_hdr = reinterpret_cast<RadiusPacket*>( pkt.data() );
-        pkt_hdr->code = RADIUS_CODE::ACCOUNTING_REQUEST;
-        pkt_hdr->id = last_id;
-
-        auto seravp = serialize( dict, req, pkt_hdr->authenticator, secret );
-        pkt.insert( pkt.end(), seravp.begin(), seravp.end() );
-
-        pkt_hdr = reinterpret_cast<RadiusPacket*>( pkt.data() );
-        pkt_hdr->length = pkt.size();
-
-        auto temp = acct_auth_process( pkt, seravp, secret );
-        std::copy( temp.begin(), temp.end(), pkt_hdr->authenticator.begin() );
-
-        if( auto const &[ it, success ] = callbacks.emplace( 
-            std::piecewise_construct, 
-            std::forward_as_tuple( last_id ), 
-            std::forward_as_tuple( io, std::move( handler ), std::move( error ), pkt_hdr->authenticator ) 
-        ); success ) {
-            it->second.timer.expires_from_now( std::chrono::seconds( 5 ) );
-            it->second.timer.async_wait( std::bind( &AuthClient::expire_check, this, std::placeholders::_1, last_id ) );
+    void enqueue( RADIUS_CODE code, const T &req, ResponseHandler handler, FailureHandler error ) {
+        auto key = allocate_id();
+        if( !key.has_value() ) {
+            boost::asio::post( io, std::bind( std::move( error ), RADIUS_FAILURE::BUSY, "Too many outstanding RADIUS requests" ) );
+            return;
+        }
+        auto pkt_hdr = reinterpret_cast<RadiusPacket*>( tx_buf.data() );
+        pkt_hdr->code = code;
+        pkt_hdr->id = *key & 0xFF;
+        if( code == RADIUS_CODE::ACCESS_REQUEST ) {
+            pkt_hdr->authenticator = generateAuthenticator();
         } else {
-            // todo: err handling
+            pkt_hdr->authenticator.fill( 0 );
+        }
+
+        AVPWriter avp { tx_buf.data() + sizeof( RadiusPacket ), tx_buf.size() - sizeof( RadiusPacket ) };
+        serialize( *dict, req, avp );
+        if( !avp.ok() ) {
+            release_id( *key );
+            boost::asio::post( io, std::bind( std::move( error ), RADIUS_FAILURE::ENCODING, "RADIUS request does not fit into a packet" ) );
             return;
         }
-        send( pkt );
+        pkt_hdr->length = sizeof( RadiusPacket ) + avp.size();
+
+        track( *key, std::move( handler ), std::move( error ), avp );
     }
 
-private:
-    void expire_check( boost::system::error_code ec, uint8_t id );
-    void on_rcv( boost::system::error_code ec, size_t size );
-    bool checkRadiusAnswer( const authenticator_t &req_auth, const authenticator_t &res_auth, const std::vector<uint8_t> &avp );
-	void send( const std::vector<uint8_t> &msg );
-    void receive();
-
-    uint8_t last_id;
-    RadiusDict dict;
+    // Request key: source index in upper bits, RADIUS identifier in lower 8 bits
+    std::optional<uint32_t> allocate_id();
+    void release_id( uint32_t key );
+    // Takes the request just encoded into tx_buf and queues it for flush()
+    void track( uint32_t key, ResponseHandler handler, FailureHandler error, const AVPWriter &avp );
+    void flush();
+    void schedule( uint32_t key, const response_t &r );
+    void arm_timer();
+    void on_timer( boost::system::error_code ec );
+    void on_readable( boost::system::error_code ec, size_t src );
+    void on_rcv( size_t src, const uint8_t *buf, const RadiusRxCheck &check );
+    Md5Job answerDigest( const uint8_t *pkt, size_t len, const authenticator_t &req_auth, authenticator_t &out );
+	void send( uint32_t key, const std::vector<uint8_t> &msg );
+    void receive( size_t src );
+    bool open_source();
+
+    std::shared_ptr<const RadiusDict> dict;
     std::string secret;
-    std::map<uint8_t,response_t> callbacks;
-    std::array<uint8_t,1500> buf;
+    std::map<uint32_t,response_t> callbacks;
 	io_service &io;
-	boost::asio::ip::udp::socket socket;
+    std::vector<std::unique_ptr<RadiusSource>> sources;
+    size_t max_sources;
+    size_t next_source { 0 };
 	boost::asio::ip::udp::endpoint endpoint;
+    RadiusServerStats counters;
+    RadiusRetransmitConf retransmit;
+
+    // One timer for all requests of this server, armed for the earliest heap entry
+    boost::asio::steady_timer timer;
+    std::optional<std::chrono::steady_clock::time_point> timer_armed;
+    std::priority_queue<RadiusTimerEntry,std::vector<RadiusTimerEntry>,std::greater<>> timers;
+    uint64_t next_seq { 0 };
+
+    // Requests are encoded here, then copied once into the retransmission buffer of the request
+    std::array<uint8_t,RADIUS_MAX_PACKET> tx_buf;
+    // Requests encoded during this loop turn, hashed together and sent by flush()
+    std::vector<uint32_t> tx_queue;
+    bool flush_posted { false };
+    std::vector<Md5Job> md5_jobs;
+    std::vector<authenticator_t> md5_out;
+
+    // Receive batch, shared by all sources as answers are processed one socket at a time
+    std::array<std::array<uint8_t,RADIUS_MAX_PACKET>,RADIUS_RX_BATCH> rx_bufs;
+    std::array<iovec,RADIUS_RX_BATCH> rx_iovs;
+    std::array<mmsghdr,RADIUS_RX_BATCH> rx_msgs;
+    std::array<RadiusRxCheck,RADIUS_RX_BATCH> rx_checks;
 };
 
 #endif
\ No newline at end of file
@@ -14,11 +14,31 @@ using network_v4_t = boost::asio::ip::network_v4;
 #include "runtime.hpp"
 #include "string_helpers.hpp"
 #include "vpp_types.hpp"
-#include "vpp.hpp"
+#include "dp_backend.hpp"
 #include "aaa_session.hpp"
+#include "aaa.hpp"
+#include "admission.hpp"
+#include "coa_server.hpp"
 
 extern std::shared_ptr<PPPOERuntime> runtime;
 
+static HISTOGRAM_DUMP dump_histogram( const std::string &name, const Histogram &h ) {
+    return { name, h.count(), h.mean(), h.percentile( 50 ), h.percentile( 90 ), h.percentile( 99 ), h.max() };
+}
+
+static void dump_radius_servers( std::vector<RADIUS_SERVER_DUMP> &out, const std::string &type, const RadiusServerGroup &group ) {
+    auto now = std::chrono::steady_clock::now();
+    for( auto const &s: group.members() ) {
+        auto const &stats = s.client->stats();
+        std::ostringstream address;
+        address << s.client->server();
+        out.push_back( { 
+            s.name, type, address.str(), s.dead( now ), s.weight, s.effective_weight, s.srtt_us, s.failovers,
+            s.client->outstanding(), stats.requests, stats.replies, stats.retransmits, stats.timeouts, stats.dropped, dump_histogram( "latency_us", stats.latency_us )
+        } );
+    }
+}
+
 CLIServer::CLIServer( boost::asio::io_context &io_context, const std::string &path ): 
     acceptor_( io_context, stream_protocol::endpoint( path ) )
 {
@@ -92,6 +112,79 @@ void CLISession::run_cmd( const std::string &cmd ) {
         out_msg.data = serialize( resp );
         break;
     }
+    case CLI_CMD::GET_VPP_STATUS: {
+        GET_VPP_STATUS_RESP resp;
+        resp.connected = runtime->vpp->connected();
+        resp.dataplane_epoch = runtime->dataplane_epoch;
+        resp.replays = runtime->replay.count;
+        resp.replay_in_progress = runtime->replay.in_progress;
+        resp.replay_sessions = runtime->replay.sessions;
+        resp.replay_failed = runtime->replay.failed;
+        resp.replay_duration_ms = runtime->replay.duration.count();
+        out_msg.data = serialize( resp );
+        break;
+    }
+    case CLI_CMD::GET_VPP_API_STATS: {
+        GET_VPP_API_STATS_RESP resp;
+        auto stats = runtime->vpp->api_stats();
+        resp.queue_depth = dump_histogram( "queue_depth", stats.queue_depth );
+        for( auto const &[ name, h ]: stats.latency_us ) {
+            resp.latency_us.push_back( dump_histogram( name, h ) );
+        }
+        out_msg.data = serialize( resp );
+        break;
+    }
+    case CLI_CMD::GET_RADIUS_SERVERS: {
+        GET_RADIUS_SERVERS_RESP resp;
+        dump_radius_servers( resp.servers, "auth", runtime->aaa->authServers() );
+        dump_radius_servers( resp.servers, "acct", runtime->aaa->acctServers() );
+        out_msg.data = serialize( resp );
+        break;
+    }
+    case CLI_CMD::GET_ADMISSION: {
+        GET_ADMISSION_RESP resp;
+        auto const &adm = *runtime->admission;
+        auto const &stats = adm.stats();
+        auto const &conf = runtime->conf.admission;
+        switch( adm.state() ) {
+        case ADMISSION_STATE::OPEN: resp.state = "open"; break;
+        case ADMISSION_STATE::DELAY: resp.state = "delay"; break;
+        case ADMISSION_STATE::SHED: resp.state = "shed"; break;
+        }
+        resp.inflight = adm.inflight();
+        resp.peak_inflight = stats.peak_inflight;
+        resp.srtt_us = adm.srtt_us();
+        resp.held = adm.held();
+        resp.auths = stats.auths;
+        resp.pado_delayed = stats.pado_delayed;
+        resp.padi_dropped = stats.padi_dropped;
+        resp.padr_dropped = stats.padr_dropped;
+        resp.transitions = stats.transitions;
+        resp.pado_delay = conf.pado_delay;
+        resp.delay_inflight = conf.delay_inflight;
+        resp.delay_latency = conf.delay_latency;
+        resp.high_water = conf.high_water;
+        resp.low_water = adm.lowWater();
+        out_msg.data = serialize( resp );
+        break;
+    }
+    case CLI_CMD::GET_COA: {
+        GET_COA_RESP resp {};
+        resp.listening = runtime->coa != nullptr;
+        resp.port = runtime->conf.aaa_conf.coa_port;
+        resp.clients = runtime->conf.aaa_conf.coa_clients.size();
+        if( runtime->coa ) {
+            auto const &stats = runtime->coa->stats();
+            resp.requests = stats.requests;
+            resp.duplicates = stats.duplicates;
+            resp.naks = stats.naks;
+            resp.dropped = stats.dropped;
+            resp.disconnected = stats.disconnected;
+            resp.changed = stats.changed;
+        }
+        out_msg.data = serialize( resp );
+        break;
+    }
     case CLI_CMD::GET_PPPOE_SESSIONS: {
         GET_PPPOE_SESSION_RESP resp;
         for( auto const &[ k, v ]: runtime->activeSessions ) {
@@ -122,9 +215,9 @@ void CLISession::run_cmd( const std::string &cmd ) {
             d.address = sess_ptr->address.to_string();
             d.dns1 = sess_ptr->dns1.to_string();
             d.dns2 = sess_ptr->dns2.to_string();
-            d.framed_pool = sess_ptr->framed_pool;
-            d.unnumbered = sess_ptr->unnumbered;
-            d.vrf = sess_ptr->vrf;
+            d.framed_pool = sess_ptr->framed_pool();
+            d.unnumbered = sess_ptr->unnumbered();
+            d.vrf = sess_ptr->vrf();
            
             resp.sessions.push_back( std::move( d ) );
         }
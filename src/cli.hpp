@@ -21,6 +21,11 @@ enum class CLI_CMD: uint8_t {
     GET_PPPOE_SESSIONS,
     GET_AAA_SESSIONS,
     GET_VPP_IFACES,
+    GET_VPP_STATUS,
+    GET_VPP_API_STATS,
+    GET_RADIUS_SERVERS,
+    GET_ADMISSION,
+    GET_COA,
 };
 
 struct CLI_MSG {
@@ -120,6 +125,167 @@ struct GET_VPP_IFACES_RESP {
     }
 };
 
+struct GET_VPP_STATUS_RESP {
+    bool connected;
+    uint64_t dataplane_epoch;
+    uint64_t replays;
+    bool replay_in_progress;
+    uint64_t replay_sessions;
+    uint64_t replay_failed;
+    uint64_t replay_duration_ms;
+
+    template<class Archive>
+    void serialize( Archive &archive, const unsigned int version ) {
+        archive & connected;
+        archive & dataplane_epoch;
+        archive & replays;
+        archive & replay_in_progress;
+        archive & replay_sessions;
+        archive & replay_failed;
+        archive & replay_duration_ms;
+    }
+};
+
+struct HISTOGRAM_DUMP {
+    std::string name;
+    uint64_t count;
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+
+    template<class Archive>
+    void serialize( Archive &archive, const unsigned int version ) {
+        archive & name;
+        archive & count;
+        archive & mean;
+        archive & p50;
+        archive & p90;
+        archive & p99;
+        archive & max;
+    }
+};
+
+struct GET_VPP_API_STATS_RESP {
+    HISTOGRAM_DUMP queue_depth;
+    std::vector<HISTOGRAM_DUMP> latency_us;
+
+    template<class Archive>
+    void serialize( Archive &archive, const unsigned int version ) {
+        archive & queue_depth;
+        archive & latency_us;
+    }
+};
+
+struct RADIUS_SERVER_DUMP {
+    std::string name;
+    std::string type;
+    std::string address;
+    bool dead;
+    uint16_t weight;
+    int32_t effective_weight;
+    uint64_t srtt_us;
+    uint64_t failovers;
+    uint64_t outstanding;
+    uint64_t requests;
+    uint64_t replies;
+    uint64_t retransmits;
+    uint64_t timeouts;
+    uint64_t dropped;
+    HISTOGRAM_DUMP latency_us;
+
+    template<class Archive>
+    void serialize( Archive &archive, const unsigned int version ) {
+        archive & name;
+        archive & type;
+        archive & address;
+        archive & dead;
+        archive & weight;
+        archive & effective_weight;
+        archive & srtt_us;
+        archive & failovers;
+        archive & outstanding;
+        archive & requests;
+        archive & replies;
+        archive & retransmits;
+        archive & timeouts;
+        archive & dropped;
+        archive & latency_us;
+    }
+};
+
+struct GET_RADIUS_SERVERS_RESP {
+    std::vector<RADIUS_SERVER_DUMP> servers;
+
+    template<class Archive>
+    void serialize( Archive &archive, const unsigned int version ) {
+        archive & servers;
+    }
+};
+
+struct GET_ADMISSION_RESP {
+    std::string state;
+    uint64_t inflight;
+    uint64_t peak_inflight;
+    uint64_t srtt_us;
+    uint64_t held;
+    uint64_t auths;
+    uint64_t pado_delayed;
+    uint64_t padi_dropped;
+    uint64_t padr_dropped;
+    uint64_t transitions;
+    uint32_t pado_delay;
+    uint32_t delay_inflight;
+    uint32_t delay_latency;
+    uint32_t high_water;
+    uint32_t low_water;
+
+    template<class Archive>
+    void serialize( Archive &archive, const unsigned int version ) {
+        archive & state;
+        archive & inflight;
+        archive & peak_inflight;
+        archive & srtt_us;
+        archive & held;
+        archive & auths;
+        archive & pado_delayed;
+        archive & padi_dropped;
+        archive & padr_dropped;
+        archive & transitions;
+        archive & pado_delay;
+        archive & delay_inflight;
+        archive & delay_latency;
+        archive & high_water;
+        archive & low_water;
+    }
+};
+
+struct GET_COA_RESP {
+    bool listening;
+    uint16_t port;
+    uint64_t clients;
+    uint64_t requests;
+    uint64_t duplicates;
+    uint64_t naks;
+    uint64_t dropped;
+    uint64_t disconnected;
+    uint64_t changed;
+
+    template<class Archive>
+    void serialize( Archive &archive, const unsigned int version ) {
+        archive & listening;
+        archive & port;
+        archive & clients;
+        archive & requests;
+        archive & duplicates;
+        archive & naks;
+        archive & dropped;
+        archive & disconnected;
+        archive & changed;
+    }
+};
+
 template<typename T>
 std::string serialize( const T &val ) {
     static auto const ser_flags = boost::archive::no_header | boost::archive::no_tracking;
@@ -0,0 +1,333 @@
+#include <cstring>
+
+#include "coa_server.hpp"
+#include "aaa.hpp"
+#include "aaa_session.hpp"
+#include "session.hpp"
+#include "pppoe.hpp"
+#include "runtime.hpp"
+#include "provision_queue.hpp"
+#include "string_helpers.hpp"
+
+extern std::shared_ptr<PPPOERuntime> runtime;
+
+namespace {
+    // Clients give up on a request well before this
+    constexpr std::chrono::seconds answer_keep { 30 };
+    const authenticator_t zero_authenticator {};
+}
+
+CoAServer::CoAServer( boost::asio::io_context &i, const AAAConf &c, std::shared_ptr<const RadiusDict> d ):
+    io( i ),
+    conf( c ),
+    dict( std::move( d ) ),
+    socket( i )
+{
+    for( size_t i = 0; i < RADIUS_RX_BATCH; i++ ) {
+        rx_iovs[ i ] = { rx_bufs[ i ].data(), rx_bufs[ i ].size() };
+    }
+}
+
+CoAServer::~CoAServer() {
+    socket.close();
+}
+
+std::string CoAServer::open() {
+    boost::system::error_code ec;
+    boost::asio::ip::udp::endpoint local { boost::asio::ip::udp::v4(), conf.coa_port };
+    socket.open( local.protocol(), ec );
+    if( !ec ) {
+        socket.bind( local, ec );
+    }
+    if( !ec ) {
+        // A policy change sends requests for many subscribers at once
+        boost::system::error_code ignored;
+        socket.set_option( boost::asio::socket_base::receive_buffer_size( 4 << 20 ), ignored );
+    }
+    if( ec ) {
+        socket.close();
+        return "Cannot listen for Disconnect and CoA requests on port " + std::to_string( conf.coa_port ) + ": " + ec.message();
+    }
+    receive();
+    return {};
+}
+
+const CoAStats& CoAServer::stats() const {
+    return counters;
+}
+
+void CoAServer::receive() {
+    socket.async_wait( boost::asio::ip::udp::socket::wait_read, std::bind( &CoAServer::on_readable, this, std::placeholders::_1 ) );
+}
+
+const std::string* CoAServer::clientSecret( const boost::asio::ip::udp::endpoint &from ) const {
+    for( auto const &[ name, client ]: conf.coa_clients ) {
+        if( client.address == from.address().to_v4() ) {
+            return &client.secret;
+        }
+    }
+    return nullptr;
+}
+
+void CoAServer::on_readable( boost::system::error_code ec ) {
+    if( ec ) {
+        if( ec != boost::asio::error::operation_aborted ) {
+            runtime->logger->logError() << LOGS::RADIUS << "CoA socket error: " << ec.message() << std::endl;
+        }
+        return;
+    }
+
+    auto started = clock::now();
+    while( !answers_order.empty() && started - answers_order.front().first > answer_keep ) {
+        // The client may have reused the identifier since, that answer stays
+        auto const &[ at, key ] = answers_order.front();
+        if( auto const &it = answers.find( key ); it != answers.end() && it->second.sent == at ) {
+            answers.erase( it );
+        }
+        answers_order.pop_front();
+    }
+    auto before = counters;
+    by_aaa.clear();
+    by_aaa_built = false;
+
+    auto fd = socket.native_handle();
+    while( true ) {
+        for( size_t i = 0; i < RADIUS_RX_BATCH; i++ ) {
+            rx_msgs[ i ] = {};
+            rx_msgs[ i ].msg_hdr.msg_iov = &rx_iovs[ i ];
+            rx_msgs[ i ].msg_hdr.msg_iovlen = 1;
+            rx_msgs[ i ].msg_hdr.msg_name = &rx_addrs[ i ];
+            rx_msgs[ i ].msg_hdr.msg_namelen = sizeof( rx_addrs[ i ] );
+        }
+        auto n = recvmmsg( fd, rx_msgs.data(), RADIUS_RX_BATCH, MSG_DONTWAIT, nullptr );
+        if( n < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            if( errno != EAGAIN && errno != EWOULDBLOCK ) {
+                runtime->logger->logError() << LOGS::RADIUS << "Cannot receive CoA requests: " << strerror( errno ) << std::endl;
+            }
+            break;
+        }
+
+        // Request Authenticators of the whole batch are checked with one md5_batch()
+        md5_jobs.clear();
+        for( int i = 0; i < n; i++ ) {
+            auto &slot = slots[ i ];
+            slot.ok = false;
+            auto pkt = reinterpret_cast<const RadiusPacket*>( rx_bufs[ i ].data() );
+            size_t size = rx_msgs[ i ].msg_len;
+            if( ( rx_msgs[ i ].msg_hdr.msg_flags & MSG_TRUNC ) || size < sizeof( RadiusPacket ) ||
+                pkt->length.native() < sizeof( RadiusPacket ) || pkt->length.native() > size ||
+                ( pkt->code != RADIUS_CODE::DISCONNECT_REQUEST && pkt->code != RADIUS_CODE::COA_REQUEST ) )
+            {
+                counters.dropped++;
+                continue;
+            }
+            slot.from = boost::asio::ip::udp::endpoint {
+                address_v4_t { ntohl( rx_addrs[ i ].sin_addr.s_addr ) }, ntohs( rx_addrs[ i ].sin_port ) };
+            slot.secret = clientSecret( slot.from );
+            if( slot.secret == nullptr ) {
+                runtime->logger->logError() << LOGS::RADIUS << "Dropping " << pkt->code << " from unknown client " << slot.from << std::endl;
+                counters.dropped++;
+                continue;
+            }
+            if( resend( slot, pkt ) ) {
+                counters.duplicates++;
+                continue;
+            }
+            slot.ok = true;
+            // RFC 5176 3.5: as an Accounting-Request, the authenticator is hashed as zeroes
+            auto hdr = reinterpret_cast<const char*>( rx_bufs[ i ].data() );
+            md5_jobs.push_back( { {
+                { hdr, 4 },
+                { reinterpret_cast<const char*>( zero_authenticator.data() ), zero_authenticator.size() },
+                { hdr + sizeof( RadiusPacket ), pkt->length.native() - sizeof( RadiusPacket ) },
+                *slot.secret
+            }, slot.digest } );
+        }
+        md5_batch( md5_jobs.data(), md5_jobs.size() );
+
+        md5_jobs.clear();
+        for( int i = 0; i < n; i++ ) {
+            auto &slot = slots[ i ];
+            if( !slot.ok ) {
+                continue;
+            }
+            auto pkt = reinterpret_cast<const RadiusPacket*>( rx_bufs[ i ].data() );
+            if( !std::equal( slot.digest.begin(), slot.digest.end(), pkt->authenticator.begin() ) ) {
+                runtime->logger->logError() << LOGS::RADIUS << "Dropping " << pkt->code << " from " << slot.from << ", check the CoA secret" << std::endl;
+                counters.dropped++;
+                slot.ok = false;
+                continue;
+            }
+            handle( rx_bufs[ i ].data(), slot );
+            if( !slot.ok ) {
+                continue;
+            }
+            // Response Authenticator covers the answer with the request authenticator in place
+            auto reply = reinterpret_cast<const char*>( slot.reply.data() );
+            md5_jobs.push_back( { {
+                { reply, 4 },
+                { reinterpret_cast<const char*>( pkt->authenticator.data() ), pkt->authenticator.size() },
+                { reply + sizeof( RadiusPacket ), slot.reply.size() - sizeof( RadiusPacket ) },
+                *slot.secret
+            }, slot.digest } );
+        }
+        md5_batch( md5_jobs.data(), md5_jobs.size() );
+
+        for( int i = 0; i < n; i++ ) {
+            if( slots[ i ].ok ) {
+                send( slots[ i ], reinterpret_cast<const RadiusPacket*>( rx_bufs[ i ].data() ) );
+            }
+        }
+        if( static_cast<size_t>( n ) < RADIUS_RX_BATCH ) {
+            break;
+        }
+    }
+
+    // Everything the requests changed leaves in one burst
+    runtime->provision->flush();
+    by_aaa.clear();
+
+    if( auto requests = counters.requests - before.requests; requests > 0 ) {
+        runtime->logger->logInfo() << LOGS::RADIUS << "Dynamic authorization: " << requests << " requests, " <<
+            counters.disconnected - before.disconnected << " sessions disconnected, " <<
+            counters.changed - before.changed << " changed, " << counters.naks - before.naks << " NAK in " <<
+            std::chrono::duration_cast<std::chrono::milliseconds>( clock::now() - started ).count() << " ms" << std::endl;
+    }
+    receive();
+}
+
+bool CoAServer::resend( const Slot &slot, const RadiusPacket *pkt ) {
+    auto const &it = answers.find( { slot.from.address().to_v4().to_uint(), slot.from.port(), pkt->id } );
+    if( it == answers.end() || it->second.request != pkt->authenticator ) {
+        return false;
+    }
+    boost::system::error_code ec;
+    socket.send_to( boost::asio::buffer( it->second.reply ), slot.from, 0, ec );
+    return true;
+}
+
+void CoAServer::handle( const uint8_t *buf, Slot &slot ) {
+    counters.requests++;
+    auto pkt = reinterpret_cast<const RadiusPacket*>( buf );
+    AVPReader avps { buf + sizeof( RadiusPacket ), pkt->length.native() - sizeof( RadiusPacket ) };
+    if( !avps.valid() ) {
+        runtime->logger->logError() << LOGS::RADIUS << "Dropping " << pkt->code << " with malformed attributes" << std::endl;
+        counters.dropped++;
+        slot.ok = false;
+        return;
+    }
+    auto req = deserialize<CoARequest>( *dict, avps );
+    bool is_disconnect = pkt->code == RADIUS_CODE::DISCONNECT_REQUEST;
+    auto code = is_disconnect ? RADIUS_CODE::DISCONNECT_NAK : RADIUS_CODE::COA_NAK;
+    CoAResponse res;
+
+    if( req.session_id.empty() && req.username.empty() && req.framed_ip.to_uint() == 0 ) {
+        res.error_cause = static_cast<uint32_t>( COA_ERROR::MISSING_ATTRIBUTE );
+    } else if( !is_disconnect && ( req.dns1.to_uint() != 0 || req.dns2.to_uint() != 0 ) ) {
+        // The subscriber learns DNS only when IPCP negotiates, a live session would never see it
+        res.error_cause = static_cast<uint32_t>( COA_ERROR::UNSUPPORTED_ATTRIBUTE );
+    } else if( !is_disconnect && req.pppoe_template.empty() ) {
+        // Nothing to change
+        res.error_cause = static_cast<uint32_t>( COA_ERROR::MISSING_ATTRIBUTE );
+    } else if( !is_disconnect && !req.pppoe_template.empty() && runtime->templates.findTemplate( req.pppoe_template ) == NO_HANDLE ) {
+        res.error_cause = static_cast<uint32_t>( COA_ERROR::INVALID_ATTRIBUTE_VALUE );
+    } else if( auto const &sids = runtime->aaa->findSessions( req ); sids.empty() ) {
+        res.error_cause = static_cast<uint32_t>( COA_ERROR::SESSION_NOT_FOUND );
+    } else {
+        code = is_disconnect ? disconnect( sids ) : change( sids, req );
+    }
+    if( res.error_cause != 0 ) {
+        counters.naks++;
+        runtime->logger->logDebug() << LOGS::RADIUS << pkt->code << " from " << slot.from << " is refused with Error-Cause " << res.error_cause << std::endl;
+    }
+
+    slot.reply.resize( RADIUS_MAX_PACKET );
+    auto hdr = reinterpret_cast<RadiusPacket*>( slot.reply.data() );
+    hdr->code = code;
+    hdr->id = pkt->id;
+    hdr->authenticator.fill( 0 );
+    AVPWriter avp { slot.reply.data() + sizeof( RadiusPacket ), slot.reply.size() - sizeof( RadiusPacket ) };
+    serialize( *dict, res, avp );
+    hdr->length = sizeof( RadiusPacket ) + avp.size();
+    slot.reply.resize( sizeof( RadiusPacket ) + avp.size() );
+}
+
+RADIUS_CODE CoAServer::disconnect( const std::vector<uint32_t> &sids ) {
+    for( auto sid: sids ) {
+        counters.disconnected++;
+        auto session = pppoeSession( sid );
+        if( !session ) {
+            runtime->aaa->stopSession( sid );
+            continue;
+        }
+        runtime->logger->logDebug() << LOGS::RADIUS << "Disconnecting session " << session->session_id << " of " << session->username << std::endl;
+        pppoe::sendPADT( session->encap, session->session_id );
+        // Queued now, so it leaves with the rest of the batch even if something still holds the session
+        session->deprovision_dp();
+        runtime->deallocateSession( session->session_id );
+    }
+    return RADIUS_CODE::DISCONNECT_ACK;
+}
+
+RADIUS_CODE CoAServer::change( const std::vector<uint32_t> &sids, const CoARequest &req ) {
+    for( auto sid: sids ) {
+        auto const &[ aaa_session, err ] = runtime->aaa->getSession( sid );
+        if( !err.empty() ) {
+            continue;
+        }
+        aaa_session->change( req );
+        counters.changed++;
+        auto session = pppoeSession( sid );
+        if( !session ) {
+            continue;
+        }
+        session->move_dp( aaa_session->vrf(), aaa_session->unnumbered(), [ weak = std::weak_ptr<PPPOESession>( session ) ]( const std::string &err ) {
+            auto session = weak.lock();
+            if( !session ) {
+                return;
+            }
+            if( !err.empty() ) {
+                runtime->logger->logError() << LOGS::RADIUS << "Cannot apply CoA to session " << session->session_id << ": " << err << std::endl;
+                return;
+            }
+            runtime->aaa->mapIfaceToSession( session->aaa_session_id, session->ifindex );
+        });
+    }
+    return RADIUS_CODE::COA_ACK;
+}
+
+std::shared_ptr<PPPOESession> CoAServer::pppoeSession( uint32_t aaa_session_id ) {
+    // One walk over the sessions per wakeup, however many requests came in
+    if( !by_aaa_built ) {
+        by_aaa_built = true;
+        by_aaa.reserve( runtime->activeSessions.size() );
+        for( auto const &[ key, session ]: runtime->activeSessions ) {
+            if( session->aaa_session_id != UINT32_MAX ) {
+                by_aaa.emplace( session->aaa_session_id, session );
+            }
+        }
+    }
+    if( auto const &it = by_aaa.find( aaa_session_id ); it != by_aaa.end() ) {
+        return it->second.lock();
+    }
+    return nullptr;
+}
+
+void CoAServer::send( Slot &slot, const RadiusPacket *pkt ) {
+    auto hdr = reinterpret_cast<RadiusPacket*>( slot.reply.data() );
+    hdr->authenticator = slot.digest;
+
+    boost::system::error_code ec;
+    socket.send_to( boost::asio::buffer( slot.reply ), slot.from, 0, ec );
+    if( ec ) {
+        runtime->logger->logError() << LOGS::RADIUS << "Cannot answer " << slot.from << ": " << ec.message() << std::endl;
+    }
+
+    answer_key_t key { slot.from.address().to_v4().to_uint(), slot.from.port(), pkt->id };
+    auto now = clock::now();
+    answers.insert_or_assign( key, Answer { pkt->authenticator, slot.reply, now } );
+    answers_order.emplace_back( now, key );
+}
@@ -0,0 +1,99 @@
+#ifndef COA_SERVER_HPP
+#define COA_SERVER_HPP
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <netinet/in.h>
+#include <boost/asio.hpp>
+
+#include "auth_client.hpp"
+#include "request_response.hpp"
+
+struct AAAConf;
+struct PPPOESession;
+
+// Error-Cause values of RFC 5176 3.5
+enum class COA_ERROR: uint32_t {
+    UNSUPPORTED_ATTRIBUTE = 401,
+    MISSING_ATTRIBUTE = 402,
+    INVALID_ATTRIBUTE_VALUE = 407,
+    SESSION_NOT_FOUND = 503
+};
+
+struct CoAStats {
+    uint64_t requests { 0 };
+    uint64_t duplicates { 0 };
+    uint64_t naks { 0 };
+    // Unknown client, bad authenticator or malformed packet
+    uint64_t dropped { 0 };
+    uint64_t disconnected { 0 };
+    uint64_t changed { 0 };
+};
+
+// Dynamic Authorization Server of RFC 5176: takes Disconnect-Request and CoA-Request
+// from the configured clients. Requests that are read together are authenticated and
+// answered together, and the data plane work they cause goes out as one provisioning burst
+class CoAServer {
+public:
+    CoAServer( boost::asio::io_context &i, const AAAConf &c, std::shared_ptr<const RadiusDict> d );
+    ~CoAServer();
+
+    // Binds coa_port, returns an error for the log
+    std::string open();
+    const CoAStats& stats() const;
+
+private:
+    using clock = std::chrono::steady_clock;
+    // Client address and port, RADIUS identifier
+    using answer_key_t = std::tuple<uint32_t,uint16_t,uint8_t>;
+
+    struct Slot {
+        bool ok { false };
+        const std::string *secret { nullptr };
+        boost::asio::ip::udp::endpoint from;
+        authenticator_t digest;
+        std::vector<uint8_t> reply;
+    };
+
+    // Answers are kept for a while, a retransmitted request gets the same answer again
+    struct Answer {
+        authenticator_t request;
+        std::vector<uint8_t> reply;
+        clock::time_point sent;
+    };
+
+    void receive();
+    void on_readable( boost::system::error_code ec );
+    const std::string* clientSecret( const boost::asio::ip::udp::endpoint &from ) const;
+    bool resend( const Slot &slot, const RadiusPacket *pkt );
+    void handle( const uint8_t *buf, Slot &slot );
+    RADIUS_CODE disconnect( const std::vector<uint32_t> &sids );
+    RADIUS_CODE change( const std::vector<uint32_t> &sids, const CoARequest &req );
+    std::shared_ptr<PPPOESession> pppoeSession( uint32_t aaa_session_id );
+    void send( Slot &slot, const RadiusPacket *pkt );
+
+    boost::asio::io_context &io;
+    const AAAConf &conf;
+    std::shared_ptr<const RadiusDict> dict;
+    boost::asio::ip::udp::socket socket;
+    CoAStats counters;
+
+    // PPPoE sessions by their AAA session, built once per wakeup when a request needs it
+    std::unordered_map<uint32_t,std::weak_ptr<PPPOESession>> by_aaa;
+    bool by_aaa_built { false };
+
+    std::map<answer_key_t,Answer> answers;
+    std::deque<std::pair<clock::time_point,answer_key_t>> answers_order;
+
+    std::array<std::array<uint8_t,RADIUS_MAX_PACKET>,RADIUS_RX_BATCH> rx_bufs;
+    std::array<iovec,RADIUS_RX_BATCH> rx_iovs;
+    std::array<sockaddr_in,RADIUS_RX_BATCH> rx_addrs;
+    std::array<mmsghdr,RADIUS_RX_BATCH> rx_msgs;
+    std::array<Slot,RADIUS_RX_BATCH> slots;
+    std::vector<Md5Job> md5_jobs;
+};
+
+#endif
@@ -44,6 +44,15 @@ struct AAARadConf {
     address_v4_t address;
     uint16_t port;
     std::string secret;
+    // Upper bound of UDP source ports, each of them carries up to 256 outstanding requests
+    uint16_t source_ports { 16 };
+    // Share of requests relative to other servers of the group
+    uint16_t weight { 1 };
+    // Unanswered request is sent again after retransmit_interval ms, the interval doubles
+    // every time; it fails after timeout ms
+    uint32_t retransmit_interval { 1000 };
+    uint32_t retransmits { 3 };
+    uint32_t timeout { 5000 };
 
     AAARadConf() = default;
 
@@ -54,13 +63,39 @@ struct AAARadConf {
     {}
 };
 
+// Dynamic Authorization Client of RFC 5176, allowed to send Disconnect and CoA requests
+struct AAACoAClient {
+    address_v4_t address;
+    std::string secret;
+};
+
 struct AAAConf {
     std::vector<AAA_METHODS> method;
     std::map<std::string,FRAMED_POOL> pools;
     std::string local_template;
+    // Subscribers for the LOCAL method, see LocalUserDB for the format. Reread on SIGHUP
+    std::string local_users;
     std::vector<std::string> dictionaries;
+    // Compiled dictionary image, rebuilt when any of the dictionaries changes. Empty to disable
+    std::string dictionary_cache;
     std::map<std::string,AAARadConf> auth_servers;
     std::map<std::string,AAARadConf> acct_servers;
+    RADIUS_BALANCE server_selection { RADIUS_BALANCE::ROUND_ROBIN };
+    // Server failing dead_threshold requests in a row is not used for dead_time seconds
+    uint32_t dead_threshold { 3 };
+    uint32_t dead_time { 30 };
+    // Every session sends Interim-Update once per interim_interval seconds, spread evenly
+    uint32_t interim_interval { 30 };
+    // Accounting requests per second to each accounting server, 0 for no limit
+    uint32_t acct_rate { 0 };
+    // Start and Stop records no server answered are appended here and sent again once a
+    // server answers. At most acct_spool_limit records are kept. Empty to disable
+    std::string acct_spool;
+    uint32_t acct_spool_limit { 100000 };
+    // Disconnect-Request and CoA-Request are taken on coa_port from coa_clients only.
+    // No clients, no listener
+    uint16_t coa_port { 3799 };
+    std::map<std::string,AAACoAClient> coa_clients;
 };
 
 struct InterfaceUnit {
@@ -98,6 +133,34 @@ struct VRFConf {
     StaticRIB rib;
 };
 
+enum class DP_BACKEND: uint8_t {
+    VPP,
+    FAKE
+};
+
+struct VPPConf {
+    DP_BACKEND backend { DP_BACKEND::VPP };
+    // Simulated round trip of the in-memory backend
+    uint32_t fake_latency_us { 0 };
+    // Session provisioning is sent to VPP in batches of up to provision_batch
+    // requests, or whatever has been collected within provision_window_us
+    uint32_t provision_batch { 64 };
+    uint32_t provision_window_us { 1000 };
+};
+
+// Backpressure from authentication to discovery, 0 disables a threshold
+struct AdmissionConf {
+    // PADO goes out pado_delay ms late while delay_inflight authentications are
+    // outstanding or RADIUS answers take delay_latency ms, clients pick a less busy BNG
+    uint32_t pado_delay { 0 };
+    uint32_t delay_inflight { 0 };
+    uint32_t delay_latency { 0 };
+    // PADI and PADR are not answered from high_water outstanding authentications
+    // until they fall to low_water, 3/4 of high_water when not set
+    uint32_t high_water { 0 };
+    uint32_t low_water { 0 };
+};
+
 struct PPPOEGlobalConf {
     std::string tap_name;
     LOGL log_level;
@@ -110,6 +173,8 @@ struct PPPOEGlobalConf {
     LCPPolicy lcp_conf;
     StaticRIB global_rib;
     std::vector<VRFConf> vrfs;
+    VPPConf vpp_conf;
+    AdmissionConf admission;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include "dp_backend.hpp"
+#include "log.hpp"
+
+bool DPBackend::setup_interfaces( std::vector<InterfaceConf> ifaces ) {
+    auto vpp_ifs { get_ifaces() };
+
+    for( auto &iface: ifaces ) {
+        auto find_lambda = [ &, iface ]( const VPPInterface &vpp_if ) -> bool {
+            if( iface.device == vpp_if.name ) {
+                return true;
+            }
+            return false;
+        };
+        auto if_it = std::find_if( vpp_ifs.begin(), vpp_ifs.end(), find_lambda );                    
+        if( if_it == vpp_ifs.end() ) {
+            logger->logError() << LOGS::VPP << "Cannot find interface with device: " << iface.device << std::endl;
+            continue;
+        }
+        auto const &vppif = *if_it;
+        // Actual configuration process
+        set_state( vppif.sw_if_index, iface.admin_state );
+        if( iface.mtu.has_value() ) {
+            set_mtu( vppif.sw_if_index, iface.mtu.value() );
+        }
+        for( auto &[ id, unit ]: iface.units ) {
+            if( auto [ ret, ifi ] = add_subif( vppif.sw_if_index, id, unit.vlan, 0 ); !ret ) {
+                logger->logError() << LOGS::VPP << "Cannot create unit: " << iface.device << "." << id << std::endl;
+                continue;
+            } else {
+                unit.sw_if_index = ifi;
+            }
+            if( !set_state( unit.sw_if_index, unit.admin_state ) ) {
+                logger->logError() << LOGS::VPP << "Cannot set admin state to interface: " << iface.device << "." << id << std::endl;
+            }
+            if( !unit.vrf.empty() ) {
+                if( !set_interface_table( unit.sw_if_index, unit.vrf ) ) {
+                    logger->logError() << LOGS::VPP << "Cannot move interface: " << iface.device << "." << id << "to VRF " << unit.vrf << std::endl;
+                }
+            }
+            if( unit.address ) {
+                if( !set_ip( unit.sw_if_index, *unit.address ) ) {
+                    logger->logError() << LOGS::VPP << "Cannot set IP on interface: " << iface.device << "." << id << std::endl;
+                }
+            }
+            if( !unit.unnumbered.empty() ) {
+                if( auto [ ip_iface, success ] = get_iface_by_name( unit.unnumbered ); success ) {
+                    set_unnumbered( unit.sw_if_index, ip_iface );
+                } else {
+                    logger->logError() << LOGS::VPP << "Cannot set unnumbered on wan (it's not found) to unit: " << iface.device << "." << id << std::endl;
+                }
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,95 @@
+#ifndef DP_BACKEND_HPP
+#define DP_BACKEND_HPP
+
+#include <set>
+#include <vector>
+#include <tuple>
+#include <array>
+#include <functional>
+#include <map>
+#include <boost/asio.hpp>
+
+#include "config.hpp"
+#include "interner.hpp"
+#include "vpp_types.hpp"
+#include "histogram.hpp"
+
+using vpp_result_cb = std::function<void(bool)>;
+using vpp_ifindex_cb = std::function<void(bool,uint32_t)>;
+
+// Data plane API call statistics: command queue depth on submit and per-command latency in microseconds
+struct DPApiStats {
+    Histogram queue_depth;
+    std::map<std::string,Histogram> latency_us;
+};
+
+// Data plane operations the control plane relies on. VPPAPI talks to a real VPP,
+// FakeBackend keeps everything in memory
+class DPBackend {
+public:
+    virtual ~DPBackend() = default;
+
+    // Interface dump methods
+    virtual std::set<uint32_t> get_tap_interfaces() = 0;
+    virtual std::vector<VPPInterface> get_ifaces() = 0;
+    virtual std::tuple<uint32_t,bool> get_iface_by_name( const std::string &name ) = 0;
+
+    // Subif
+    virtual std::tuple<bool,int32_t> add_subif( int32_t interface, uint16_t unit, uint16_t outer_vlan, uint16_t inner_vlan ) = 0;
+    virtual bool del_subif( int32_t sw_if_index ) = 0;
+
+    // Tap
+    virtual std::tuple<bool,uint32_t> create_tap( const std::string &host_name ) = 0;
+    virtual bool delete_tap( uint32_t id ) = 0;
+
+    // Interface configuration
+    bool setup_interfaces( std::vector<InterfaceConf> ifaces );
+    virtual bool set_ip( uint32_t id, network_v4_t address, bool is_add = true ) = 0;
+    virtual bool set_state( uint32_t ifi, bool admin_state ) = 0;
+    virtual bool set_mtu( uint32_t ifi, uint16_t mtu ) = 0;
+    virtual bool set_unnumbered( uint32_t unnumbered, uint32_t iface, bool is_add = true ) = 0;
+    virtual bool set_interface_table( int32_t ifi, const InternedString &vrf ) = 0;
+    virtual std::vector<VPPIP> dump_ip( uint32_t id ) = 0;
+    virtual std::vector<VPPUnnumbered> dump_unnumbered( uint32_t id ) = 0;
+
+    // Route methods
+    virtual std::tuple<bool,int32_t> add_route( const network_v4_t &prefix, const address_v4_t &nexthop, uint32_t table_id ) = 0;
+
+    // PPPoE methods
+    virtual std::tuple<bool,uint32_t> add_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add = true ) = 0;
+    virtual bool add_pppoe_cp( uint32_t sw_if_index, bool to_del = false ) = 0;
+    virtual std::vector<VPP_PPPOE_Session> dump_pppoe_sessions() = 0;
+
+    // VRF methods
+    virtual bool set_vrf( const std::string &name, uint32_t id, bool is_add = true ) = 0;
+    virtual std::vector<VPPVRF> dump_vrfs() = 0;
+
+    // Stats
+    virtual std::tuple<bool,VPPIfaceCounters> get_counters_by_index( uint32_t ifindex ) = 0;
+
+    // Async methods: callbacks are called from the event loop
+    virtual void add_pppoe_session_async( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add, vpp_ifindex_cb callback ) = 0;
+    virtual void set_interface_table_async( int32_t ifi, const InternedString &vrf, vpp_result_cb callback ) = 0;
+    virtual void set_unnumbered_async( uint32_t unnumbered, uint32_t iface, bool is_add, vpp_result_cb callback ) = 0;
+    // Callback gets false if there is no interface with this name
+    virtual void get_iface_by_name_async( const std::string &name, vpp_ifindex_cb callback ) = 0;
+    virtual size_t inflight_requests() const = 0;
+    virtual DPApiStats api_stats() const { return {}; }
+
+    // Connection state: after a loss all data plane state is gone, handler is posted
+    // once the backend is connected again so the caller can replay it
+    virtual bool connected() const { return true; }
+    void set_restore_handler( std::function<void()> handler ) { restore_handler = std::move( handler ); }
+
+protected:
+    DPBackend( boost::asio::io_context &i, std::unique_ptr<Logger> &l ):
+        io( i ),
+        logger( l )
+    {}
+
+    boost::asio::io_context &io;
+    std::unique_ptr<Logger> &logger;
+    std::function<void()> restore_handler;
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include <linux/if.h>
 #include <linux/if_ether.h>
 #include <poll.h>
+#include <cerrno>
+#include <cstring>
 
 #include "evloop.hpp"
 #include "runtime.hpp"
@@ -21,10 +23,25 @@ EVLoop::EVLoop( io_service &i ):
     signals( i, SIGTERM, SIGINT, SIGHUP ),
     pppoed( PF_PACKET, SOCK_RAW ),
     pppoes( PF_PACKET, SOCK_RAW ),
-    raw_sock_pppoe( i, pppoed ),
+    raw_sock_pppoe( i ),
     raw_sock_ppp( i, pppoes ),
     periodic_callback( i )
 {
+    signals.async_wait( std::bind( &EVLoop::on_signal, this, std::placeholders::_1, std::placeholders::_2 ) );
+
+    bind_tap();
+    periodic_callback.expires_from_now( boost::asio::chrono::milliseconds( 20 ) );
+    periodic_callback.async_wait( std::bind( &EVLoop::periodic, this, std::placeholders::_1 ) );
+}
+
+void EVLoop::bind_tap() {
+    tap_epoch = runtime->dataplane_epoch;
+    if( raw_sock_pppoe.is_open() ) {
+        boost::system::error_code ec;
+        raw_sock_pppoe.close( ec );
+    }
+    raw_sock_pppoe.open( pppoed );
+
     sockaddr_ll sockaddr;
     memset(&sockaddr, 0, sizeof(sockaddr));
     sockaddr.sll_family = PF_PACKET;
@@ -32,18 +49,17 @@ EVLoop::EVLoop( io_service &i ):
     sockaddr.sll_ifindex = if_nametoindex( runtime->conf.tap_name.c_str() );
     sockaddr.sll_hatype = 1;
     int one = 1;
-    raw_sock_pppoe.bind( boost::asio::generic::raw_protocol::endpoint( &sockaddr, sizeof( sockaddr ) ) );
+    boost::system::error_code ec;
+    raw_sock_pppoe.bind( boost::asio::generic::raw_protocol::endpoint( &sockaddr, sizeof( sockaddr ) ), ec );
+    if( ec ) {
+        runtime->logger->logError() << LOGS::MAIN << "Cannot bind to interface " << runtime->conf.tap_name << ": " << ec.message() << std::endl;
+    }
     if( setsockopt( raw_sock_pppoe.native_handle(), SOL_PACKET, PACKET_AUXDATA, &one, sizeof(one)) < 0 ) {
         runtime->logger->logError() << LOGS::MAIN << "Cannot set option PACKET_AUXDATA" << std::endl;
     }
 
     runtime->logger->logInfo() << LOGS::MAIN << "Listening on interface " << runtime->conf.tap_name << std::endl;
-
-    signals.async_wait( std::bind( &EVLoop::on_signal, this, std::placeholders::_1, std::placeholders::_2 ) );
-
     raw_sock_pppoe.async_wait( boost::asio::socket_base::wait_type::wait_read, std::bind( &EVLoop::receive_pppoe, this, std::placeholders::_1 ) );
-    periodic_callback.expires_from_now( boost::asio::chrono::milliseconds( 20 ) );
-    periodic_callback.async_wait( std::bind( &EVLoop::periodic, this, std::placeholders::_1 ) );
 }
 
 void EVLoop::on_signal( const boost::system::error_code &ec, int signal ) {
@@ -85,6 +101,10 @@ void EVLoop::generic_receive( boost::system::error_code ec, std::size_t len, uin
 }
 
 void EVLoop::receive_pppoe( boost::system::error_code ec ) {
+    if( ec == boost::asio::error::operation_aborted ) {
+        // Socket was rebound to the new tap
+        return;
+    }
     if( ec ) {
         runtime->logger->logError() << LOGS::MAIN << "Error on receiving pppoe: " << ec.message() << std::endl;
         return;
@@ -109,6 +129,15 @@ void EVLoop::receive_pppoe( boost::system::error_code ec ) {
         .msg_flags = 0,
     };
     int received = recvmsg( raw_sock_pppoe.native_handle(), &msgh, 0 );
+    if( received < 0 ) {
+        runtime->logger->logError() << LOGS::MAIN << "Error on receiving pppoe: " << strerror( errno ) << std::endl;
+        if( errno == ENETDOWN || errno == ENXIO || errno == ENODEV ) {
+            // Tap went away with the data plane, wait until it is rebound
+            return;
+        }
+        raw_sock_pppoe.async_wait( boost::asio::socket_base::wait_type::wait_read, std::bind( &EVLoop::receive_pppoe, this, std::placeholders::_1 ) );
+        return;
+    }
     
     for( auto cmsg = CMSG_FIRSTHDR( &msgh ); cmsg != nullptr; cmsg = CMSG_NXTHDR( &msgh, cmsg ) ) {
         if( cmsg->cmsg_level == SOL_PACKET && cmsg->cmsg_type == PACKET_AUXDATA ) {
@@ -166,6 +195,10 @@ void EVLoop::periodic( boost::system::error_code ec ) {
     if( interrupted ) {
         io.stop();
     }
+    // Data plane was set up again, so was our tap
+    if( tap_epoch != runtime->dataplane_epoch ) {
+        bind_tap();
+    }
     // Sending pppoe discovery packets
     while( !runtime->pppoe_outcoming.empty() ) {
         auto reply = runtime->pppoe_outcoming.pop();
@@ -173,15 +206,22 @@ void EVLoop::periodic( boost::system::error_code ec ) {
         runtime->logger->logInfo() << LOGS::PACKET << pkt << std::endl;
         // ETHERNET_HDR *rep_eth = reinterpret_cast<ETHERNET_HDR*>( reply.data() );
         // rep_eth->src_mac = runtime->hwaddr;
-        raw_sock_pppoe.send( boost::asio::buffer( reply ) );
+        send_pppoe( reply );
     }
     // Sending pppoe session control packets
     while( !runtime->ppp_outcoming.empty() ) {
         auto reply = runtime->ppp_outcoming.pop();
         PacketPrint pkt { reply };
         runtime->logger->logInfo() << LOGS::PACKET << pkt << std::endl;
-        raw_sock_pppoe.send( boost::asio::buffer( reply ) );
+        send_pppoe( reply );
     }
     periodic_callback.expires_from_now( boost::asio::chrono::milliseconds( 20 ) );
     periodic_callback.async_wait( std::bind( &EVLoop::periodic, this, std::placeholders::_1 ) );
-}
\ No newline at end of file
+}
+void EVLoop::send_pppoe( const std::vector<uint8_t> &pkt ) {
+    boost::system::error_code ec;
+    raw_sock_pppoe.send( boost::asio::buffer( pkt ), 0, ec );
+    if( ec ) {
+        runtime->logger->logError() << LOGS::MAIN << "Cannot send packet to " << runtime->conf.tap_name << ": " << ec.message() << std::endl;
+    }
+}
@@ -40,6 +40,9 @@ public:
     void on_signal( const boost::system::error_code &ec, int signal );
 
 private:
+    void bind_tap();
+    void send_pppoe( const std::vector<uint8_t> &pkt );
+
     io_service &io;
     boost::asio::signal_set signals;
     std::array<uint8_t,1500> pktbuf;
@@ -48,6 +51,7 @@ private:
     boost::asio::basic_raw_socket<boost::asio::generic::raw_protocol> raw_sock_pppoe;
     boost::asio::basic_raw_socket<boost::asio::generic::raw_protocol> raw_sock_ppp;
     boost::asio::steady_timer periodic_callback;
+    uint64_t tap_epoch { 0 };
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,388 @@
+#include <thread>
+
+#include "string_helpers.hpp"
+#include "fake_backend.hpp"
+#include "log.hpp"
+
+FakeBackend::FakeBackend( boost::asio::io_context &i, std::unique_ptr<Logger> &l, const VPPConf &conf, const std::vector<InterfaceConf> &hw_ifaces ):
+    DPBackend( i, l ),
+    latency( conf.fake_latency_us )
+{
+    // Same as VPP: sw_if_index 0 is always local0, then whatever hardware we have
+    add_iface( "local0", "local", IfaceType::HW_IFACE );
+    for( auto const &iface: hw_ifaces ) {
+        add_iface( iface.device, "dpdk", IfaceType::HW_IFACE );
+    }
+    logger->logInfo() << LOGS::VPP << "Using in-memory data plane with " << latency.count() << "us latency" << std::endl;
+}
+
+uint32_t FakeBackend::add_iface( const std::string &name, const std::string &device, IfaceType type ) {
+    VPPInterface iface;
+    iface.name = name;
+    iface.device = device;
+    iface.mac = { 0x02, 0xfe, 0, 0, static_cast<uint8_t>( next_ifindex >> 8 ), static_cast<uint8_t>( next_ifindex ) };
+    iface.sw_if_index = next_ifindex++;
+    iface.speed = 0;
+    iface.mtu = 1500;
+    iface.type = type;
+
+    if( counters.size() <= iface.sw_if_index ) {
+        counters.resize( iface.sw_if_index + 1 );
+    }
+    counters[ iface.sw_if_index ] = {};
+    iface_names[ name ] = iface.sw_if_index;
+    ifaces.emplace( iface.sw_if_index, std::move( iface ) );
+    return next_ifindex - 1;
+}
+
+void FakeBackend::del_iface( uint32_t sw_if_index ) {
+    if( auto const &it = ifaces.find( sw_if_index ); it != ifaces.end() ) {
+        iface_names.erase( it->second.name );
+        ifaces.erase( it );
+    }
+    ips.erase( sw_if_index );
+    tables.erase( sw_if_index );
+    unnumbered.erase( sw_if_index );
+    for( auto it = unnumbered.begin(); it != unnumbered.end(); ) {
+        if( it->second == sw_if_index ) {
+            it = unnumbered.erase( it );
+        } else {
+            it++;
+        }
+    }
+    if( sw_if_index < counters.size() ) {
+        counters[ sw_if_index ] = {};
+    }
+}
+
+void FakeBackend::round_trip() {
+    if( latency.count() > 0 ) {
+        std::this_thread::sleep_for( latency );
+    }
+}
+
+void FakeBackend::reply( std::function<void()> fn ) {
+    inflight++;
+    auto done = [ this, fn = std::move( fn ) ]( const boost::system::error_code &ec ) {
+        inflight--;
+        fn();
+    };
+    if( latency.count() == 0 ) {
+        boost::asio::post( io, std::bind( done, boost::system::error_code{} ) );
+        return;
+    }
+    auto timer = std::make_shared<boost::asio::steady_timer>( io, latency );
+    timer->async_wait( [ timer, done ]( const boost::system::error_code &ec ) {
+        done( ec );
+    });
+}
+
+std::set<uint32_t> FakeBackend::get_tap_interfaces() {
+    round_trip();
+    return taps;
+}
+
+std::vector<VPPInterface> FakeBackend::get_ifaces() {
+    round_trip();
+    std::vector<VPPInterface> output;
+    output.reserve( ifaces.size() );
+    for( auto const &[ ifi, iface ]: ifaces ) {
+        output.push_back( iface );
+    }
+    return output;
+}
+
+std::tuple<uint32_t,bool> FakeBackend::get_iface_by_name( const std::string &name ) {
+    if( auto const &it = iface_names.find( name ); it != iface_names.end() ) {
+        return { it->second, true };
+    }
+    return { 0, false };
+}
+
+std::tuple<bool,int32_t> FakeBackend::add_subif( int32_t interface, uint16_t unit, uint16_t outer_vlan, uint16_t inner_vlan ) {
+    round_trip();
+    auto const &it = ifaces.find( interface );
+    if( it == ifaces.end() ) {
+        return { false, 0 };
+    }
+    auto name = it->second.name + "." + std::to_string( unit );
+    if( iface_names.find( name ) != iface_names.end() ) {
+        return { false, 0 };
+    }
+    return { true, add_iface( name, it->second.device, IfaceType::SUBIF ) };
+}
+
+bool FakeBackend::del_subif( int32_t sw_if_index ) {
+    round_trip();
+    auto const &it = ifaces.find( sw_if_index );
+    if( it == ifaces.end() || it->second.type != IfaceType::SUBIF ) {
+        return false;
+    }
+    del_iface( sw_if_index );
+    return true;
+}
+
+std::tuple<bool,uint32_t> FakeBackend::create_tap( const std::string &host_name ) {
+    round_trip();
+    auto ifi = add_iface( "tap" + std::to_string( next_tap++ ), "virtio", IfaceType::TAP );
+    taps.emplace( ifi );
+    return { true, ifi };
+}
+
+bool FakeBackend::delete_tap( uint32_t id ) {
+    round_trip();
+    if( taps.erase( id ) == 0 ) {
+        return false;
+    }
+    del_iface( id );
+    return true;
+}
+
+bool FakeBackend::set_ip( uint32_t id, network_v4_t address, bool is_add ) {
+    round_trip();
+    if( ifaces.find( id ) == ifaces.end() ) {
+        return false;
+    }
+    auto &addrs = ips[ id ];
+    auto it = std::find( addrs.begin(), addrs.end(), address );
+    if( is_add ) {
+        if( it != addrs.end() ) {
+            return false;
+        }
+        addrs.push_back( address );
+    } else {
+        if( it == addrs.end() ) {
+            return false;
+        }
+        addrs.erase( it );
+    }
+    return true;
+}
+
+bool FakeBackend::set_state( uint32_t ifi, bool admin_state ) {
+    round_trip();
+    return ifaces.find( ifi ) != ifaces.end();
+}
+
+bool FakeBackend::set_mtu( uint32_t ifi, uint16_t mtu ) {
+    round_trip();
+    auto const &it = ifaces.find( ifi );
+    if( it == ifaces.end() ) {
+        return false;
+    }
+    it->second.mtu = mtu;
+    return true;
+}
+
+bool FakeBackend::set_unnumbered( uint32_t unnumbered_ifi, uint32_t iface, bool is_add ) {
+    round_trip();
+    return apply_unnumbered( unnumbered_ifi, iface, is_add );
+}
+
+bool FakeBackend::apply_unnumbered( uint32_t unnumbered_ifi, uint32_t iface, bool is_add ) {
+    if( ifaces.find( unnumbered_ifi ) == ifaces.end() || ifaces.find( iface ) == ifaces.end() ) {
+        return false;
+    }
+    if( is_add ) {
+        unnumbered[ unnumbered_ifi ] = iface;
+    } else {
+        unnumbered.erase( unnumbered_ifi );
+    }
+    return true;
+}
+
+bool FakeBackend::set_interface_table( int32_t ifi, const InternedString &vrf ) {
+    round_trip();
+    return apply_interface_table( ifi, vrf );
+}
+
+bool FakeBackend::apply_interface_table( int32_t ifi, const InternedString &vrf ) {
+    if( ifaces.find( ifi ) == ifaces.end() ) {
+        return false;
+    }
+    uint32_t table_id = 0;
+    if( !resolve_vrf( vrf, table_id ) ) {
+        table_id = 0;
+    }
+    tables[ ifi ] = table_id;
+    return true;
+}
+
+std::vector<VPPIP> FakeBackend::dump_ip( uint32_t id ) {
+    round_trip();
+    std::vector<VPPIP> output;
+    if( auto const &it = ips.find( id ); it != ips.end() ) {
+        for( auto const &address: it->second ) {
+            output.push_back( { id, address } );
+        }
+    }
+    return output;
+}
+
+std::vector<VPPUnnumbered> FakeBackend::dump_unnumbered( uint32_t id ) {
+    round_trip();
+    std::vector<VPPUnnumbered> output;
+    for( auto const &[ unn, iface ]: unnumbered ) {
+        if( id == UINT32_MAX || id == unn ) {
+            output.push_back( { unn, iface } );
+        }
+    }
+    return output;
+}
+
+std::tuple<bool,int32_t> FakeBackend::add_route( const network_v4_t &prefix, const address_v4_t &nexthop, uint32_t table_id ) {
+    round_trip();
+    auto key = std::make_tuple( table_id, prefix.network().to_uint(), static_cast<uint8_t>( prefix.prefix_length() ) );
+    if( auto const &it = routes.find( key ); it != routes.end() ) {
+        return { true, it->second };
+    }
+    routes.emplace( key, next_route );
+    return { true, next_route++ };
+}
+
+std::tuple<bool,uint32_t> FakeBackend::add_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add ) {
+    round_trip();
+    return apply_pppoe_session( ip_address, session_id, mac, vrf, is_add );
+}
+
+std::tuple<bool,uint32_t> FakeBackend::apply_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add ) {
+    logger->logDebug() << LOGS::VPP << 
+        "Set up PPPoE session " << session_id << ": " << mac << " " << address_v4_t( ip_address ).to_string() << 
+        " action: " << ( is_add ? "add" : "del" ) << std::endl;
+
+    auto key = std::make_tuple( session_id, mac );
+    auto const &it = session_index.find( key );
+    if( !is_add ) {
+        if( it == session_index.end() ) {
+            return { false, 0 };
+        }
+        auto ifi = it->second;
+        del_iface( ifi );
+        sessions.erase( ifi );
+        session_index.erase( it );
+        return { true, ifi };
+    }
+
+    if( it != session_index.end() ) {
+        return { false, 0 };
+    }
+    if( uint32_t table_id; !resolve_vrf( vrf, table_id ) ) {
+        return { false, 0 };
+    }
+    auto ifi = add_iface( "pppoe_session" + std::to_string( next_pppoe++ ), "PPPoE", IfaceType::SUBIF );
+    VPP_PPPOE_Session session;
+    session.session_id = session_id;
+    session.mac = mac;
+    session.address = address_v4_t( ip_address );
+    session.sw_if_index = ifi;
+    session.encap_if_index = cp_iface.value_or( 0 );
+    sessions.emplace( ifi, session );
+    session_index.emplace( key, ifi );
+    return { true, ifi };
+}
+
+bool FakeBackend::add_pppoe_cp( uint32_t sw_if_index, bool to_del ) {
+    round_trip();
+    if( ifaces.find( sw_if_index ) == ifaces.end() ) {
+        return false;
+    }
+    if( to_del ) {
+        cp_iface.reset();
+    } else {
+        cp_iface = sw_if_index;
+    }
+    return true;
+}
+
+std::vector<VPP_PPPOE_Session> FakeBackend::dump_pppoe_sessions() {
+    round_trip();
+    std::vector<VPP_PPPOE_Session> output;
+    output.reserve( sessions.size() );
+    for( auto const &[ ifi, session ]: sessions ) {
+        output.push_back( session );
+    }
+    return output;
+}
+
+bool FakeBackend::set_vrf( const std::string &name, uint32_t id, bool is_add ) {
+    round_trip();
+    vrf_generation = InternedString::newGeneration();
+    if( is_add ) {
+        vrfs[ name ] = id;
+        return true;
+    }
+    for( auto it = vrfs.begin(); it != vrfs.end(); it++ ) {
+        if( it->second == id ) {
+            vrfs.erase( it );
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FakeBackend::resolve_vrf( const InternedString &vrf, uint32_t &table_id ) const {
+    if( vrf.empty() ) {
+        table_id = 0;
+        return true;
+    }
+    if( vrf.cachedId( vrf_generation, table_id ) ) {
+        return true;
+    }
+    if( auto const &it = vrfs.find( vrf.str() ); it != vrfs.end() ) {
+        table_id = it->second;
+        vrf.cacheId( vrf_generation, table_id );
+        return true;
+    }
+    return false;
+}
+
+std::vector<VPPVRF> FakeBackend::dump_vrfs() {
+    round_trip();
+    std::vector<VPPVRF> output { { "ipv4-VRF:0", 0 } };
+    for( auto const &[ name, id ]: vrfs ) {
+        output.push_back( { name, id } );
+    }
+    return output;
+}
+
+std::tuple<bool,VPPIfaceCounters> FakeBackend::get_counters_by_index( uint32_t ifindex ) {
+    if( ifaces.find( ifindex ) == ifaces.end() ) {
+        return { false, {} };
+    }
+    return { true, counters[ ifindex ] };
+}
+
+void FakeBackend::add_traffic( uint32_t ifindex, const VPPIfaceCounters &delta ) {
+    if( ifaces.find( ifindex ) == ifaces.end() ) {
+        return;
+    }
+    auto &c = counters[ ifindex ];
+    c.rxPkts += delta.rxPkts;
+    c.rxBytes += delta.rxBytes;
+    c.txPkts += delta.txPkts;
+    c.txBytes += delta.txBytes;
+    c.drops += delta.drops;
+}
+
+// State changes in request order, only the answer is delayed
+void FakeBackend::add_pppoe_session_async( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add, vpp_ifindex_cb callback ) {
+    auto [ success, ifi ] = apply_pppoe_session( ip_address, session_id, mac, vrf, is_add );
+    reply( std::bind( callback, success, ifi ) );
+}
+
+void FakeBackend::set_interface_table_async( int32_t ifi, const InternedString &vrf, vpp_result_cb callback ) {
+    reply( std::bind( callback, apply_interface_table( ifi, vrf ) ) );
+}
+
+void FakeBackend::set_unnumbered_async( uint32_t unnumbered_ifi, uint32_t iface, bool is_add, vpp_result_cb callback ) {
+    reply( std::bind( callback, apply_unnumbered( unnumbered_ifi, iface, is_add ) ) );
+}
+
+void FakeBackend::get_iface_by_name_async( const std::string &name, vpp_ifindex_cb callback ) {
+    auto [ ifi, success ] = get_iface_by_name( name );
+    reply( std::bind( callback, success, ifi ) );
+}
+
+size_t FakeBackend::inflight_requests() const {
+    return inflight;
+}
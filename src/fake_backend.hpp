@@ -0,0 +1,95 @@
+#ifndef FAKE_BACKEND_HPP
+#define FAKE_BACKEND_HPP
+
+#include <map>
+#include <unordered_map>
+#include <optional>
+#include <chrono>
+
+#include "dp_backend.hpp"
+
+// In-memory data plane: allocates sw_if_index values, keeps interface, VRF,
+// route and PPPoE session state and answers after a configurable latency.
+// Lets the whole control plane run without VPP.
+class FakeBackend: public DPBackend {
+public:
+    FakeBackend( boost::asio::io_context &io, std::unique_ptr<Logger> &l, const VPPConf &conf, const std::vector<InterfaceConf> &hw_ifaces );
+
+    // Interface dump methods
+    std::set<uint32_t> get_tap_interfaces() override;
+    std::vector<VPPInterface> get_ifaces() override;
+    std::tuple<uint32_t,bool> get_iface_by_name( const std::string &name ) override;
+
+    // Subif
+    std::tuple<bool,int32_t> add_subif( int32_t interface, uint16_t unit, uint16_t outer_vlan, uint16_t inner_vlan ) override;
+    bool del_subif( int32_t sw_if_index ) override;
+
+    // Tap
+    std::tuple<bool,uint32_t> create_tap( const std::string &host_name ) override;
+    bool delete_tap( uint32_t id ) override;
+
+    // Interface configuration
+    bool set_ip( uint32_t id, network_v4_t address, bool is_add = true ) override;
+    bool set_state( uint32_t ifi, bool admin_state ) override;
+    bool set_mtu( uint32_t ifi, uint16_t mtu ) override;
+    bool set_unnumbered( uint32_t unnumbered, uint32_t iface, bool is_add = true ) override;
+    bool set_interface_table( int32_t ifi, const InternedString &vrf ) override;
+    std::vector<VPPIP> dump_ip( uint32_t id ) override;
+    std::vector<VPPUnnumbered> dump_unnumbered( uint32_t id ) override;
+
+    // Route methods
+    std::tuple<bool,int32_t> add_route( const network_v4_t &prefix, const address_v4_t &nexthop, uint32_t table_id ) override;
+
+    // PPPoE methods
+    std::tuple<bool,uint32_t> add_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add = true ) override;
+    bool add_pppoe_cp( uint32_t sw_if_index, bool to_del = false ) override;
+    std::vector<VPP_PPPOE_Session> dump_pppoe_sessions() override;
+
+    // VRF methods
+    bool set_vrf( const std::string &name, uint32_t id, bool is_add = true ) override;
+    std::vector<VPPVRF> dump_vrfs() override;
+
+    // Stats
+    std::tuple<bool,VPPIfaceCounters> get_counters_by_index( uint32_t ifindex ) override;
+    void add_traffic( uint32_t ifindex, const VPPIfaceCounters &delta );
+
+    // Async methods
+    void add_pppoe_session_async( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add, vpp_ifindex_cb callback ) override;
+    void set_interface_table_async( int32_t ifi, const InternedString &vrf, vpp_result_cb callback ) override;
+    void set_unnumbered_async( uint32_t unnumbered, uint32_t iface, bool is_add, vpp_result_cb callback ) override;
+    void get_iface_by_name_async( const std::string &name, vpp_ifindex_cb callback ) override;
+    size_t inflight_requests() const override;
+
+private:
+    uint32_t add_iface( const std::string &name, const std::string &device, IfaceType type );
+    void del_iface( uint32_t sw_if_index );
+    std::tuple<bool,uint32_t> apply_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add );
+    bool apply_interface_table( int32_t ifi, const InternedString &vrf );
+    bool apply_unnumbered( uint32_t unnumbered_ifi, uint32_t iface, bool is_add );
+    bool resolve_vrf( const InternedString &vrf, uint32_t &table_id ) const;
+    void round_trip();
+    void reply( std::function<void()> fn );
+
+    std::chrono::microseconds latency;
+    size_t inflight { 0 };
+
+    uint32_t next_ifindex { 0 };
+    uint32_t next_tap { 0 };
+    uint32_t next_pppoe { 0 };
+    int32_t next_route { 0 };
+    std::map<uint32_t,VPPInterface> ifaces;
+    std::unordered_map<std::string,uint32_t> iface_names;
+    std::set<uint32_t> taps;
+    std::optional<uint32_t> cp_iface;
+    std::map<uint32_t,std::vector<network_v4_t>> ips;
+    std::map<uint32_t,uint32_t> unnumbered;
+    std::map<uint32_t,uint32_t> tables;
+    std::map<std::string,uint32_t> vrfs;
+    uint64_t vrf_generation { InternedString::newGeneration() };
+    std::map<std::tuple<uint32_t,uint32_t,uint8_t>,int32_t> routes;
+    std::map<std::tuple<uint16_t,mac_t>,uint32_t> session_index;
+    std::map<uint32_t,VPP_PPPOE_Session> sessions;
+    std::vector<VPPIfaceCounters> counters;
+};
+
+#endif
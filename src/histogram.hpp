@@ -0,0 +1,60 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+// Power of two buckets: bucket N holds values in [2^(N-1), 2^N), bucket 0 holds zero.
+// Cheap enough to record on every event, percentiles are upper bounds of a bucket
+class Histogram {
+public:
+    void record( uint64_t value ) {
+        buckets[ value == 0 ? 0 : 64 - __builtin_clzll( value ) ]++;
+        total++;
+        sum += value;
+        maximum = std::max( maximum, value );
+    }
+
+    uint64_t count() const {
+        return total;
+    }
+
+    uint64_t max() const {
+        return maximum;
+    }
+
+    uint64_t mean() const {
+        return total == 0 ? 0 : sum / total;
+    }
+
+    uint64_t percentile( double p ) const {
+        if( total == 0 ) {
+            return 0;
+        }
+        uint64_t rank = std::max<uint64_t>( 1, static_cast<uint64_t>( p / 100.0 * total + 0.5 ) );
+        uint64_t seen = 0;
+        for( size_t i = 0; i < buckets.size(); i++ ) {
+            seen += buckets[ i ];
+            if( seen >= rank ) {
+                if( i == 0 ) {
+                    return 0;
+                }
+                // The last bucket ends past 2^64 - 1, maximum is its only bound
+                if( i == buckets.size() - 1 ) {
+                    return maximum;
+                }
+                return std::min( maximum, ( uint64_t{ 1 } << i ) - 1 );
+            }
+        }
+        return maximum;
+    }
+
+private:
+    std::array<uint64_t,65> buckets {};
+    uint64_t total { 0 };
+    uint64_t sum { 0 };
+    uint64_t maximum { 0 };
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include <unordered_map>
+
+#include "interner.hpp"
+
+struct InternedString::Entry {
+    std::string value;
+    uint32_t refs { 0 };
+    uint32_t id { 0 };
+    uint64_t id_generation { 0 };
+};
+
+namespace {
+    // Never freed: handles in globals may outlive any static
+    std::unordered_map<std::string_view,void*>& table() {
+        static auto &t = *new std::unordered_map<std::string_view,void*>();
+        return t;
+    }
+    const std::string empty_string;
+    uint64_t last_generation { 0 };
+}
+
+InternedString::InternedString( std::string_view s ) {
+    if( s.empty() ) {
+        return;
+    }
+    if( auto const &it = table().find( s ); it != table().end() ) {
+        entry = static_cast<Entry*>( it->second );
+    } else {
+        entry = new Entry { std::string { s } };
+        table().emplace( entry->value, entry );
+    }
+    entry->refs++;
+}
+
+InternedString::InternedString( const InternedString &r ):
+    entry( r.entry )
+{
+    if( entry != nullptr ) {
+        entry->refs++;
+    }
+}
+
+InternedString::InternedString( InternedString &&r ) noexcept:
+    entry( r.entry )
+{
+    r.entry = nullptr;
+}
+
+InternedString& InternedString::operator=( const InternedString &r ) {
+    auto e = r.entry;
+    if( e != nullptr ) {
+        e->refs++;
+    }
+    release();
+    entry = e;
+    return *this;
+}
+
+InternedString& InternedString::operator=( InternedString &&r ) noexcept {
+    if( this != &r ) {
+        release();
+        entry = r.entry;
+        r.entry = nullptr;
+    }
+    return *this;
+}
+
+InternedString::~InternedString() {
+    release();
+}
+
+void InternedString::release() {
+    if( entry == nullptr ) {
+        return;
+    }
+    if( --entry->refs == 0 ) {
+        table().erase( entry->value );
+        delete entry;
+    }
+    entry = nullptr;
+}
+
+const std::string& InternedString::str() const {
+    return entry != nullptr ? entry->value : empty_string;
+}
+
+bool InternedString::cachedId( uint64_t generation, uint32_t &id ) const {
+    if( entry == nullptr || entry->id_generation != generation ) {
+        return false;
+    }
+    id = entry->id;
+    return true;
+}
+
+void InternedString::cacheId( uint64_t generation, uint32_t id ) const {
+    if( entry == nullptr ) {
+        return;
+    }
+    entry->id = id;
+    entry->id_generation = generation;
+}
+
+uint64_t InternedString::newGeneration() {
+    return ++last_generation;
+}
+
+size_t InternedString::count() {
+    return table().size();
+}
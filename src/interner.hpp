@@ -0,0 +1,71 @@
+#ifndef INTERNER_HPP
+#define INTERNER_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+// Shared copy of a string many sessions carry: user names, VRFs, unnumbered interfaces.
+// Equal strings share one entry that goes away with its last handle, so a handle is a
+// pointer, compares by identity and copies without allocating. The empty string has no
+// entry. Control loop only, the reference counts are not atomic
+class InternedString {
+public:
+    InternedString() = default;
+    InternedString( std::string_view s );
+    InternedString( const std::string &s ): InternedString( std::string_view { s } ) {}
+    InternedString( const char *s ): InternedString( std::string_view { s } ) {}
+    InternedString( const InternedString &r );
+    InternedString( InternedString &&r ) noexcept;
+    InternedString& operator=( const InternedString &r );
+    InternedString& operator=( InternedString &&r ) noexcept;
+    ~InternedString();
+
+    const std::string& str() const;
+    operator const std::string&() const {
+        return str();
+    }
+    bool empty() const {
+        return entry == nullptr;
+    }
+
+    // Data plane id of the name, a VRF table for instance, kept in the entry. The owner of
+    // the ids takes a new generation whenever they change, older ones are ignored
+    bool cachedId( uint64_t generation, uint32_t &id ) const;
+    void cacheId( uint64_t generation, uint32_t id ) const;
+    static uint64_t newGeneration();
+
+    // Distinct strings alive
+    static size_t count();
+
+    friend bool operator==( const InternedString &l, const InternedString &r ) {
+        return l.entry == r.entry;
+    }
+    friend bool operator!=( const InternedString &l, const InternedString &r ) {
+        return l.entry != r.entry;
+    }
+    friend struct std::hash<InternedString>;
+
+private:
+    struct Entry;
+    Entry *entry { nullptr };
+
+    void release();
+};
+
+inline std::ostream& operator<<( std::ostream &os, const InternedString &s ) {
+    return os << s.str();
+}
+
+namespace std {
+    template<>
+    struct hash<InternedString> {
+        size_t operator()( const InternedString &s ) const noexcept {
+            return std::hash<const void*>{}( s.entry );
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,158 @@
+#include <fstream>
+#include <string_view>
+#include <array>
+#include <iterator>
+
+#include <sys/stat.h>
+
+#include "local_users.hpp"
+#include "utils.hpp"
+
+namespace {
+    // Length is not a secret, contents are compared without an early exit
+    bool equalSecret( std::string_view l, std::string_view r ) {
+        if( l.size() != r.size() ) {
+            return false;
+        }
+        uint8_t diff = 0;
+        for( size_t i = 0; i < l.size(); i++ ) {
+            diff |= l[ i ] ^ r[ i ];
+        }
+        return diff == 0;
+    }
+
+    bool parseLine( std::string_view line, std::string &user, LocalSubscriber &sub ) {
+        if( auto pos = line.find( '#' ); pos != std::string_view::npos ) {
+            line = line.substr( 0, pos );
+        }
+        std::array<std::string_view,5> tok;
+        size_t n = 0;
+        size_t i = 0;
+        while( true ) {
+            while( i < line.size() && ( line[ i ] == ' ' || line[ i ] == '\t' || line[ i ] == '\r' ) ) {
+                i++;
+            }
+            if( i == line.size() ) {
+                break;
+            }
+            if( n == tok.size() ) {
+                return false;
+            }
+            size_t start = i;
+            while( i < line.size() && line[ i ] != ' ' && line[ i ] != '\t' && line[ i ] != '\r' ) {
+                i++;
+            }
+            tok[ n++ ] = line.substr( start, i - start );
+        }
+        if( n < 2 ) {
+            return false;
+        }
+
+        user = tok[ 0 ];
+        sub = {};
+        sub.secret = tok[ 1 ];
+        for( size_t k = 2; k < n; k++ ) {
+            auto eq = tok[ k ].find( '=' );
+            if( eq == std::string_view::npos ) {
+                return false;
+            }
+            auto key = tok[ k ].substr( 0, eq );
+            auto value = std::string { tok[ k ].substr( eq + 1 ) };
+            if( key == "template" ) {
+                sub.pppoe_template = value;
+            } else if( key == "pool" ) {
+                sub.framed_pool = value;
+            } else if( key == "ip" ) {
+                boost::system::error_code ec;
+                sub.framed_ip = address_v4_t::from_string( value, ec );
+                if( ec ) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+std::tuple<LocalUsersStats,std::string> LocalUserDB::load( const std::string &path ) {
+    LocalUsersStats stats;
+    struct stat st;
+    if( stat( path.c_str(), &st ) != 0 ) {
+        return { stats, "Cannot find local users file " + path };
+    }
+    int64_t mtime = static_cast<int64_t>( st.st_mtim.tv_sec ) * 1'000'000'000 + st.st_mtim.tv_nsec;
+    if( path == loaded_path && mtime == mtime_ns && static_cast<uint64_t>( st.st_size ) == file_size ) {
+        return { stats, "" };
+    }
+
+    std::ifstream file { path, std::ios::binary };
+    if( !file.is_open() ) {
+        return { stats, "Cannot open local users file " + path };
+    }
+    std::string content { std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() };
+
+    std::unordered_map<std::string,LocalSubscriber> fresh;
+    std::string_view rest { content };
+    std::string user;
+    LocalSubscriber sub;
+    while( !rest.empty() ) {
+        auto eol = rest.find( '\n' );
+        auto line = rest.substr( 0, eol );
+        rest.remove_prefix( eol == std::string_view::npos ? rest.size() : eol + 1 );
+        if( line.find_first_not_of( " \t\r" ) == std::string_view::npos || line.find_first_not_of( " \t\r" ) == line.find( '#' ) ) {
+            continue;
+        }
+        if( !parseLine( line, user, sub ) ) {
+            stats.ignored++;
+            continue;
+        }
+        fresh.insert_or_assign( std::move( user ), std::move( sub ) );
+    }
+
+    for( auto it = users.begin(); it != users.end(); ) {
+        if( fresh.find( it->first ) == fresh.end() ) {
+            it = users.erase( it );
+            stats.removed++;
+        } else {
+            it++;
+        }
+    }
+    for( auto &[ name, s ]: fresh ) {
+        if( auto [ it, ret ] = users.try_emplace( name, std::move( s ) ); ret ) {
+            stats.added++;
+        } else if( !( it->second == s ) ) {
+            it->second = std::move( s );
+            stats.changed++;
+        }
+    }
+
+    loaded_path = path;
+    mtime_ns = mtime;
+    file_size = st.st_size;
+    return { stats, "" };
+}
+
+const LocalSubscriber* LocalUserDB::find( const std::string &user ) const {
+    if( auto const &it = users.find( user ); it != users.end() ) {
+        return &it->second;
+    }
+    return nullptr;
+}
+
+size_t LocalUserDB::size() const {
+    return users.size();
+}
+
+bool LocalUserDB::checkPAP( const LocalSubscriber &sub, const std::string &pass ) {
+    return equalSecret( sub.secret, pass );
+}
+
+bool LocalUserDB::checkCHAP( const LocalSubscriber &sub, const std::string &challenge, const std::string &response ) {
+    if( response.size() != 1 + 16 ) {
+        return false;
+    }
+    auto digest = md5( { std::string_view { response }.substr( 0, 1 ), sub.secret, challenge } );
+    return equalSecret( { reinterpret_cast<const char*>( digest.data() ), digest.size() }, std::string_view { response }.substr( 1 ) );
+}
@@ -0,0 +1,53 @@
+#ifndef LOCAL_USERS_HPP
+#define LOCAL_USERS_HPP
+
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <boost/asio/ip/address_v4.hpp>
+
+using address_v4_t = boost::asio::ip::address_v4;
+
+struct LocalSubscriber {
+    std::string secret;
+    std::string pppoe_template;
+    address_v4_t framed_ip;
+    std::string framed_pool;
+
+    bool operator==( const LocalSubscriber &r ) const {
+        return secret == r.secret && pppoe_template == r.pppoe_template && framed_ip == r.framed_ip && framed_pool == r.framed_pool;
+    }
+};
+
+struct LocalUsersStats {
+    size_t added { 0 };
+    size_t changed { 0 };
+    size_t removed { 0 };
+    // Lines which could not be parsed, they are skipped
+    size_t ignored { 0 };
+};
+
+// Subscribers authenticated without RADIUS. The file has one subscriber per line:
+//   username secret [template=NAME] [ip=A.B.C.D] [pool=NAME]
+// '#' starts a comment
+class LocalUserDB {
+public:
+    // Reads path again if it changed since the last load. Entries which did not change are
+    // left alone, a file which cannot be read keeps the current entries
+    std::tuple<LocalUsersStats,std::string> load( const std::string &path );
+
+    const LocalSubscriber* find( const std::string &user ) const;
+    size_t size() const;
+
+    static bool checkPAP( const LocalSubscriber &sub, const std::string &pass );
+    // CHAP with MD5, RFC 1994: response is the identifier followed by the 16 byte value
+    static bool checkCHAP( const LocalSubscriber &sub, const std::string &challenge, const std::string &response );
+
+private:
+    std::string loaded_path;
+    int64_t mtime_ns { -1 };
+    uint64_t file_size { 0 };
+    std::unordered_map<std::string,LocalSubscriber> users;
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+#include "md5.hpp"
+
+// MD5 from RFC 1321 written once over a lane type: plain uint32_t for one message, GCC
+// vector types for several. Lane functions are forced inline so the vector code is
+// generated with the instruction set of the entry point calling them
+namespace {
+    using u32x4 = uint32_t __attribute__(( vector_size( 16 ) ));
+    using u32x8 = uint32_t __attribute__(( vector_size( 32 ) ));
+
+    constexpr uint32_t K[ 64 ] {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+
+    constexpr uint32_t S[ 64 ] {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+
+    template<typename V>
+    struct Lane {
+        static uint32_t get( const V &v, size_t l ) { return v[ l ]; }
+        static void set( V &v, size_t l, uint32_t x ) { v[ l ] = x; }
+    };
+
+    template<>
+    struct Lane<uint32_t> {
+        static uint32_t get( const uint32_t &v, size_t ) { return v; }
+        static void set( uint32_t &v, size_t, uint32_t x ) { v = x; }
+    };
+
+    inline uint32_t load_le32( const uint8_t *p ) {
+        return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 ) | ( static_cast<uint32_t>( p[ 3 ] ) << 24 );
+    }
+
+    inline void store_le32( uint8_t *p, uint32_t v ) {
+        p[ 0 ] = v;
+        p[ 1 ] = v >> 8;
+        p[ 2 ] = v >> 16;
+        p[ 3 ] = v >> 24;
+    }
+
+    template<typename V>
+    __attribute__(( always_inline )) inline void compress( V ( &st )[ 4 ], const V ( &m )[ 16 ] ) {
+        V a = st[ 0 ], b = st[ 1 ], c = st[ 2 ], d = st[ 3 ];
+        // Unrolled, the round selection and the constants fold away
+#pragma GCC unroll 64
+        for( size_t i = 0; i < 64; i++ ) {
+            V f;
+            size_t g;
+            if( i < 16 ) {
+                f = d ^ ( b & ( c ^ d ) );
+                g = i;
+            } else if( i < 32 ) {
+                f = c ^ ( d & ( b ^ c ) );
+                g = ( 5 * i + 1 ) % 16;
+            } else if( i < 48 ) {
+                f = b ^ c ^ d;
+                g = ( 3 * i + 5 ) % 16;
+            } else {
+                f = c ^ ( b | ~d );
+                g = ( 7 * i ) % 16;
+            }
+            V x = a + f + K[ i ] + m[ g ];
+            a = d;
+            d = c;
+            c = b;
+            b = b + ( ( x << S[ i ] ) | ( x >> ( 32 - S[ i ] ) ) );
+        }
+        st[ 0 ] += a;
+        st[ 1 ] += b;
+        st[ 2 ] += c;
+        st[ 3 ] += d;
+    }
+
+    // Every lane gets a padded message of blocks[ l ] 64 byte blocks. Lanes with fewer blocks
+    // keep running over their last block, the state they compute there is thrown away
+    template<typename V, size_t L>
+    __attribute__(( always_inline )) inline void lanes( const uint8_t *const *msg, const size_t *blocks, authenticator_t *const *out ) {
+        V st[ 4 ];
+        st[ 0 ] = V{} + 0x67452301u;
+        st[ 1 ] = V{} + 0xefcdab89u;
+        st[ 2 ] = V{} + 0x98badcfeu;
+        st[ 3 ] = V{} + 0x10325476u;
+
+        size_t most = *std::max_element( blocks, blocks + L );
+        for( size_t b = 0; b < most; b++ ) {
+            if constexpr( L == 1 ) {
+                V m[ 16 ];
+                for( size_t w = 0; w < 16; w++ ) {
+                    m[ w ] = load_le32( msg[ 0 ] + 64 * b + 4 * w );
+                }
+                compress( st, m );
+                continue;
+            }
+            V m[ 16 ];
+            V active;
+            for( size_t l = 0; l < L; l++ ) {
+                auto p = msg[ l ] + 64 * std::min( b, blocks[ l ] - 1 );
+                for( size_t w = 0; w < 16; w++ ) {
+                    Lane<V>::set( m[ w ], l, load_le32( p + 4 * w ) );
+                }
+                Lane<V>::set( active, l, b < blocks[ l ] ? ~0u : 0u );
+            }
+            V prev[ 4 ] = { st[ 0 ], st[ 1 ], st[ 2 ], st[ 3 ] };
+            compress( st, m );
+            for( size_t k = 0; k < 4; k++ ) {
+                st[ k ] = ( st[ k ] & active ) | ( prev[ k ] & ~active );
+            }
+        }
+
+        for( size_t l = 0; l < L; l++ ) {
+            for( size_t k = 0; k < 4; k++ ) {
+                store_le32( out[ l ]->data() + 4 * k, Lane<V>::get( st[ k ], l ) );
+            }
+        }
+    }
+
+    void md5_x1( const uint8_t *const *msg, const size_t *blocks, authenticator_t *const *out ) {
+        lanes<uint32_t,1>( msg, blocks, out );
+    }
+
+    void md5_x4( const uint8_t *const *msg, const size_t *blocks, authenticator_t *const *out ) {
+        lanes<u32x4,4>( msg, blocks, out );
+    }
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+    __attribute__(( target( "avx2" ) )) void md5_x8( const uint8_t *const *msg, const size_t *blocks, authenticator_t *const *out ) {
+        lanes<u32x8,8>( msg, blocks, out );
+    }
+
+    bool have_avx2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "avx2" );
+    }
+#else
+    void md5_x8( const uint8_t *const *msg, const size_t *blocks, authenticator_t *const *out ) {
+        lanes<u32x8,8>( msg, blocks, out );
+    }
+
+    bool have_avx2() {
+        return false;
+    }
+#endif
+
+    size_t width() {
+        static const size_t w = have_avx2() ? 8 : 4;
+        return w;
+    }
+
+    // Parts are joined and padded here, messages are kept in one buffer between batches
+    thread_local std::vector<uint8_t> scratch;
+    thread_local std::vector<size_t> offsets;
+    thread_local std::vector<size_t> nblocks;
+    thread_local std::vector<size_t> order;
+}
+
+void md5_batch( Md5Job *jobs, size_t n ) {
+    if( n == 0 ) {
+        return;
+    }
+
+    offsets.resize( n );
+    nblocks.resize( n );
+    size_t total = 0;
+    for( size_t i = 0; i < n; i++ ) {
+        size_t len = 0;
+        for( size_t p = 0; p < jobs[ i ].count; p++ ) {
+            len += jobs[ i ].parts[ p ].size();
+        }
+        // Room for 0x80 and the 64 bit length
+        nblocks[ i ] = ( len + 8 ) / 64 + 1;
+        offsets[ i ] = total;
+        total += nblocks[ i ] * 64;
+    }
+    scratch.resize( total );
+
+    for( size_t i = 0; i < n; i++ ) {
+        auto p = scratch.data() + offsets[ i ];
+        size_t len = 0;
+        for( size_t k = 0; k < jobs[ i ].count; k++ ) {
+            auto const &part = jobs[ i ].parts[ k ];
+            std::memcpy( p + len, part.data(), part.size() );
+            len += part.size();
+        }
+        size_t padded = nblocks[ i ] * 64;
+        p[ len ] = 0x80;
+        std::memset( p + len + 1, 0, padded - len - 1 );
+        uint64_t bits = static_cast<uint64_t>( len ) * 8;
+        for( size_t b = 0; b < 8; b++ ) {
+            p[ padded - 8 + b ] = bits >> ( 8 * b );
+        }
+    }
+
+    // Messages of the same length share a group, so lanes seldom idle
+    order.resize( n );
+    std::iota( order.begin(), order.end(), 0 );
+    std::sort( order.begin(), order.end(), []( size_t l, size_t r ) { return nblocks[ l ] < nblocks[ r ]; } );
+
+    authenticator_t unused;
+    for( size_t i = 0; i < n; ) {
+        size_t left = n - i;
+        size_t w = left == 1 ? 1 : left <= 4 ? 4 : width();
+        std::array<const uint8_t*,8> msg;
+        std::array<size_t,8> blocks;
+        std::array<authenticator_t*,8> out;
+        for( size_t l = 0; l < w; l++ ) {
+            // Spare lanes repeat the first message and write nowhere
+            auto j = order[ l < left ? i + l : i ];
+            msg[ l ] = scratch.data() + offsets[ j ];
+            blocks[ l ] = nblocks[ j ];
+            out[ l ] = l < left ? jobs[ j ].out : &unused;
+        }
+        switch( w ) {
+        case 1: md5_x1( msg.data(), blocks.data(), out.data() ); break;
+        case 4: md5_x4( msg.data(), blocks.data(), out.data() ); break;
+        default: md5_x8( msg.data(), blocks.data(), out.data() ); break;
+        }
+        i += std::min( w, left );
+    }
+}
+
+const char* md5_engine() {
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return width() == 8 ? "avx2" : "sse2";
+#else
+    return "generic";
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef MD5_HPP
+#define MD5_HPP
+
+#include <array>
+#include <string_view>
+#include <initializer_list>
+
+#include "utils.hpp"
+
+// One message of a batch, the digest of the concatenated parts is written to out
+struct Md5Job {
+    std::array<std::string_view,4> parts;
+    size_t count { 0 };
+    authenticator_t *out { nullptr };
+
+    Md5Job() = default;
+
+    Md5Job( std::initializer_list<std::string_view> p, authenticator_t &o ):
+        out( &o )
+    {
+        for( auto const &s: p ) {
+            if( count < parts.size() ) {
+                parts[ count++ ] = s;
+            }
+        }
+    }
+};
+
+// Hashes independent messages side by side, 8 lanes with AVX2, 4 lanes with SSE2 or
+// the compiler's generic vectors, one at a time when there is a single message.
+// The instruction set is picked once on the first call
+void md5_batch( Md5Job *jobs, size_t n );
+
+// Name of the engine md5_batch() uses on this CPU: avx2, sse2 or generic
+const char* md5_engine();
+
+#endif
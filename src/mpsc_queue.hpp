@@ -0,0 +1,57 @@
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <optional>
+
+// Unbounded lock-free queue for many producers and a single consumer (Vyukov's
+// intrusive MPSC). push() may be called from any thread, pop() only from the consumer.
+// pop() may miss an element whose push() is still in progress, producers have to
+// signal the consumer after pushing
+template<typename T>
+class MPSCQueue {
+public:
+    MPSCQueue():
+        head( new Node ),
+        tail( head.load() )
+    {}
+
+    MPSCQueue( const MPSCQueue& ) = delete;
+    MPSCQueue& operator=( const MPSCQueue& ) = delete;
+
+    ~MPSCQueue() {
+        while( pop() ) {}
+        delete tail;
+    }
+
+    void push( T value ) {
+        auto node = new Node;
+        node->value.emplace( std::move( value ) );
+        auto prev = head.exchange( node, std::memory_order_acq_rel );
+        prev->next.store( node, std::memory_order_release );
+    }
+
+    std::optional<T> pop() {
+        auto next = tail->next.load( std::memory_order_acquire );
+        if( next == nullptr ) {
+            return std::nullopt;
+        }
+        // next becomes the new stub, its value is moved out
+        std::optional<T> out { std::move( next->value ) };
+        next->value.reset();
+        delete tail;
+        tail = next;
+        return out;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next { nullptr };
+        std::optional<T> value;
+    };
+
+    std::atomic<Node*> head;
+    Node *tail;
+};
+
+#endif
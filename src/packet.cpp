@@ -20,6 +20,9 @@ std::set<IPCP_OPT_HDR*> PPP_LCP::parseIPCPOptions() {
     size_t offset = 0;
     while( offset + sizeof( *this ) < bswap( length ) ) {
         auto opt = reinterpret_cast<IPCP_OPT_HDR*>( data + offset );
+        if( opt->len < 2 ) {
+            break;
+        }
         offset += opt->len;
         options.emplace( opt );
     } 
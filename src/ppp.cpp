@@ -34,7 +34,7 @@ std::string ppp::processPPP( std::vector<uint8_t> &inPkt, const encapsulation_t
     auto &session = sessionIt->second;
     if( !session->started ) {
         session->lcp.open();
-        session->lcp.layer_up();
+        session->lcp.up();
         session->started = true;
     }
 
@@ -55,9 +55,9 @@ std::string ppp::processPPP( std::vector<uint8_t> &inPkt, const encapsulation_t
                 } else {
                     // No authentication
                     session->ipcp.open();
-                    session->ipcp.layer_up();
+                    session->ipcp.up();
                 }
-            } else if( action == PPP_FSM_ACTION::LAYER_DOWN ) {
+            } else if( action == PPP_FSM_ACTION::LAYER_DOWN || action == PPP_FSM_ACTION::LAYER_FINISHED ) {
                 runtime->logger->logError() << LOGS::PPP << "LCP goes down, terminate session..." << std::endl;
                 if( auto const &err = runtime->deallocateSession( session->session_id ); !err.empty() ) {
                     return "Cannot terminate session: " + err;
@@ -81,11 +81,28 @@ std::string ppp::processPPP( std::vector<uint8_t> &inPkt, const encapsulation_t
         } else {
             if( action == PPP_FSM_ACTION::LAYER_UP ) {
                 runtime->logger->logInfo() << LOGS::PPP << "IPCP is opened: configuring vpp" << std::endl;
-                if( auto const &err = session->provision_dp(); !err.empty() ) {
-                    runtime->logger->logError() << LOGS::PPP << "Cannot get ip config for session: " << err << std::endl;
+                session->provision_dp( [ weak = std::weak_ptr<PPPOESession>( session ) ]( const std::string &err ) {
+                    auto session = weak.lock();
+                    if( !session ) {
+                        return;
+                    }
+                    if( !err.empty() ) {
+                        runtime->logger->logError() << LOGS::PPP << "Cannot get ip config for session: " << err << std::endl;
+                    }
+                    runtime->aaa->mapIfaceToSession( session->aaa_session_id, session->ifindex );
+                    session->startEcho(); // Start LCP Echo mechanism to detect dead sessions
+                });
+            } else if( action == PPP_FSM_ACTION::LAYER_DOWN ) {
+                // Renegotiation or Terminate-Request: no forwarding until IPCP is opened again
+                runtime->logger->logInfo() << LOGS::PPP << "IPCP goes down: removing session from vpp" << std::endl;
+                // Interims keep reporting what was counted so far
+                session->deprovision_dp();
+            } else if( action == PPP_FSM_ACTION::LAYER_FINISHED ) {
+                // IPCP is the only network protocol, nothing is left to carry
+                runtime->logger->logError() << LOGS::PPP << "IPCP is finished, terminate session..." << std::endl;
+                if( auto const &err = runtime->deallocateSession( session->session_id ); !err.empty() ) {
+                    return "Cannot terminate session: " + err;
                 }
-                runtime->aaa->mapIfaceToSession( session->aaa_session_id, session->ifindex );
-                session->startEcho(); // Start LCP Echo mechanism to detect dead sessions
             }
         }
         break;
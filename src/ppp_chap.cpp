@@ -79,7 +79,7 @@ FSM_RET PPP_CHAP::send_auth_ack() {
     runtime->ppp_outcoming.push( std::move( inPkt ) );
 
     session.ipcp.open();
-    session.ipcp.layer_up();
+    session.ipcp.up();
     
     return { PPP_FSM_ACTION::LAYER_UP, "" };
 }
@@ -2,202 +2,441 @@
 #include <string>
 #include <memory>
 #include <iostream>
+#include <sstream>
+#include <algorithm>
 
 #include "ppp_fsm.hpp"
+#include "ppp_lcp.hpp"
+#include "ppp_ipcp.hpp"
 #include "packet.hpp"
 #include "runtime.hpp"
+#include "session.hpp"
 #include "log.hpp"
 #include "string_helpers.hpp"
 
-using namespace std::string_literals;
-
 extern std::shared_ptr<PPPOERuntime> runtime;
 
-FSM_RET PPP_FSM::receive( std::vector<uint8_t> &inPkt ) {
-    runtime->logger->logDebug() << "receive pkt in state: " << state << std::endl;
-    PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
-    PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
+namespace {
+    // RFC 1661 4.4 actions, executed in this order
+    enum FSM_DO: uint16_t {
+        TLD = 1 << 0,
+        TLS = 1 << 1,
+        IRC = 1 << 2,
+        ZRC = 1 << 3,
+        SCR = 1 << 4,
+        SCA = 1 << 5,
+        SCN = 1 << 6,
+        STR = 1 << 7,
+        STA = 1 << 8,
+        SCJ = 1 << 9,
+        SER = 1 << 10,
+        TLU = 1 << 11,
+        TLF = 1 << 12,
+        // The event is not expected in this state
+        ILLEGAL = 1 << 15
+    };
+
+    struct FSM_TRANSITION {
+        PPP_FSM_STATE next;
+        uint16_t actions;
+    };
+
+    constexpr size_t FSM_STATES = static_cast<size_t>( PPP_FSM_STATE::Opened ) + 1;
+    constexpr size_t FSM_EVENTS = static_cast<size_t>( PPP_FSM_EVENT::RXR ) + 1;
+
+    constexpr FSM_TRANSITION T( PPP_FSM_STATE next, uint16_t actions = 0 ) {
+        return { next, actions };
+    }
+    constexpr FSM_TRANSITION X { PPP_FSM_STATE::Initial, ILLEGAL };
+
+    constexpr auto S0 = PPP_FSM_STATE::Initial;
+    constexpr auto S1 = PPP_FSM_STATE::Starting;
+    constexpr auto S2 = PPP_FSM_STATE::Closed;
+    constexpr auto S3 = PPP_FSM_STATE::Stopped;
+    constexpr auto S4 = PPP_FSM_STATE::Closing;
+    constexpr auto S5 = PPP_FSM_STATE::Stopping;
+    constexpr auto S6 = PPP_FSM_STATE::Req_Sent;
+    constexpr auto S7 = PPP_FSM_STATE::Ack_Rcvd;
+    constexpr auto S8 = PPP_FSM_STATE::Ack_Sent;
+    constexpr auto S9 = PPP_FSM_STATE::Opened;
+
+    // RFC 1661 4.1, rows are events and columns are states. Restart and passive options are not used
+    constexpr FSM_TRANSITION FSM_TABLE[ FSM_EVENTS ][ FSM_STATES ] = {
+        /*          Initial       Starting           Closed             Stopped                Closing          Stopping         Req_Sent           Ack_Rcvd          Ack_Sent           Opened */
+        /* Up   */ { T( S2 ),      T( S6, IRC|SCR ),  X,                 X,                     X,               X,               X,                 X,                X,                 X },
+        /* Down */ { X,            X,                 T( S0 ),           T( S1, TLS ),          T( S0 ),         T( S1 ),         T( S1 ),           T( S1 ),          T( S1 ),           T( S1, TLD ) },
+        /* Open */ { T( S1, TLS ), T( S1 ),           T( S6, IRC|SCR ),  T( S3 ),               T( S5 ),         T( S5 ),         T( S6 ),           T( S7 ),          T( S8 ),           T( S9 ) },
+        /* Close*/ { T( S0 ),      T( S0, TLF ),      T( S2 ),           T( S2 ),               T( S4 ),         T( S4 ),         T( S4, IRC|STR ),  T( S4, IRC|STR ), T( S4, IRC|STR ),  T( S4, TLD|IRC|STR ) },
+        /* TO+  */ { X,            X,                 X,                 X,                     T( S4, STR ),    T( S5, STR ),    T( S6, SCR ),      T( S6, SCR ),     T( S8, SCR ),      X },
+        /* TO-  */ { X,            X,                 X,                 X,                     T( S2, TLF ),    T( S3, TLF ),    T( S3, TLF ),      T( S3, TLF ),     T( S3, TLF ),      X },
+        /* RCR+ */ { X,            X,                 T( S2, STA ),      T( S8, IRC|SCR|SCA ),  T( S4 ),         T( S5 ),         T( S8, SCA ),      T( S9, SCA|TLU ), T( S8, SCA ),      T( S8, TLD|SCR|SCA ) },
+        /* RCR- */ { X,            X,                 T( S2, STA ),      T( S6, IRC|SCR|SCN ),  T( S4 ),         T( S5 ),         T( S6, SCN ),      T( S7, SCN ),     T( S6, SCN ),      T( S6, TLD|SCR|SCN ) },
+        /* RCA  */ { X,            X,                 T( S2, STA ),      T( S3, STA ),          T( S4 ),         T( S5 ),         T( S7, IRC ),      T( S6, SCR ),     T( S9, IRC|TLU ),  T( S6, TLD|SCR ) },
+        /* RCN  */ { X,            X,                 T( S2, STA ),      T( S3, STA ),          T( S4 ),         T( S5 ),         T( S6, IRC|SCR ),  T( S6, SCR ),     T( S8, IRC|SCR ),  T( S6, TLD|SCR ) },
+        /* RTR  */ { X,            X,                 T( S2, STA ),      T( S3, STA ),          T( S4, STA ),    T( S5, STA ),    T( S6, STA ),      T( S6, STA ),     T( S6, STA ),      T( S5, TLD|ZRC|STA ) },
+        /* RTA  */ { X,            X,                 T( S2 ),           T( S3 ),               T( S2, TLF ),    T( S3, TLF ),    T( S6 ),           T( S6 ),          T( S8 ),           T( S6, TLD|SCR ) },
+        /* RUC  */ { X,            X,                 T( S2, SCJ ),      T( S3, SCJ ),          T( S4, SCJ ),    T( S5, SCJ ),    T( S6, SCJ ),      T( S7, SCJ ),     T( S8, SCJ ),      T( S9, SCJ ) },
+        /* RXJ+ */ { X,            X,                 T( S2 ),           T( S3 ),               T( S4 ),         T( S5 ),         T( S6 ),           T( S6 ),          T( S8 ),           T( S9 ) },
+        /* RXJ- */ { X,            X,                 T( S2, TLF ),      T( S3, TLF ),          T( S2, TLF ),    T( S3, TLF ),    T( S3, TLF ),      T( S3, TLF ),     T( S3, TLF ),      T( S5, TLD|IRC|STR ) },
+        /* RXR  */ { X,            X,                 T( S2 ),           T( S3 ),               T( S4 ),         T( S5 ),         T( S6 ),           T( S7 ),          T( S8 ),           T( S9, SER ) }
+    };
+
+    constexpr const FSM_TRANSITION& transition( PPP_FSM_EVENT ev, PPP_FSM_STATE state ) {
+        return FSM_TABLE[ static_cast<size_t>( ev ) ][ static_cast<size_t>( state ) ];
+    }
+
+    constexpr bool same( const FSM_TRANSITION &l, const FSM_TRANSITION &r ) {
+        return l.next == r.next && l.actions == r.actions;
+    }
+
+    static_assert( transition( PPP_FSM_EVENT::RCA, PPP_FSM_STATE::Ack_Sent ).next == PPP_FSM_STATE::Opened );
+    static_assert( transition( PPP_FSM_EVENT::RTR, PPP_FSM_STATE::Opened ).next == PPP_FSM_STATE::Stopping );
+
+    // RFC 1661 4.6
+    constexpr uint8_t MAX_TERMINATE { 2 };
+    constexpr uint8_t MAX_CONFIGURE { 10 };
+    constexpr uint8_t MAX_FAILURE { 5 };
+
+    // States that wait for an answer to a Configure or Terminate-Request
+    constexpr bool restart_running( PPP_FSM_STATE state ) {
+        switch( state ) {
+        case PPP_FSM_STATE::Closing:
+        case PPP_FSM_STATE::Stopping:
+        case PPP_FSM_STATE::Req_Sent:
+        case PPP_FSM_STATE::Ack_Rcvd:
+        case PPP_FSM_STATE::Ack_Sent:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Options of a Configure packet starting at the PPPoE header, the packet is checked already
+    std::vector<const LCP_OPT_HDR*> conf_options( const std::vector<uint8_t> &pkt ) {
+        auto lcp = reinterpret_cast<const PPP_LCP*>( reinterpret_cast<const PPPOESESSION_HDR*>( pkt.data() )->data );
+        uint32_t len = bswap( lcp->length ) - sizeof( PPP_LCP );
+        std::vector<const LCP_OPT_HDR*> opts;
+        for( uint32_t offset = 0; len - offset >= sizeof( LCP_OPT_HDR ); ) {
+            auto opt = reinterpret_cast<const LCP_OPT_HDR*>( lcp->data + offset );
+            if( opt->len < sizeof( LCP_OPT_HDR ) || opt->len > len - offset ) {
+                break;
+            }
+            opts.push_back( opt );
+            offset += opt->len;
+        }
+        return opts;
+    }
+}
+
+template<typename Derived>
+FSM_RET PPP_FSM<Derived>::up() {
+    return event( PPP_FSM_EVENT::Up );
+}
+
+template<typename Derived>
+FSM_RET PPP_FSM<Derived>::down() {
+    return event( PPP_FSM_EVENT::Down );
+}
 
-    if( lcp == nullptr ) {
-        return { PPP_FSM_ACTION::NONE, "LCP pointer is incorrect" };
+template<typename Derived>
+FSM_RET PPP_FSM<Derived>::open() {
+    return event( PPP_FSM_EVENT::Open );
+}
+
+template<typename Derived>
+FSM_RET PPP_FSM<Derived>::close() {
+    return event( PPP_FSM_EVENT::Close );
+}
+
+template<typename Derived>
+FSM_RET PPP_FSM<Derived>::timeout() {
+    if( restart_counter > 0 ) {
+        return event( PPP_FSM_EVENT::TO_Plus );
     }
+    return event( PPP_FSM_EVENT::TO_Minus );
+}
 
-    if( state == PPP_FSM_STATE::Initial || 
-        state == PPP_FSM_STATE::Starting ) {
-            std::stringstream ss;
-            ss << "Received packet in invalid state: " << state;
-            return { PPP_FSM_ACTION::NONE, ss.str() };
+template<typename Derived>
+FSM_RET PPP_FSM<Derived>::receive( std::vector<uint8_t> &inPkt ) {
+    if( inPkt.size() < sizeof( PPPOESESSION_HDR ) + sizeof( PPP_LCP ) ) {
+        return { PPP_FSM_ACTION::NONE, "Packet is too short" };
     }
-    
+    PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
+    PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
+    runtime->logger->logDebug() << Derived::log << "receive code " << static_cast<int>( lcp->code ) << " in state: " << state << std::endl;
+
+    PPP_FSM_EVENT ev;
     switch( lcp->code ) {
-    case LCP_CODE::CONF_REQ:
-        return recv_conf_req( inPkt );
+    case LCP_CODE::CONF_REQ: {
+        // Closed, Closing and Stopping answer the same whatever the options are
+        if( same( transition( PPP_FSM_EVENT::RCR_Plus, state ), transition( PPP_FSM_EVENT::RCR_Minus, state ) ) ) {
+            ev = PPP_FSM_EVENT::RCR_Plus;
+            break;
+        }
+        // The peer did not converge after Max-Failure Naks, its request is kept to reject instead
+        std::vector<uint8_t> request;
+        if( nak_counter >= MAX_FAILURE ) {
+            request = inPkt;
+        }
+        auto const &[ verdict, err ] = self().check_conf( inPkt );
+        if( !err.empty() ) {
+            return { PPP_FSM_ACTION::NONE, err };
+        }
+        // check_conf may reallocate the packet
+        lcp = reinterpret_cast<PPP_LCP*>( reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() )->data );
+        switch( verdict ) {
+        case PPP_CONF_CHECK::ACK:
+            lcp->code = LCP_CODE::CONF_ACK;
+            nak_counter = 0;
+            ev = PPP_FSM_EVENT::RCR_Plus;
+            break;
+        case PPP_CONF_CHECK::NAK:
+            if( !request.empty() && nak_to_rej( inPkt, request ) ) {
+                runtime->logger->logDebug() << Derived::log << "Max-Failure reached, rejecting options instead of Nak" << std::endl;
+                lcp = reinterpret_cast<PPP_LCP*>( reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() )->data );
+                lcp->code = LCP_CODE::CONF_REJ;
+                ev = PPP_FSM_EVENT::RCR_Minus;
+                break;
+            }
+            lcp->code = LCP_CODE::CONF_NAK;
+            nak_counter++;
+            ev = PPP_FSM_EVENT::RCR_Minus;
+            break;
+        case PPP_CONF_CHECK::REJ:
+            lcp->code = LCP_CODE::CONF_REJ;
+            ev = PPP_FSM_EVENT::RCR_Minus;
+            break;
+        }
         break;
+    }
     case LCP_CODE::CONF_ACK:
-        return recv_conf_ack( inPkt );
-	    break;
-    
     case LCP_CODE::CONF_NAK:
     case LCP_CODE::CONF_REJ:
-	    //fsm_rconfnakrej(f, code, id, inp, len);
-	    break;
-    
+        if( lcp->identifier != conf_id ) {
+            return { PPP_FSM_ACTION::NONE, "Packet identifier is not match with our" };
+        }
+        if( lcp->code == LCP_CODE::CONF_ACK ) {
+            ev = PPP_FSM_EVENT::RCA;
+            break;
+        }
+        if( auto const &err = self().recv_conf_nak_rej( inPkt ); !err.empty() ) {
+            // Nothing we could offer is acceptable
+            auto const &[ action, close_err ] = event( PPP_FSM_EVENT::Close );
+            return { action, err };
+        }
+        ev = PPP_FSM_EVENT::RCN;
+        break;
     case LCP_CODE::TERM_REQ:
-	    return recv_term_req( inPkt );
-	    break;
-    
+        ev = PPP_FSM_EVENT::RTR;
+        break;
     case LCP_CODE::TERM_ACK:
-	    //fsm_rtermack(f);
-	    break; 
-    
-    case LCP_CODE::CODE_REJ:
-        //fsm_rcoderej
+        ev = PPP_FSM_EVENT::RTA;
         break;
-    case LCP_CODE::ECHO_REQ:
-        return send_echo_rep( inPkt );
-    case LCP_CODE::ECHO_REPLY:
-        return recv_echo_rep( inPkt );
-    default:
-        //send CODEREJ
+    case LCP_CODE::CODE_REJ: {
+        // Rejecting any of the codes above makes the protocol unusable
+        auto rejected = static_cast<uint8_t>( lcp->data[ 0 ] );
+        ev = ( bswap( lcp->length ) > sizeof( PPP_LCP ) && rejected >= static_cast<uint8_t>( LCP_CODE::CONF_REQ ) && rejected <= static_cast<uint8_t>( LCP_CODE::CODE_REJ ) ) ?
+            PPP_FSM_EVENT::RXJ_Minus : PPP_FSM_EVENT::RXJ_Plus;
         break;
     }
-    runtime->logger->logDebug() << "FSM state: " << state << std::endl;
-
-    return { PPP_FSM_ACTION::NONE, "" };
-}
-
-FSM_RET PPP_FSM::recv_conf_req( std::vector<uint8_t> &inPkt ) {
-    runtime->logger->logDebug() << "recv_conf_req current state: " << state << std::endl;
-    switch( state ){
-    case PPP_FSM_STATE::Closing:
-    case PPP_FSM_STATE::Stopping:
-        return { PPP_FSM_ACTION::NONE, "We're stopping or closing right now" };
-    case PPP_FSM_STATE::Closed:
-        // send TERM ACK
-        return { PPP_FSM_ACTION::NONE, "Receive conf req in closed state" };
-    case PPP_FSM_STATE::Opened:
-        // Restart connection
-        layer_down();
-        send_conf_req();
-        state = PPP_FSM_STATE::Req_Sent;
-        return { PPP_FSM_ACTION::LAYER_DOWN, "" };
-        break;
-    case PPP_FSM_STATE::Stopped:
-        send_conf_req();
-        state = PPP_FSM_STATE::Req_Sent;
-        break;
     default:
+        ev = self().classify_code( inPkt );
         break;
     }
 
-    return check_conf( inPkt );
+    return event( ev, &inPkt );
 }
 
-void PPP_FSM::layer_up() {
-    switch( state ) {
-    case PPP_FSM_STATE::Initial:
-	    state = PPP_FSM_STATE::Closed;
-	    break;
-
-    case PPP_FSM_STATE::Starting:
-	    if( auto const &[ action, err ] = send_conf_req(); !err.empty() ) {
-            runtime->logger->logError() << "Cannot set layer up: " << err << std::endl;
-        } else {
-	        state = PPP_FSM_STATE::Req_Sent;
+template<typename Derived>
+FSM_RET PPP_FSM<Derived>::event( PPP_FSM_EVENT ev, std::vector<uint8_t> *inPkt ) {
+    auto const &t = transition( ev, state );
+    if( t.actions & ILLEGAL ) {
+        std::stringstream ss;
+        ss << "Event " << ev << " is not expected in state " << state;
+        return { PPP_FSM_ACTION::NONE, ss.str() };
+    }
+    runtime->logger->logDebug() << Derived::log << "event " << ev << ": " << state << " -> " << t.next << std::endl;
+
+    PPP_FSM_ACTION action { PPP_FSM_ACTION::NONE };
+    std::string err;
+    auto const &keep = [ &err ]( const FSM_RET &r ) {
+        if( auto const &e = std::get<1>( r ); !e.empty() && err.empty() ) {
+            err = e;
         }
-	    break;
+    };
 
-    default:
-        break;
+    // Actions see the state we are going to
+    state = t.next;
+
+    if( t.actions & TLD ) {
+        action = PPP_FSM_ACTION::LAYER_DOWN;
+    }
+    if( t.actions & TLS ) {
+        runtime->logger->logDebug() << Derived::log << "this layer started" << std::endl;
+    }
+    if( t.actions & IRC ) {
+        restart_counter = ( t.actions & STR ) ? MAX_TERMINATE : MAX_CONFIGURE;
+        if( !( t.actions & STR ) ) {
+            nak_counter = 0;
+        }
+    }
+    if( t.actions & ZRC ) {
+        restart_counter = 0;
+    }
+    // RFC 1661 4.4: each request sent uses up one restart
+    if( ( t.actions & ( SCR | STR ) ) && restart_counter > 0 ) {
+        restart_counter--;
+    }
+    if( t.actions & SCR ) {
+        conf_id = ++pkt_id;
+        keep( self().send_conf_req() );
+    }
+    if( t.actions & ( SCA | SCN ) ) {
+        send_reply( *inPkt );
+    }
+    if( t.actions & STR ) {
+        send_term_req();
+    }
+    if( t.actions & STA ) {
+        send_term_ack( reinterpret_cast<PPP_LCP*>( reinterpret_cast<PPPOESESSION_HDR*>( inPkt->data() )->data )->identifier );
+    }
+    if( t.actions & SCJ ) {
+        send_code_rej( *inPkt );
     }
+    if( t.actions & SER ) {
+        keep( self().recv_echo( *inPkt ) );
+    }
+    if( t.actions & TLU ) {
+        action = PPP_FSM_ACTION::LAYER_UP;
+    }
+    if( t.actions & TLF ) {
+        action = PPP_FSM_ACTION::LAYER_FINISHED;
+    }
+    // Every request we send restarts the timer, so does zeroing the counter for the peer's
+    // Terminate-Request. It stops once nothing is waiting for an answer
+    if( t.actions & ( SCR | STR | ZRC ) ) {
+        self().session.restart_timer( Derived::proto, true );
+    } else if( !restart_running( state ) ) {
+        self().session.restart_timer( Derived::proto, false );
+    }
+
+    return { action, err };
 }
 
-void PPP_FSM::layer_down() {
-    return;
+template<typename Derived>
+void PPP_FSM<Derived>::make_conf_rej( std::vector<uint8_t> &inPkt, const std::vector<uint8_t> &rejected ) {
+    inPkt.resize( sizeof( PPPOESESSION_HDR ) + sizeof( PPP_LCP ) );
+    inPkt.insert( inPkt.end(), rejected.begin(), rejected.end() );
+
+    PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
+    PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
+    lcp->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + rejected.size() ) );
+    pppoe->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + rejected.size() + 2 ) ); // plus 2 bytes of ppp proto
 }
 
-void PPP_FSM::open() {
-    switch( state ) {
-    case PPP_FSM_STATE::Initial:
-        state = PPP_FSM_STATE::Starting;
-        //starting()
-        break;
-    case PPP_FSM_STATE::Closed:
-        if( auto const &[ action, err ] = send_conf_req(); !err.empty() ) {
-            runtime->logger->logError() << "Cannot set layer up: " << err << std::endl;
-        } else {
-	        state = PPP_FSM_STATE::Req_Sent;
+template<typename Derived>
+bool PPP_FSM<Derived>::nak_to_rej( std::vector<uint8_t> &inPkt, const std::vector<uint8_t> &request ) {
+    // Requested options the Nak suggests another value for
+    auto const &nak = conf_options( inPkt );
+    std::vector<uint8_t> rejected;
+    for( auto const &opt: conf_options( request ) ) {
+        auto bytes = reinterpret_cast<const uint8_t*>( opt );
+        if( std::any_of( nak.begin(), nak.end(), [ opt, bytes ]( const LCP_OPT_HDR *n ) {
+            return n->opt == opt->opt && !( n->len == opt->len && std::equal( bytes, bytes + opt->len, reinterpret_cast<const uint8_t*>( n ) ) );
+        } ) ) {
+            rejected.insert( rejected.end(), bytes, bytes + opt->len );
         }
-        break;
-    case PPP_FSM_STATE::Closing:
-        state = PPP_FSM_STATE::Stopping;
-    case PPP_FSM_STATE::Stopped:
-    case PPP_FSM_STATE::Opened:
-        // If restart
-        break;
-    default:
-        break;
     }
+    if( rejected.empty() ) {
+        return false;
+    }
+    make_conf_rej( inPkt, rejected );
+    return true;
 }
 
-FSM_RET PPP_FSM::recv_conf_ack( std::vector<uint8_t> &inPkt ) {
-    runtime->logger->logDebug() <<  "recv_conf_ack current state: " << state << std::endl;
+template<typename Derived>
+void PPP_FSM<Derived>::send_reply( std::vector<uint8_t> &inPkt ) {
+    auto &session = self().session;
+    auto header = session.encap.generate_header( runtime->hwaddr, ETH_PPPOE_SESSION );
+    inPkt.insert( inPkt.begin(), header.begin(), header.end() );
+
+    runtime->ppp_outcoming.push( std::move( inPkt ) );
+}
+
+template<typename Derived>
+void PPP_FSM<Derived>::send_term_req() {
+    runtime->logger->logDebug() << Derived::log << "Sending TERM REQ" << std::endl;
+    std::vector<uint8_t> pkt;
+    pkt.resize( sizeof( PPPOESESSION_HDR ) + sizeof( PPP_LCP ) );
+
+    PPPOESESSION_HDR* pppoe = reinterpret_cast<PPPOESESSION_HDR*>( pkt.data() );
+    pppoe->version = 1;
+    pppoe->type = 1;
+    pppoe->ppp_protocol = bswap( static_cast<uint16_t>( Derived::proto ) );
+    pppoe->code = PPPOE_CODE::SESSION_DATA;
+    pppoe->session_id = bswap( session_id );
+    pppoe->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + 2 ) ); // plus 2 bytes of ppp proto
 
-    // Parse in case of moved data
-    PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
     PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
+    lcp->code = LCP_CODE::TERM_REQ;
+    lcp->identifier = ++pkt_id;
+    lcp->length = bswap( (uint16_t)sizeof( PPP_LCP ) );
 
-    if( lcp->identifier != pkt_id ) {
-        return { PPP_FSM_ACTION::NONE, "Packet identifier is not match with our" };
-    }
+    send_reply( pkt );
+}
 
-    seen_ack = true;
+template<typename Derived>
+void PPP_FSM<Derived>::send_term_ack( uint8_t id ) {
+    runtime->logger->logDebug() << Derived::log << "Sending TERM ACK" << std::endl;
+    std::vector<uint8_t> pkt;
+    pkt.resize( sizeof( PPPOESESSION_HDR ) + sizeof( PPP_LCP ) );
 
-    switch( state ) {
-    case PPP_FSM_STATE::Closed:
-    case PPP_FSM_STATE::Stopped:
-        // send TERM ACK
-        break;
-    case PPP_FSM_STATE::Req_Sent:
-        state = PPP_FSM_STATE::Ack_Rcvd;
-        break;
-    case PPP_FSM_STATE::Ack_Rcvd:
-        runtime->logger->logDebug() <<  "extra ack, but not considering it is like a problem" << std::endl;
-        break;
-    case PPP_FSM_STATE::Ack_Sent:
-        state = PPP_FSM_STATE::Opened;
-        layer_up();
-        return { PPP_FSM_ACTION::LAYER_UP, "" };
-        break;
-    case PPP_FSM_STATE::Opened:
-        // Restarting the connection
-        send_conf_req();
-        state = PPP_FSM_STATE::Req_Sent;
-        return { PPP_FSM_ACTION::LAYER_DOWN, "" };
-        break;
-    default:
-        runtime->logger->logError() <<  "Incorrect state?" << std::endl;
-        break;
-    }
+    PPPOESESSION_HDR* pppoe = reinterpret_cast<PPPOESESSION_HDR*>( pkt.data() );
+    pppoe->version = 1;
+    pppoe->type = 1;
+    pppoe->ppp_protocol = bswap( static_cast<uint16_t>( Derived::proto ) );
+    pppoe->code = PPPOE_CODE::SESSION_DATA;
+    pppoe->session_id = bswap( session_id );
+    pppoe->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + 2 ) ); // plus 2 bytes of ppp proto
 
-    return { PPP_FSM_ACTION::NONE, "" };
+    PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
+    lcp->code = LCP_CODE::TERM_ACK;
+    lcp->identifier = id;
+    lcp->length = bswap( (uint16_t)sizeof( PPP_LCP ) );
+
+    send_reply( pkt );
 }
 
-FSM_RET PPP_FSM::recv_term_req( std::vector<uint8_t> &inPkt ) {
-    switch( state ) {
-    case PPP_FSM_STATE::Ack_Rcvd:
-    case PPP_FSM_STATE::Ack_Sent:
-	    state = PPP_FSM_STATE::Req_Sent;
-	    break;
-    case PPP_FSM_STATE::Opened:
-        state = PPP_FSM_STATE::Stopping;
-        send_term_ack( inPkt );
-        return { PPP_FSM_ACTION::LAYER_DOWN, "" };
-	    break;
-    default:
-       break;
+template<typename Derived>
+void PPP_FSM<Derived>::send_code_rej( const std::vector<uint8_t> &inPkt ) {
+    auto const *in_pppoe = reinterpret_cast<const PPPOESESSION_HDR*>( inPkt.data() );
+    auto const *rejected = reinterpret_cast<const uint8_t*>( in_pppoe->data );
+    size_t len = std::min<size_t>( bswap( in_pppoe->length ) - 2, inPkt.size() - sizeof( PPPOESESSION_HDR ) );
+    // Rejected packet is truncated to fit into the peer MRU
+    if( auto const mru = self().session.peer_MRU; mru > sizeof( PPP_LCP ) && len > mru - sizeof( PPP_LCP ) ) {
+        len = mru - sizeof( PPP_LCP );
     }
+    runtime->logger->logDebug() << Derived::log << "Sending CODE REJ for code " << static_cast<int>( rejected[ 0 ] ) << std::endl;
+
+    std::vector<uint8_t> pkt;
+    pkt.resize( sizeof( PPPOESESSION_HDR ) + sizeof( PPP_LCP ) );
+    pkt.insert( pkt.end(), rejected, rejected + len );
+
+    PPPOESESSION_HDR* pppoe = reinterpret_cast<PPPOESESSION_HDR*>( pkt.data() );
+    pppoe->version = 1;
+    pppoe->type = 1;
+    pppoe->ppp_protocol = bswap( static_cast<uint16_t>( Derived::proto ) );
+    pppoe->code = PPPOE_CODE::SESSION_DATA;
+    pppoe->session_id = bswap( session_id );
+    pppoe->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + len + 2 ) ); // plus 2 bytes of ppp proto
+
+    PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
+    lcp->code = LCP_CODE::CODE_REJ;
+    lcp->identifier = ++pkt_id;
+    lcp->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + len ) );
+
+    send_reply( pkt );
+}
 
-    send_term_ack( inPkt );
-    return { PPP_FSM_ACTION::NONE, "" };
-}
\ No newline at end of file
+template struct PPP_FSM<LCP_FSM>;
+template struct PPP_FSM<IPCP_FSM>;
@@ -1,6 +1,11 @@
 #ifndef PPP_FSM_HPP_
 #define PPP_FSM_HPP_
 
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
 enum class PPP_FSM_STATE: uint8_t {
     Initial = 0,
     Starting,
@@ -14,53 +19,101 @@ enum class PPP_FSM_STATE: uint8_t {
     Opened
 };
 
+// RFC 1661 4.1 events, the rows of the transition table
+enum class PPP_FSM_EVENT: uint8_t {
+    Up = 0,
+    Down,
+    Open,
+    Close,
+    TO_Plus,
+    TO_Minus,
+    RCR_Plus,
+    RCR_Minus,
+    RCA,
+    RCN,
+    RTR,
+    RTA,
+    RUC,
+    RXJ_Plus,
+    RXJ_Minus,
+    RXR
+};
+
 enum class PPP_FSM_ACTION: uint8_t {
     NONE,
     LAYER_UP,
-    LAYER_DOWN
+    LAYER_DOWN,
+    // This layer is finished, the lower one may go down too
+    LAYER_FINISHED
 };
 
 using FSM_RET = std::tuple<PPP_FSM_ACTION,std::string>;
 
+// Verdict of a Configure-Request check, the request is already rewritten into the reply
+enum class PPP_CONF_CHECK: uint8_t {
+    ACK,
+    NAK,
+    REJ
+};
+
+// RFC 1661 automaton shared by LCP and IPCP. Transitions come from a constexpr table,
+// the protocol is bound at compile time: Derived provides
+//   static constexpr PPP_PROTO proto and LOGS log
+//   PPPOESession &session
+//   FSM_RET send_conf_req()
+//   std::tuple<PPP_CONF_CHECK,std::string> check_conf( std::vector<uint8_t> &inPkt )
+// and may hide the hooks below. Members are instantiated in ppp_fsm.cpp for LCP_FSM and IPCP_FSM
+template<typename Derived>
 struct PPP_FSM {
 protected:
     PPP_FSM_STATE state { PPP_FSM_STATE::Initial };
     uint8_t nak_counter { 0U };
+    uint8_t restart_counter { 0U };
     uint16_t session_id { 0U };
     uint8_t pkt_id { 1U };
+    // Identifier of our last Configure-Request
+    uint8_t conf_id { 0U };
 
-    bool seen_ack { false };
 public:
-
     PPP_FSM( uint16_t sid ):
         session_id( sid )
     {}
 
+    // Events from the session
+    FSM_RET up();
+    FSM_RET down();
+    FSM_RET open();
+    FSM_RET close();
+    // Restart timer expired
+    FSM_RET timeout();
+
+    // Events from the peer, inPkt starts at the PPPoE header
     FSM_RET receive( std::vector<uint8_t> &inPkt );
-    void open();
-
-    // Actions
-	void layer_up();
-	void layer_down();
-	void layer_started();
-	void layer_finished();
-
-    // Events
-    FSM_RET recv_conf_req( std::vector<uint8_t> &inPkt );
-    FSM_RET recv_conf_ack( std::vector<uint8_t> &inPkt );
-    FSM_RET recv_term_req( std::vector<uint8_t> &inPkt );
-
-    //Overrided
-	virtual FSM_RET send_conf_req() = 0;
-	virtual FSM_RET send_conf_ack( std::vector<uint8_t> &inPkt ) = 0;
-	virtual FSM_RET send_conf_nak( std::vector<uint8_t> &inPkt ) = 0;
-    virtual FSM_RET check_conf( std::vector<uint8_t> &inPkt ) = 0;
-	virtual FSM_RET send_conf_rej( std::vector<uint8_t> &rejected_options, uint8_t pkt_id ) = 0;
-	virtual FSM_RET send_code_rej() = 0;
-	virtual FSM_RET send_term_req() = 0;
-	virtual FSM_RET send_term_ack( std::vector<uint8_t> &inPkt ) = 0;
-    virtual FSM_RET send_echo_rep( std::vector<uint8_t> &inPkt ) = 0;
-    virtual FSM_RET recv_echo_rep( std::vector<uint8_t> &inPkt ) = 0;
+
+    PPP_FSM_STATE get_state() const { return state; }
+
+protected:
+    // Hooks with the defaults for a protocol without extra codes
+    // Configure-Nak or Configure-Reject for our request, adjust the next one
+    std::string recv_conf_nak_rej( std::vector<uint8_t>& ) { return {}; }
+    // Codes above Code-Reject: RXR, RXJ+, RXJ- or RUC
+    PPP_FSM_EVENT classify_code( std::vector<uint8_t>& ) { return PPP_FSM_EVENT::RUC; }
+    // Echo or Discard in Opened
+    FSM_RET recv_echo( std::vector<uint8_t>& ) { return { PPP_FSM_ACTION::NONE, "" }; }
+
+    // Strips options of a received Configure-Request down to rejected ones
+    void make_conf_rej( std::vector<uint8_t> &inPkt, const std::vector<uint8_t> &rejected );
+
+private:
+    Derived& self() { return static_cast<Derived&>( *this ); }
+
+    FSM_RET event( PPP_FSM_EVENT ev, std::vector<uint8_t> *inPkt = nullptr );
+    void send_term_req();
+    void send_term_ack( uint8_t id );
+    void send_code_rej( const std::vector<uint8_t> &inPkt );
+    void send_reply( std::vector<uint8_t> &inPkt );
+    // Rewrites a Nak into a Reject of the requested options it changes, false if there are none
+    bool nak_to_rej( std::vector<uint8_t> &inPkt, const std::vector<uint8_t> &request );
 };
 
-#endif
\ No newline at end of file
+#endif
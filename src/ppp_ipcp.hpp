@@ -2,24 +2,21 @@
 #define PPP_IPCP_H_
 
 #include "ppp_fsm.hpp"
+#include "packet.hpp"
+#include "log.hpp"
 
 struct PPPOESession;
 
-struct IPCP_FSM: public PPP_FSM {
+struct IPCP_FSM: public PPP_FSM<IPCP_FSM> {
+	static constexpr PPP_PROTO proto { PPP_PROTO::IPCP };
+	static constexpr LOGS log { LOGS::IPCP };
+
 	PPPOESession &session;
 
     IPCP_FSM( PPPOESession &s );
 
-	FSM_RET send_conf_req() override;
-	FSM_RET send_conf_ack( std::vector<uint8_t> &inPkt ) override;
-	FSM_RET send_conf_nak( std::vector<uint8_t> &inPkt ) override;
-    FSM_RET check_conf( std::vector<uint8_t> &inPkt ) override;
-	FSM_RET send_conf_rej( std::vector<uint8_t> &rejected_options, uint8_t pkt_id ) override;
-	FSM_RET send_code_rej() override;
-	FSM_RET send_term_req() override;
-	FSM_RET send_term_ack( std::vector<uint8_t> &inPkt ) override;
-	FSM_RET send_echo_rep( std::vector<uint8_t> &inPkt ) override;
-	FSM_RET recv_echo_rep( std::vector<uint8_t> &inPkt ) override;
+	FSM_RET send_conf_req();
+    std::tuple<PPP_CONF_CHECK,std::string> check_conf( std::vector<uint8_t> &inPkt );
 };
 
-#endif
\ No newline at end of file
+#endif
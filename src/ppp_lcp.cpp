@@ -12,8 +12,8 @@
 extern std::shared_ptr<PPPOERuntime> runtime;
 
 LCP_FSM::LCP_FSM( PPPOESession &s ):
-	session( s ),
-    PPP_FSM( s.session_id )
+    PPP_FSM( s.session_id ),
+	session( s )
 {}
 
 FSM_RET LCP_FSM::send_conf_req() {
@@ -36,21 +36,20 @@ FSM_RET LCP_FSM::send_conf_req() {
 
     // Fill LCP options
     auto lcpOpts = 0;
-    auto mru = reinterpret_cast<LCP_OPT_2B*>( lcp->data );
-    mru->set( LCP_OPTIONS::MRU, runtime->lcp_conf->MRU );
-    lcpOpts += mru->len;
+    if( send_mru ) {
+        auto opt = reinterpret_cast<LCP_OPT_2B*>( lcp->data + lcpOpts );
+        opt->set( LCP_OPTIONS::MRU, req_mru != 0 ? req_mru : runtime->lcp_conf->MRU );
+        lcpOpts += opt->len;
+    }
 
-    uint8_t *after_auth = nullptr;
     if( runtime->lcp_conf->authCHAP ) {
-        auto auth = reinterpret_cast<LCP_OPT_3B*>( mru->data );
+        auto auth = reinterpret_cast<LCP_OPT_3B*>( lcp->data + lcpOpts );
         auth->set( LCP_OPTIONS::AUTH_PROTO, static_cast<uint16_t>( PPP_PROTO::CHAP ), 5 );
         lcpOpts += auth->len;
-        after_auth = auth->data;
     } else if( runtime->lcp_conf->authPAP ) {
-        auto auth = reinterpret_cast<LCP_OPT_2B*>( mru->data );
+        auto auth = reinterpret_cast<LCP_OPT_2B*>( lcp->data + lcpOpts );
         auth->set( LCP_OPTIONS::AUTH_PROTO, static_cast<uint16_t>( PPP_PROTO::PAP ) );
         lcpOpts += auth->len;
-        after_auth = auth->data;
     } else {
         return { PPP_FSM_ACTION::NONE, "No Auth proto is chosen!" };
     }
@@ -59,9 +58,11 @@ FSM_RET LCP_FSM::send_conf_req() {
         session.our_magic_number = random_uin32_t();
     }
 
-    auto mn = reinterpret_cast<LCP_OPT_4B*>( after_auth );
-    mn->set( LCP_OPTIONS::MAGIC_NUMBER, session.our_magic_number );
-    lcpOpts += mn->len;
+    if( send_magic ) {
+        auto mn = reinterpret_cast<LCP_OPT_4B*>( lcp->data + lcpOpts );
+        mn->set( LCP_OPTIONS::MAGIC_NUMBER, session.our_magic_number );
+        lcpOpts += mn->len;
+    }
 
     // After all fix lenght in headers
     lcp->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + lcpOpts ) );
@@ -77,166 +78,118 @@ FSM_RET LCP_FSM::send_conf_req() {
     return { PPP_FSM_ACTION::NONE, "" };
 }
 
-FSM_RET LCP_FSM::send_conf_ack( std::vector<uint8_t> &inPkt ) {
-    runtime->logger->logDebug() << LOGS::LCP << "send_conf_ack current state: " << state << std::endl;
-
-    PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
-
-    // Fill LCP part
-    PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
-    lcp->code = LCP_CODE::CONF_ACK;
-
-    auto header = session.encap.generate_header( runtime->hwaddr, ETH_PPPOE_SESSION );
-    inPkt.insert( inPkt.begin(), header.begin(), header.end() );
-
-    // Send this CONF REQ
-    runtime->ppp_outcoming.push( std::move( inPkt ) );
-    if( state == PPP_FSM_STATE::Opened ) {
-        return { PPP_FSM_ACTION::LAYER_UP, "" };
-    }
-
-    return { PPP_FSM_ACTION::NONE, "" };
-}
-
-FSM_RET LCP_FSM::send_conf_nak( std::vector<uint8_t> &inPkt ) {
-    runtime->logger->logDebug() << LOGS::LCP << "send_conf_nak current state: " << state << std::endl;
-
-    PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
-
-    // Fill LCP part
-    PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
-    lcp->code = LCP_CODE::CONF_NAK;
-
-    auto header = session.encap.generate_header( runtime->hwaddr, ETH_PPPOE_SESSION );
-    inPkt.insert( inPkt.begin(), header.begin(), header.end() );
-
-    // Send this CONF REQ
-    runtime->ppp_outcoming.push( std::move( inPkt ) );
-
-    return { PPP_FSM_ACTION::NONE, "" };
-}
-
-FSM_RET LCP_FSM::check_conf( std::vector<uint8_t> &inPkt ) {
+std::tuple<PPP_CONF_CHECK,std::string> LCP_FSM::check_conf( std::vector<uint8_t> &inPkt ) {
     PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
     PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
 
-    uint32_t len = bswap( lcp->length ) - sizeof( PPP_LCP );
-    if( len <= 0 ) {
-        return { PPP_FSM_ACTION::NONE, "There is no options" };
+    uint32_t len = bswap( lcp->length );
+    if( len < sizeof( PPP_LCP ) || sizeof( PPPOESESSION_HDR ) + len > inPkt.size() ) {
+        return { PPP_CONF_CHECK::REJ, "Incorrect LCP length" };
     }
+    len -= sizeof( PPP_LCP );
 
-    LCP_CODE code = LCP_CODE::CONF_ACK;
     std::vector<uint8_t> rejected_options;
     uint32_t offset = 0;
     while( len > offset ) {
         auto opt = reinterpret_cast<LCP_OPT_HDR*>( lcp->data + offset );
+        if( len - offset < sizeof( LCP_OPT_HDR ) || opt->len < sizeof( LCP_OPT_HDR ) || opt->len > len - offset ) {
+            return { PPP_CONF_CHECK::REJ, "Malformed LCP option" };
+        }
         offset += opt->len;
-        if( opt->opt == LCP_OPTIONS::MRU ) {
+        if( opt->opt == LCP_OPTIONS::MRU && opt->len == sizeof( LCP_OPT_2B ) ) {
             auto mru = reinterpret_cast<LCP_OPT_2B*>( opt );
             session.peer_MRU = ntohs( mru->val );
-        } else if( opt->opt == LCP_OPTIONS::MAGIC_NUMBER ) {
+        } else if( opt->opt == LCP_OPTIONS::MAGIC_NUMBER && opt->len == sizeof( LCP_OPT_4B ) ) {
             auto mn = reinterpret_cast<LCP_OPT_4B*>( opt );
             session.peer_magic_number = ntohl( mn->val );
         } else {
-            code = LCP_CODE::CONF_REJ;
             rejected_options.insert( rejected_options.end(), (uint8_t*)opt, (uint8_t*)opt + opt->len );
         }
     }
 
-    //send pkt
-    if( code == LCP_CODE::CONF_ACK ) {
-        if( state == PPP_FSM_STATE::Ack_Rcvd ) {
-            state = PPP_FSM_STATE::Opened;
-            layer_up();
-        } else {
-            state = PPP_FSM_STATE::Ack_Sent;
-        }
-        nak_counter = 0;
-        return send_conf_ack( inPkt );
-    } else {
-        if( state != PPP_FSM_STATE::Ack_Rcvd ) {
-            state = PPP_FSM_STATE::Req_Sent;
-        }
-        if( code == LCP_CODE::CONF_NAK ) {
-            nak_counter++;
-        }
-        if( code == LCP_CODE::CONF_NAK )
-            return send_conf_nak( inPkt );
-        if( code == LCP_CODE::CONF_REJ )
-            return send_conf_rej( rejected_options, lcp->identifier );
+    if( !rejected_options.empty() ) {
+        make_conf_rej( inPkt, rejected_options );
+        return { PPP_CONF_CHECK::REJ, "" };
     }
-
-    return { PPP_FSM_ACTION::NONE, "" };
+    return { PPP_CONF_CHECK::ACK, "" };
 }
 
-FSM_RET LCP_FSM::send_conf_rej( std::vector<uint8_t> &rejected_options, uint8_t pkt_id ) {
-    runtime->logger->logDebug() << LOGS::LCP << "send_conf_rej current state: " << state << std::endl;
-
-    std::vector<uint8_t> pkt;
-    pkt.resize( sizeof( PPPOESESSION_HDR ) + sizeof( PPP_LCP ) );
-
-    // Fill pppoe part
-    PPPOESESSION_HDR* pppoe = reinterpret_cast<PPPOESESSION_HDR*>( pkt.data() );
-    pppoe->version = 1;
-    pppoe->type = 1;
-    pppoe->ppp_protocol = bswap( static_cast<uint16_t>( PPP_PROTO::LCP ) );
-    pppoe->code = PPPOE_CODE::SESSION_DATA;
-    pppoe->session_id = bswap( session_id );
-
-    // Fill LCP part
+std::string LCP_FSM::recv_conf_nak_rej( std::vector<uint8_t> &inPkt ) {
+    PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
     PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
-    lcp->code = LCP_CODE::CONF_REJ;
-    lcp->identifier = pkt_id;
-    lcp->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + rejected_options.size() ) );
-
-    // Insert rejected options
-    pkt.insert( pkt.end(), rejected_options.begin(), rejected_options.end() );
-
-    // After all fix lenght in headers
-    pppoe = reinterpret_cast<PPPOESESSION_HDR*>( pkt.data() );
-    lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
-    pppoe->length = bswap( (uint16_t)( sizeof( PPP_LCP ) + rejected_options.size() + 2 ) ); // plus 2 bytes of ppp proto
+    bool rej = lcp->code == LCP_CODE::CONF_REJ;
 
-    auto header = session.encap.generate_header( runtime->hwaddr, ETH_PPPOE_SESSION );
-    pkt.insert( pkt.begin(), header.begin(), header.end() );
-
-    // Send this CONF REJ
-    runtime->ppp_outcoming.push( std::move( pkt ) );
-
-    return { PPP_FSM_ACTION::NONE, "" };
-}
-
-FSM_RET LCP_FSM::send_code_rej() {
-    return { PPP_FSM_ACTION::NONE, "" };
-}
+    uint32_t len = bswap( lcp->length );
+    if( len < sizeof( PPP_LCP ) || sizeof( PPPOESESSION_HDR ) + len > inPkt.size() ) {
+        return {};
+    }
+    len -= sizeof( PPP_LCP );
 
-FSM_RET LCP_FSM::send_term_req() {
-    return { PPP_FSM_ACTION::NONE, "" };
+    uint32_t offset = 0;
+    while( len - offset >= sizeof( LCP_OPT_HDR ) ) {
+        auto opt = reinterpret_cast<LCP_OPT_HDR*>( lcp->data + offset );
+        if( opt->len < sizeof( LCP_OPT_HDR ) || opt->len > len - offset ) {
+            break;
+        }
+        offset += opt->len;
+        switch( opt->opt ) {
+        case LCP_OPTIONS::MRU:
+            if( rej ) {
+                send_mru = false;
+            } else if( opt->len == sizeof( LCP_OPT_2B ) ) {
+                req_mru = ntohs( reinterpret_cast<LCP_OPT_2B*>( opt )->val );
+            }
+            break;
+        case LCP_OPTIONS::MAGIC_NUMBER:
+            if( rej ) {
+                send_magic = false;
+            }
+            // Nak means a loop or a collision, the next request takes a new number
+            session.our_magic_number = 0U;
+            break;
+        case LCP_OPTIONS::AUTH_PROTO:
+            return "Peer does not accept our authentication protocol";
+        default:
+            break;
+        }
+    }
+    return {};
 }
 
-FSM_RET LCP_FSM::send_term_ack( std::vector<uint8_t> &inPkt ) {
+PPP_FSM_EVENT LCP_FSM::classify_code( std::vector<uint8_t> &inPkt ) {
     PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
-    PPP_LCP_ECHO *lcp_echo = reinterpret_cast<PPP_LCP_ECHO*>( pppoe->data );
+    PPP_LCP *lcp = reinterpret_cast<PPP_LCP*>( pppoe->data );
 
-    lcp_echo->code = LCP_CODE::TERM_ACK;
-    if( lcp_echo->magic_number != bswap( session.peer_magic_number ) ) {
-        return { PPP_FSM_ACTION::NONE, "Magic number is wrong!" };
+    switch( lcp->code ) {
+    case LCP_CODE::PROTO_REJ: {
+        // Nothing else is left without LCP, the other protocols are just not used
+        uint16_t proto = 0;
+        if( bswap( lcp->length ) >= sizeof( PPP_LCP ) + sizeof( proto ) ) {
+            proto = ( lcp->data[ 0 ] << 8 ) | lcp->data[ 1 ];
+        }
+        return proto == static_cast<uint16_t>( PPP_PROTO::LCP ) ? PPP_FSM_EVENT::RXJ_Minus : PPP_FSM_EVENT::RXJ_Plus;
+    }
+    case LCP_CODE::ECHO_REQ:
+    case LCP_CODE::ECHO_REPLY:
+    case LCP_CODE::DISCARD_REQ:
+        return PPP_FSM_EVENT::RXR;
+    default:
+        return PPP_FSM_EVENT::RUC;
     }
-    lcp_echo->magic_number = bswap( session.our_magic_number );
-
-    auto header = session.encap.generate_header( runtime->hwaddr, ETH_PPPOE_SESSION );
-    inPkt.insert( inPkt.begin(), header.begin(), header.end() );
-
-    runtime->logger->logDebug() << LOGS::LCP << "Sending LCP TERM ACK" << std::endl;
-    runtime->ppp_outcoming.push( inPkt );
-
-    return { PPP_FSM_ACTION::NONE, "" };
 }
 
-FSM_RET LCP_FSM::send_echo_rep( std::vector<uint8_t> &inPkt ) {
+FSM_RET LCP_FSM::recv_echo( std::vector<uint8_t> &inPkt ) {
     PPPOESESSION_HDR *pppoe = reinterpret_cast<PPPOESESSION_HDR*>( inPkt.data() );
     PPP_LCP_ECHO *lcp_echo = reinterpret_cast<PPP_LCP_ECHO*>( pppoe->data );
 
+    if( lcp_echo->code == LCP_CODE::ECHO_REPLY ) {
+        echo_counter = 0;
+        return { PPP_FSM_ACTION::NONE, "" };
+    }
+    if( lcp_echo->code != LCP_CODE::ECHO_REQ ) {
+        return { PPP_FSM_ACTION::NONE, "" };
+    }
+
     lcp_echo->code = LCP_CODE::ECHO_REPLY;
     if( lcp_echo->magic_number != htonl( session.peer_magic_number ) ) {
         return { PPP_FSM_ACTION::NONE, "Magic number is wrong!" };
@@ -291,8 +244,3 @@ FSM_RET LCP_FSM::send_echo_req() {
 
     return { PPP_FSM_ACTION::NONE, "" };
 }
-
-FSM_RET LCP_FSM::recv_echo_rep( std::vector<uint8_t> &inPkt ) {
-    echo_counter = 0;
-    return { PPP_FSM_ACTION::NONE, "" };
-}
\ No newline at end of file
@@ -2,29 +2,33 @@
 #define PPP_LCP_H_
 
 #include "ppp_fsm.hpp"
+#include "packet.hpp"
+#include "log.hpp"
 
 struct PPPOESession;
 
-struct LCP_FSM: public PPP_FSM {
+struct LCP_FSM: public PPP_FSM<LCP_FSM> {
+	static constexpr PPP_PROTO proto { PPP_PROTO::LCP };
+	static constexpr LOGS log { LOGS::LCP };
+
 	PPPOESession &session;
 	uint8_t echo_counter { 0 };
+	// Our Configure-Request after the peer's Nak and Reject, 0 is the configured MRU
+	uint16_t req_mru { 0 };
+	bool send_mru { true };
+	bool send_magic { true };
 
     LCP_FSM( PPPOESession &s );
 
-	FSM_RET send_conf_req() override;
-	FSM_RET send_conf_ack( std::vector<uint8_t> &inPkt ) override;
-	FSM_RET send_conf_nak( std::vector<uint8_t> &inPkt ) override;
-    FSM_RET check_conf( std::vector<uint8_t> &inPkt ) override;
-	FSM_RET send_conf_rej( std::vector<uint8_t> &rejected_options, uint8_t pkt_id ) override;
-	FSM_RET send_code_rej() override;
-	FSM_RET send_term_req() override;
-	FSM_RET send_term_ack( std::vector<uint8_t> &inPkt ) override;
-	FSM_RET send_echo_rep( std::vector<uint8_t> &inPkt );
-	FSM_RET recv_echo_rep( std::vector<uint8_t> &inPkt ) override;
+	FSM_RET send_conf_req();
+    std::tuple<PPP_CONF_CHECK,std::string> check_conf( std::vector<uint8_t> &inPkt );
+	std::string recv_conf_nak_rej( std::vector<uint8_t> &inPkt );
+	PPP_FSM_EVENT classify_code( std::vector<uint8_t> &inPkt );
+	FSM_RET recv_echo( std::vector<uint8_t> &inPkt );
 	FSM_RET send_echo_req();
-	
+
 	// Getter for debugging
 	uint8_t get_echo_counter() const { return echo_counter; }
 };
 
-#endif
\ No newline at end of file
+#endif
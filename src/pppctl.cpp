@@ -61,6 +61,41 @@ std::string get_interfaces( const std::map<std::string,std::string> &args ) {
     return serialize( out_msg );
 }
 
+std::string get_vpp_status( const std::map<std::string,std::string> &args ) {
+    CLI_MSG out_msg;
+    out_msg.type = CLI_CMD_TYPE::REQUEST;
+    out_msg.cmd = CLI_CMD::GET_VPP_STATUS;
+    return serialize( out_msg );
+}
+
+std::string get_vpp_api_stats( const std::map<std::string,std::string> &args ) {
+    CLI_MSG out_msg;
+    out_msg.type = CLI_CMD_TYPE::REQUEST;
+    out_msg.cmd = CLI_CMD::GET_VPP_API_STATS;
+    return serialize( out_msg );
+}
+
+std::string get_radius_servers( const std::map<std::string,std::string> &args ) {
+    CLI_MSG out_msg;
+    out_msg.type = CLI_CMD_TYPE::REQUEST;
+    out_msg.cmd = CLI_CMD::GET_RADIUS_SERVERS;
+    return serialize( out_msg );
+}
+
+std::string get_admission( const std::map<std::string,std::string> &args ) {
+    CLI_MSG out_msg;
+    out_msg.type = CLI_CMD_TYPE::REQUEST;
+    out_msg.cmd = CLI_CMD::GET_ADMISSION;
+    return serialize( out_msg );
+}
+
+std::string get_coa( const std::map<std::string,std::string> &args ) {
+    CLI_MSG out_msg;
+    out_msg.type = CLI_CMD_TYPE::REQUEST;
+    out_msg.cmd = CLI_CMD::GET_COA;
+    return serialize( out_msg );
+}
+
 std::string get_pppoe_sessions( const std::map<std::string,std::string> &args ) {
     CLI_MSG out_msg;
     out_msg.type = CLI_CMD_TYPE::REQUEST;
@@ -85,6 +120,11 @@ CLICMD::CLICMD():
 {
     add_cmd( "show version", get_version );
     add_cmd( "show interfaces", get_interfaces );
+    add_cmd( "show vpp status", get_vpp_status );
+    add_cmd( "show vpp api", get_vpp_api_stats );
+    add_cmd( "show radius servers", get_radius_servers );
+    add_cmd( "show admission", get_admission );
+    add_cmd( "show coa", get_coa );
     add_cmd( "show pppoe sessions", get_pppoe_sessions );
     add_cmd( "show aaa sessions", get_aaa_sessions );
     add_cmd( "exit", exit_cb );
@@ -299,6 +339,31 @@ void CLIClient::print_resp( const std::string &msg ) {
         std::cout << resp << std::endl;
         break;
     }
+    case CLI_CMD::GET_VPP_STATUS: {
+        auto resp = deserialize<GET_VPP_STATUS_RESP>( result.data );
+        std::cout << resp << std::endl;
+        break;
+    }
+    case CLI_CMD::GET_VPP_API_STATS: {
+        auto resp = deserialize<GET_VPP_API_STATS_RESP>( result.data );
+        std::cout << resp << std::endl;
+        break;
+    }
+    case CLI_CMD::GET_RADIUS_SERVERS: {
+        auto resp = deserialize<GET_RADIUS_SERVERS_RESP>( result.data );
+        std::cout << resp << std::endl;
+        break;
+    }
+    case CLI_CMD::GET_ADMISSION: {
+        auto resp = deserialize<GET_ADMISSION_RESP>( result.data );
+        std::cout << resp << std::endl;
+        break;
+    }
+    case CLI_CMD::GET_COA: {
+        auto resp = deserialize<GET_COA_RESP>( result.data );
+        std::cout << resp << std::endl;
+        break;
+    }
     }
 }
 
@@ -6,6 +6,7 @@
 #include "encap.hpp"
 #include "utils.hpp"
 #include "runtime.hpp"
+#include "admission.hpp"
 
 extern std::shared_ptr<PPPOERuntime> runtime;
 
@@ -195,11 +196,19 @@ std::string pppoe::processPPPOE( std::vector<uint8_t> &inPkt, const encapsulatio
     // Starting to prepare the answer
     switch( disc->code ) {
     case PPPOE_CODE::PADI:
+        if( !runtime->admission->admitPADI() ) {
+            runtime->logger->logDebug() << LOGS::PPPOED << "Too many authentications in flight, PADI is not answered" << std::endl;
+            return {};
+        }
         if( auto const &err = process_padi( inPkt, outPkt, encap ); !err.empty() ) {
             return err;
         }
         break;
     case PPPOE_CODE::PADR:
+        if( !runtime->admission->admitPADR() ) {
+            runtime->logger->logDebug() << LOGS::PPPOED << "Too many authentications in flight, PADR is not answered" << std::endl;
+            return {};
+        }
         if( auto const &err = process_padr( inPkt, outPkt, encap ); !err.empty() ) {
             return err;
         }
@@ -214,11 +223,31 @@ std::string pppoe::processPPPOE( std::vector<uint8_t> &inPkt, const encapsulatio
     }
 
     disc = reinterpret_cast<PPPOEDISC_HDR*>( outPkt.data() );
+    auto code = disc->code;
 
     auto header = encap.generate_header( runtime->hwaddr, ETH_PPPOE_DISCOVERY );
     outPkt.insert( outPkt.begin(), header.begin(), header.end() );
 
+    if( code == PPPOE_CODE::PADO && runtime->admission->hold( outPkt ) ) {
+        return {};
+    }
     runtime->pppoe_outcoming.push( std::move( outPkt ) );
 
     return {};
 }
+
+void pppoe::sendPADT( const encapsulation_t &encap, uint16_t session_id ) {
+    std::vector<uint8_t> outPkt;
+    outPkt.resize( sizeof( PPPOEDISC_HDR ) );
+
+    PPPOEDISC_HDR *padt = reinterpret_cast<PPPOEDISC_HDR*>( outPkt.data() );
+    padt->type = 1;
+    padt->version = 1;
+    padt->code = PPPOE_CODE::PADT;
+    padt->session_id = bswap( session_id );
+    padt->length = 0;
+
+    auto header = encap.generate_header( runtime->hwaddr, ETH_PPPOE_DISCOVERY );
+    outPkt.insert( outPkt.begin(), header.begin(), header.end() );
+    runtime->pppoe_outcoming.push( std::move( outPkt ) );
+}
@@ -9,6 +9,8 @@ namespace pppoe {
     uint8_t insertTag( std::vector<uint8_t> &pkt, PPPOE_TAG tag, const std::string &val );
     std::tuple<std::map<PPPOE_TAG,std::string>,std::string> parseTags( std::vector<uint8_t> &pkt );
     std::string processPPPOE( std::vector<uint8_t> &inPkt, const encapsulation_t &encap );
+    // Tells the client the session is gone, RFC 2516 5.5
+    void sendPADT( const encapsulation_t &encap, uint16_t session_id );
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "provision_queue.hpp"
+#include "config.hpp"
+#include "log.hpp"
+#include "dp_backend.hpp"
+
+ProvisionQueue::ProvisionQueue( boost::asio::io_context &i, DPBackend &v, std::unique_ptr<Logger> &l, const VPPConf &conf ):
+    io( i ),
+    vpp( v ),
+    logger( l ),
+    window_timer( io ),
+    batch_size( std::max<size_t>( conf.provision_batch, 1 ) ),
+    window( conf.provision_window_us )
+{}
+
+ProvisionQueue::~ProvisionQueue() {
+    window_timer.cancel();
+    // Don't leave sessions in VPP behind us
+    flush();
+}
+
+void ProvisionQueue::add( ProvisionRequest req, provision_cb callback ) {
+    jobs.push_back( Job{ true, false, std::move( req ), std::move( callback ) } );
+    schedule();
+}
+
+void ProvisionQueue::del( ProvisionRequest req ) {
+    // Session went down before its add left the queue: drop both
+    for( auto it = jobs.rbegin(); it != jobs.rend(); it++ ) {
+        if( it->req.session_id != req.session_id || it->req.mac != req.mac ) {
+            continue;
+        }
+        if( it->is_add && !it->cancelled ) {
+            it->cancelled = true;
+            counters.coalesced++;
+            return;
+        }
+        break;
+    }
+    // Its add is in flight: VPP would get the delete before the rest of the add chain
+    if( auto const &it = flights.find( { req.session_id, req.mac } ); it != flights.end() ) {
+        auto &flight = *it->second;
+        for( auto w = flight.waiting.rbegin(); w != flight.waiting.rend(); w++ ) {
+            if( w->is_add && !w->cancelled ) {
+                w->cancelled = true;
+                counters.coalesced++;
+                return;
+            }
+        }
+        if( !flight.del ) {
+            flight.del = std::move( req );
+        }
+        return;
+    }
+    jobs.push_back( Job{ false, false, std::move( req ), nullptr } );
+    schedule();
+}
+
+void ProvisionQueue::schedule() {
+    if( jobs.size() >= batch_size || window.count() == 0 ) {
+        flush();
+        return;
+    }
+    if( window_armed ) {
+        return;
+    }
+    window_armed = true;
+    window_timer.expires_after( window );
+    window_timer.async_wait( std::bind( &ProvisionQueue::on_window, this, std::placeholders::_1 ) );
+}
+
+void ProvisionQueue::on_window( const boost::system::error_code &ec ) {
+    if( ec == boost::asio::error::operation_aborted ) {
+        // flush() already took care of the batch and the flag
+        return;
+    }
+    window_armed = false;
+    flush();
+}
+
+void ProvisionQueue::flush() {
+    if( window_armed ) {
+        window_timer.cancel();
+        window_armed = false;
+    }
+    if( jobs.empty() ) {
+        return;
+    }
+    auto batch = std::move( jobs );
+    jobs.clear();
+    counters.batches++;
+
+    logger->logDebug() << LOGS::VPP << "Provisioning batch of " << batch.size() << " session requests" << std::endl;
+
+    for( auto &job: batch ) {
+        if( job.cancelled ) {
+            if( job.callback ) {
+                boost::asio::post( io, std::bind( job.callback, "Session was terminated before provisioning", DPBindings{} ) );
+            }
+            continue;
+        }
+        if( !job.is_add ) {
+            send_del( job );
+            continue;
+        }
+        if( auto const &it = flights.find( { job.req.session_id, job.req.mac } ); it != flights.end() ) {
+            it->second->waiting.push_back( std::move( job ) );
+            continue;
+        }
+        send_add( job );
+    }
+}
+
+void ProvisionQueue::send_add( Job &job ) {
+    flight_key key { job.req.session_id, job.req.mac };
+    auto flight = std::make_shared<Flight>();
+    flights[ key ] = flight;
+
+    // Completion handlers of vpp are already posted to io, so we can call back directly
+    auto add_session = [ this, key, flight, req = job.req, callback = job.callback ]( std::optional<uint32_t> unnumbered_ifi ) {
+        counters.adds++;
+
+        auto set_unnumbered = [ this, key, flight, unnumbered_ifi, callback ]( uint32_t ifi ) {
+            if( !unnumbered_ifi || flight->del ) {
+                land( key, flight, callback, {}, DPBindings{ ifi, std::nullopt } );
+                return;
+            }
+            vpp.set_unnumbered_async( ifi, *unnumbered_ifi, true, [ this, key, flight, callback, ifi, unnumbered_ifi ]( bool success ) {
+                if( !success ) {
+                    counters.failed++;
+                    land( key, flight, callback, "Cannot set unnumbered to new session", DPBindings{ ifi, std::nullopt } );
+                    return;
+                }
+                land( key, flight, callback, {}, DPBindings{ ifi, unnumbered_ifi } );
+            });
+        };
+
+        vpp.add_pppoe_session_async( req.address, req.session_id, req.mac, req.vrf, true,
+            [ this, key, flight, vrf = req.vrf, set_unnumbered, callback ]( bool success, uint32_t ifi ) {
+                if( !success ) {
+                    counters.failed++;
+                    land( key, flight, callback, "Cannot add new session to vpp ", DPBindings{} );
+                    return;
+                }
+                if( vrf.empty() || flight->del ) {
+                    set_unnumbered( ifi );
+                    return;
+                }
+                vpp.set_interface_table_async( ifi, vrf, [ this, key, flight, set_unnumbered, callback, ifi ]( bool success ) {
+                    if( !success ) {
+                        counters.failed++;
+                        land( key, flight, callback, "Cannot move new session to vrf", DPBindings{ ifi, std::nullopt } );
+                        return;
+                    }
+                    set_unnumbered( ifi );
+                });
+            }
+        );
+    };
+
+    if( job.req.unnumbered.empty() ) {
+        add_session( std::nullopt );
+        return;
+    }
+    // An unknown name makes the backend dump interfaces, which must not block the loop
+    vpp.get_iface_by_name_async( job.req.unnumbered.str(), [ this, key, flight, add_session, callback = job.callback ]( bool success, uint32_t unnumbered_ifi ) {
+        if( flight->del ) {
+            land( key, flight, callback, {}, DPBindings{} );
+            return;
+        }
+        if( !success ) {
+            counters.failed++;
+            land( key, flight, callback, "Cannot set unnumbered to new session: can't find interface with such name", DPBindings{} );
+            return;
+        }
+        add_session( unnumbered_ifi );
+    });
+}
+
+void ProvisionQueue::land( const flight_key &key, const std::shared_ptr<Flight> &flight, const provision_cb &callback, const std::string &err, const DPBindings &bindings ) {
+    if( auto const &it = flights.find( key ); it != flights.end() && it->second == flight ) {
+        flights.erase( it );
+    }
+    // Adds waiting for this one go out after its delete
+    if( !flight->waiting.empty() ) {
+        for( auto &job: flight->waiting ) {
+            jobs.push_back( std::move( job ) );
+        }
+        flight->waiting.clear();
+        boost::asio::post( io, std::bind( &ProvisionQueue::schedule, this ) );
+    }
+    if( !flight->del ) {
+        callback( err, bindings );
+        return;
+    }
+    // The session didn't know what the chain would create, delete exactly what it did
+    if( bindings.ifindex != UINT32_MAX ) {
+        Job job { false, false, std::move( *flight->del ), nullptr };
+        job.req.bindings = bindings;
+        send_del( job );
+    }
+    callback( "Session was terminated during provisioning", bindings );
+}
+
+void ProvisionQueue::send_del( Job &job ) {
+    counters.dels++;
+
+    // VRF binding goes away together with the session interface, unnumbered has to be removed explicitly
+    auto const &req = job.req;
+    if( auto const &b = req.bindings; b.unnumbered_ifindex && b.ifindex != UINT32_MAX ) {
+        vpp.set_unnumbered_async( b.ifindex, *b.unnumbered_ifindex, false, [ this, sid = req.session_id ]( bool success ) {
+            if( !success ) {
+                counters.failed++;
+                logger->logError() << LOGS::VPP << "Cannot delete unnumbered for session " << sid << std::endl;
+            }
+        });
+    }
+    vpp.add_pppoe_session_async( req.address, req.session_id, req.mac, req.vrf, false, [ this, sid = req.session_id ]( bool success, uint32_t ) {
+        if( !success ) {
+            counters.failed++;
+            logger->logError() << LOGS::VPP << "Cannot delete session " << sid << " from vpp" << std::endl;
+        }
+    });
+}
+
+size_t ProvisionQueue::pending() const {
+    return jobs.size();
+}
+
+const ProvisionStats& ProvisionQueue::stats() const {
+    return counters;
+}
@@ -0,0 +1,97 @@
+#ifndef PROVISION_QUEUE_HPP
+#define PROVISION_QUEUE_HPP
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <string>
+#include <array>
+#include <optional>
+#include <chrono>
+#include <map>
+#include <boost/asio.hpp>
+
+#include "interner.hpp"
+
+class DPBackend;
+class Logger;
+struct VPPConf;
+
+// What we have set up in VPP for one session, so teardown needs no dumps
+struct DPBindings {
+    uint32_t ifindex { UINT32_MAX };
+    std::optional<uint32_t> unnumbered_ifindex;
+};
+
+// Everything needed to set up (or tear down) one PPPoE session in VPP
+struct ProvisionRequest {
+    uint32_t address;
+    uint16_t session_id;
+    std::array<uint8_t,6> mac;
+    InternedString vrf;
+    InternedString unnumbered;
+    DPBindings bindings;
+};
+
+// Called with empty string on success, bindings are filled as far as provisioning got
+using provision_cb = std::function<void(const std::string&,const DPBindings&)>;
+
+struct ProvisionStats {
+    uint64_t batches { 0 };
+    uint64_t adds { 0 };
+    uint64_t dels { 0 };
+    uint64_t coalesced { 0 };
+    uint64_t failed { 0 };
+};
+
+// Collects session adds/dels and sends them to VPP as one pipelined burst,
+// either when batch_size requests are pending or when batch window expires
+class ProvisionQueue {
+public:
+    ProvisionQueue( boost::asio::io_context &i, DPBackend &v, std::unique_ptr<Logger> &l, const VPPConf &conf );
+    ~ProvisionQueue();
+
+    void add( ProvisionRequest req, provision_cb callback );
+    void del( ProvisionRequest req );
+    void flush();
+
+    size_t pending() const;
+    const ProvisionStats& stats() const;
+
+private:
+    struct Job {
+        bool is_add;
+        bool cancelled { false };
+        ProvisionRequest req;
+        provision_cb callback;
+    };
+
+    // An add whose interface lookup or VPP calls are still running. A teardown arriving meanwhile is parked
+    // here, the chain stops before its next call and the delete is sent after it. A new
+    // add of the same session (CoA moving it) waits here too and is queued after the delete
+    struct Flight {
+        std::optional<ProvisionRequest> del;
+        std::vector<Job> waiting;
+    };
+    using flight_key = std::pair<uint16_t,std::array<uint8_t,6>>;
+
+    void schedule();
+    void on_window( const boost::system::error_code &ec );
+    void send_add( Job &job );
+    void send_del( Job &job );
+    void land( const flight_key &key, const std::shared_ptr<Flight> &flight, const provision_cb &callback, const std::string &err, const DPBindings &bindings );
+
+    boost::asio::io_context &io;
+    DPBackend &vpp;
+    std::unique_ptr<Logger> &logger;
+    boost::asio::steady_timer window_timer;
+    size_t batch_size;
+    std::chrono::microseconds window;
+    bool window_armed { false };
+
+    std::vector<Job> jobs;
+    std::map<flight_key,std::shared_ptr<Flight>> flights;
+    ProvisionStats counters;
+};
+
+#endif
@@ -1,185 +1,141 @@
 #include <tuple>
 #include <vector>
-#include <set>
 #include <map>
-
-#include <boost/asio/ip/address_v4.hpp>
-#include <boost/asio/ip/network_v4.hpp>
-
-using address_v4_t = boost::asio::ip::address_v4;
-using network_v4_t = boost::asio::ip::network_v4;
+#include <string>
+#include <algorithm>
 
 #include "radius_avp.hpp"
 #include "radius_dict.hpp"
 #include "net_integer.hpp"
-#include "log.hpp"
-#include "string_helpers.hpp"
-#include "runtime.hpp"
 
-extern std::shared_ptr<PPPOERuntime> runtime;
+bool AVPReader::next( AVPView &avp ) {
+    while( !error ) {
+        if( vsa_pos != nullptr && vsa_pos < vsa_end ) {
+            if( vsa_end - vsa_pos < 2 || vsa_pos[ 1 ] < 2 || vsa_pos[ 1 ] > vsa_end - vsa_pos ) {
+                error = true;
+                return false;
+            }
+            avp.type = vsa_pos[ 0 ];
+            avp.vendor = vsa_vendor;
+            avp.value = vsa_pos + 2;
+            avp.length = vsa_pos[ 1 ] - 2;
+            vsa_pos += vsa_pos[ 1 ];
+            return true;
+        }
+        vsa_pos = nullptr;
 
-AVP::AVP( const RadiusDict &dict, const std::string &attr, BE32 v ) {
-    auto [ id, vendorid ] = dict.getIdByName( attr );
-    type = id;
-    vendor = vendorid;
-    value.resize( sizeof( BE32 ) );
-    *reinterpret_cast<uint32_t*>( value.data() ) = v.raw();
-    length = sizeof( type ) + sizeof( length ) + value.size();
+        if( pos == end ) {
+            return false;
+        }
+        if( end - pos < 2 || pos[ 1 ] < 2 || pos[ 1 ] > end - pos ) {
+            error = true;
+            return false;
+        }
+        auto attr = pos;
+        pos += attr[ 1 ];
+        if( attr[ 0 ] != RADIUS_VSA ) {
+            avp.type = attr[ 0 ];
+            avp.vendor = 0;
+            avp.value = attr + 2;
+            avp.length = attr[ 1 ] - 2;
+            return true;
+        }
+        // Vendor-Specific: type, length, vendor id, then vendor's own type-length-value
+        if( attr[ 1 ] < 8 ) {
+            error = true;
+            return false;
+        }
+        vsa_vendor = ( uint32_t{ attr[ 2 ] } << 24 ) | ( uint32_t{ attr[ 3 ] } << 16 ) | ( uint32_t{ attr[ 4 ] } << 8 ) | attr[ 5 ];
+        vsa_pos = attr + 6;
+        vsa_end = pos;
+    }
+    return false;
 }
 
-AVP::AVP( const RadiusDict &dict, const std::string &attr, BE16 v ) {
-    auto [ id, vendorid ] = dict.getIdByName( attr );
-    type = id;
-    vendor = vendorid;
-    value.resize( sizeof( BE16 ) );
-    *reinterpret_cast<uint16_t*>( value.data() ) = v.raw();
-    length = sizeof( type) + sizeof( length ) + value.size();
+bool AVPReader::malformed() const {
+    return error;
 }
 
-AVP::AVP( const RadiusDict &dict, const std::string &attr, const std::string &s ) {
-    auto [ id, vendorid ] = dict.getIdByName( attr );
-    type = id;
-    vendor = vendorid;
-    if( uint32_t i = dict.getValueByName( attr, s ); i != 0 ) {
-        value.resize( sizeof( BE32 ) );
-        *reinterpret_cast<uint32_t*>( value.data() ) = BE32( i ).raw();    
-    } else {
-        value = { s.begin(), s.end() };
-    }
-    length = sizeof( type) + sizeof( length ) + value.size();
+bool AVPReader::valid() const {
+    AVPReader copy { *this };
+    AVPView avp;
+    while( copy.next( avp ) ) {}
+    return !copy.malformed();
 }
 
-AVP::AVP( const std::vector<uint8_t> &v, std::vector<uint8_t>::iterator it ) {
-    if( ( v.end() - it ) < 2 ) {
-        throw std::runtime_error( "No room for parsing VSA" );
+uint8_t* AVPWriter::reserve( const RadiusAttrDesc &attr, size_t len ) {
+    if( !attr.found || overflow ) {
+        return nullptr;
+    }
+    // Vendor attributes are wrapped into Vendor-Specific: type 26, length, vendor id
+    size_t head = attr.vendor == 0 ? 2 : 8;
+    if( head + len > UINT8_MAX || pos + head + len > capacity ) {
+        overflow = true;
+        return nullptr;
+    }
+    auto p = buf + pos;
+    if( attr.vendor != 0 ) {
+        *p++ = RADIUS_VSA;
+        *p++ = head + len;
+        *p++ = attr.vendor >> 24;
+        *p++ = attr.vendor >> 16;
+        *p++ = attr.vendor >> 8;
+        *p++ = attr.vendor;
     }
+    *p++ = attr.id;
+    *p++ = 2 + len;
+    pos += head + len;
+    return p;
+}
 
-    type = *it;
-    it++;
-    original_len = *it;
-    if( type == RADIUS_VSA ) {
-        it++; //pass the length
-        vendor = bswap( *( reinterpret_cast<uint32_t*>( &( *it ) ) ) );
-        it += 4;
-        type = *it;
-        it++;
+void AVPWriter::string( const RadiusAttrDesc &attr, std::string_view v ) {
+    if( auto p = reserve( attr, v.size() ); p != nullptr ) {
+        std::copy( v.begin(), v.end(), p );
     }
-    length = *it;
-    it++;
-    value = { it, it + length - 2 };
 }
 
-size_t AVP::getSize() const {
-    return original_len;
+void AVPWriter::integer( const RadiusAttrDesc &attr, uint32_t v ) {
+    if( auto p = reserve( attr, sizeof( v ) ); p != nullptr ) {
+        *reinterpret_cast<uint32_t*>( p ) = BE32( v ).raw();
+    }
 }
 
-bool AVP::operator<( const AVP &r ) const {
-    return type < r.type;
+void AVPWriter::ipaddr( const RadiusAttrDesc &attr, uint32_t v ) {
+    integer( attr, v );
 }
 
-std::vector<uint8_t> AVP::serialize() const {
-    std::vector<uint8_t> ret;
-    ret.reserve( sizeof( type ) + sizeof( length ) + length + 10 );
-    if( vendor == 0 ) {
-        ret.push_back( type );
+void AVPWriter::value( const RadiusAttrDesc &attr, const std::string &text ) {
+    if( auto v = attr.value( text ); v != 0 ) {
+        integer( attr, v );
     } else {
-        ret.push_back( sizeof( type) + sizeof( length ) + sizeof( vendor ) + sizeof( type ) + sizeof( length ) + value.size() );
-        std::array<uint8_t,4> vend_buf;
-        *reinterpret_cast<uint32_t*>( &vend_buf ) = vendor;
-        ret.insert( ret.end(), vend_buf.begin(), vend_buf.end() );
-        ret.push_back( type );
+        string( attr, text );
     }
-    ret.push_back( length );
-    ret.insert( ret.end(), value.begin(), value.end() );
-    return ret;
 }
 
-template<>
-std::tuple<std::string, bool> AVP::getVal<std::string>() const {
-    return { { value.begin(), value.end() }, true };
+void AVPWriter::password( const RadiusAttrDesc &attr, std::string_view v ) {
+    auto nlen = std::max<size_t>( 16, ( v.size() + 15 ) / 16 * 16 );
+    auto p = reserve( attr, nlen );
+    if( p == nullptr ) {
+        return;
+    }
+    std::copy( v.begin(), v.end(), p );
+    std::fill( p + v.size(), p + nlen, 0 );
+    pw_offset = p - buf;
+    pw_length = nlen;
 }
 
-template<>
-std::tuple<BE32, bool> AVP::getVal<BE32>() const {
-    if( value.size() != 4 ) {
-        return { BE32( 0 ), false };
-    } 
-    auto raw = Raw{ *reinterpret_cast<const uint32_t*>( value.data() ) };
-    return { BE32( raw ), true };
+size_t AVPWriter::size() const {
+    return pos;
 }
 
-template<>
-std::tuple<BE16, bool> AVP::getVal<BE16>() const {
-    if( value.size() != 4 ) {
-        return { BE16( 0 ), false };
-    } 
-    auto raw = Raw{ *reinterpret_cast<const uint16_t*>( value.data() ) };
-    return { BE16( raw ), true };
+bool AVPWriter::ok() const {
+    return !overflow;
 }
 
-
-std::vector<AVP> parseAVP( std::vector<uint8_t> &v ) {
-    std::vector<AVP> ret;
-    try {
-        auto it = v.begin();
-        while( it != v.end() ) {
-            ret.emplace_back( v, it );
-            it += ret.back().getSize();
-        }
-    } catch( std::exception &e ) {
-        runtime->logger->logError() << LOGS::RADIUS << e.what() << std::endl;
-    }
-
-    return ret;
+size_t AVPWriter::password_offset() const {
+    return pw_offset;
 }
 
-std::string printAVP( const RadiusDict &dict, const AVP &avp ) {
-    std::string out;
-
-    auto const &at = dict.getAttrById( avp.type );
-    if( at.first.empty() || at.second == RADIUS_TYPE_T::ERROR ) {
-        return "UKNOWN ATTRIBUTE";
-    }
-
-    out += "ATTR: " + at.first + "\t\t";
-    auto &type = at.second;
-    out += "VALUE: ";
-    switch( type ) {
-    case RADIUS_TYPE_T::INTEGER:
-        if( auto const &[ ret, success ] = avp.getVal<BE32>(); success ) {
-            out += std::to_string( ret.native() );
-        } else {
-            out += "ERROR";
-        }
-        break;
-    case RADIUS_TYPE_T::STRING:
-        if( auto const &[ ret, success ] = avp.getVal<std::string>(); success ) {
-            out += ret;
-        } else {
-            out += "ERROR";
-        }
-        break;
-    case RADIUS_TYPE_T::IPADDR:
-        if( auto const &[ ret, success ] = avp.getVal<BE32>(); success ) {
-            out += address_v4_t{ ret.native() }.to_string();
-        } else {
-            out += "ERROR";
-        }
-        break;
-    default:
-        out += "UNKNOWN";
-        break;
-    }
-
-    return out;
+size_t AVPWriter::password_length() const {
+    return pw_length;
 }
-
-std::vector<uint8_t> serializeAVP( const std::set<AVP> &avp ) {
-    std::vector<uint8_t> ret;
-
-    for( auto const &a: avp ) {
-        auto temp = a.serialize();
-        ret.insert( ret.end(), temp.begin(), temp.end() );
-    }
-    return ret;
-}
\ No newline at end of file
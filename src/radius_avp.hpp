@@ -1,46 +1,96 @@
 #ifndef RADIUS_AVP_HPP
 #define RADIUS_AVP_HPP
 
+#include <string_view>
+#include <optional>
 #include "net_integer.hpp"
 
 #define RADIUS_VSA 26
 
 struct RadiusDict;
+struct RadiusAttrDesc;
 
-struct AVP {
-    uint8_t type;
-    uint8_t length;
-    std::vector<uint8_t> value;
-    uint32_t vendor;
-    uint8_t original_len;
+// One attribute of a received packet, value points into the receive buffer.
+// Sub-attributes of Vendor-Specific are reported with their vendor id
+struct AVPView {
+    uint8_t type { 0 };
+    uint32_t vendor { 0 };
+    const uint8_t *value { nullptr };
+    size_t length { 0 };
 
-    explicit AVP( const RadiusDict &dict, const std::string &attr, BE32 v );
-    explicit AVP( const RadiusDict &dict, const std::string &attr, BE16 v );
-    explicit AVP( const RadiusDict &dict, const std::string &attr, const std::string &s );
-    explicit AVP( const std::vector<uint8_t> &v, std::vector<uint8_t>::iterator it );
+    std::string_view string() const {
+        return { reinterpret_cast<const char*>( value ), length };
+    }
 
-    size_t getSize() const;
+    // Integer and ipaddr values in host byte order
+    std::optional<uint32_t> integer() const {
+        if( length != sizeof( uint32_t ) ) {
+            return std::nullopt;
+        }
+        return ( uint32_t{ value[ 0 ] } << 24 ) | ( uint32_t{ value[ 1 ] } << 16 ) | ( uint32_t{ value[ 2 ] } << 8 ) | value[ 3 ];
+    }
+};
 
-    template<typename T>
-    std::tuple<T, bool> getVal() const;
+// Walks the attribute area of a packet without copying it. Every length is checked
+// against the buffer, next() stops on the first malformed attribute and sets malformed()
+class AVPReader {
+public:
+    AVPReader( const uint8_t *b, size_t len ):
+        pos( b ),
+        end( b + len )
+    {}
 
-    bool operator<( const AVP &r ) const;
+    bool next( AVPView &avp );
+    bool malformed() const;
+    // Walks a copy of the reader, true if all attributes are well formed
+    bool valid() const;
 
-    std::vector<uint8_t> serialize() const;
+private:
+    const uint8_t *pos;
+    const uint8_t *end;
+    // Remaining sub-attributes of the current Vendor-Specific attribute
+    const uint8_t *vsa_pos { nullptr };
+    const uint8_t *vsa_end { nullptr };
+    uint32_t vsa_vendor { 0 };
+    bool error { false };
 };
 
-template<>
-std::tuple<std::string, bool> AVP::getVal<std::string>() const;
-
-template<>
-std::tuple<BE32, bool> AVP::getVal<BE32>() const;
+// Encodes attributes straight into a packet buffer, nothing is allocated.
+// Attributes missing in the dictionary are skipped; when an attribute does not fit
+// the writer stops and ok() turns false
+class AVPWriter {
+public:
+    AVPWriter( uint8_t *b, size_t cap ):
+        buf( b ),
+        capacity( cap )
+    {}
 
-template<>
-std::tuple<BE16, bool> AVP::getVal<BE16>() const;
+    // string and octets
+    void string( const RadiusAttrDesc &attr, std::string_view v );
+    void integer( const RadiusAttrDesc &attr, uint32_t v );
+    // Address in host byte order
+    void ipaddr( const RadiusAttrDesc &attr, uint32_t v );
+    // Named value of an integer attribute if the dictionary has it, the text itself otherwise
+    void value( const RadiusAttrDesc &attr, const std::string &text );
+    // Room for a value of len bytes computed by the caller, nullptr if the attribute is skipped
+    uint8_t* reserve( const RadiusAttrDesc &attr, size_t len );
+    // User-Password in clear, zero padded to 16 bytes. The sender hides it in place once the
+    // Request Authenticator is known, RFC 2865 5.2
+    void password( const RadiusAttrDesc &attr, std::string_view v );
 
-std::vector<AVP> parseAVP( std::vector<uint8_t> &v );
-std::string printAVP( const RadiusDict &dict, const AVP &avp );
+    size_t size() const;
+    bool ok() const;
+    // Where password() put the value, relative to the start of the buffer. Length 0 if nowhere
+    size_t password_offset() const;
+    size_t password_length() const;
 
-std::vector<uint8_t> serializeAVP( const std::set<AVP> &avp );
+private:
+    uint8_t *buf;
+    size_t capacity;
+    size_t pos { 0 };
+    bool overflow { false };
+    size_t pw_offset { 0 };
+    size_t pw_length { 0 };
+};
 
 #endif
\ No newline at end of file
@@ -1,10 +1,18 @@
 #include <tuple>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <fstream>
+#include <charconv>
+#include <optional>
+#include <cstring>
+#include <cstdio>
 
-#include <boost/algorithm/string.hpp>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "radius_dict.hpp"
 #include "runtime.hpp"
@@ -12,95 +20,428 @@
 extern std::shared_ptr<PPPOERuntime> runtime;
 
 RadiusDict::RadiusDict( const std::vector<std::string> &files ) {
+    // Attribute names of all the files seen so far, VALUE lines are resolved against it
+    std::unordered_map<std::string,radius_attribute_t*> names;
     for( auto const &f: files ) {
-        parseFreeradDict( f );
+        parseFreeradDict( f, names );
     }
+    buildIndex();
 }
 
-void RadiusDict::parseFreeradDict( const std::string &path ) {
-std::ifstream file { path };
+std::shared_ptr<const RadiusDict> RadiusDict::load( const std::vector<std::string> &files, const std::string &cache_path ) {
+    if( !cache_path.empty() ) {
+        std::shared_ptr<RadiusDict> cached { new RadiusDict };
+        if( cached->loadCache( cache_path, files ) ) {
+            cached->buildIndex();
+            return cached;
+        }
+    }
+    auto dict = std::make_shared<RadiusDict>( files );
+    if( !cache_path.empty() ) {
+        dict->saveCache( cache_path, files );
+    }
+    return dict;
+}
+
+void RadiusDict::buildIndex() {
+    // Standard attributes win over vendor ones with the same name, as in the old linear lookup
+    for( auto const &[ k, v ]: attrs ) {
+        by_name.emplace( v.name, std::make_tuple( k, 0 ) );
+        auto &values = values_by_name[ v.name ];
+        for( auto const &[ index, value ]: v.values ) {
+            values.emplace( value, index );
+        }
+    }
+    for( auto const &[ vendid, vendattr ]: vsa ) {
+        for( auto const &[ k, v ]: vendattr ) {
+            if( by_name.emplace( v.name, std::make_tuple( k, vendid ) ).second ) {
+                auto &values = values_by_name[ v.name ];
+                for( auto const &[ index, value ]: v.values ) {
+                    values.emplace( value, index );
+                }
+            }
+        }
+    }
+
+    static const std::array<const char*,static_cast<size_t>( RADIUS_ATTR::MAX )> names {
+        "User-Name",
+        "User-Password",
+        "CHAP-Password",
+        "CHAP-Challenge",
+        "NAS-Identifier",
+        "NAS-Port-Id",
+        "Service-Type",
+        "Framed-Protocol",
+        "Framed-IP-Address",
+        "Framed-Pool",
+        "Calling-Station-Id",
+        "Client-DNS-Pri",
+        "Client-DNS-Sec",
+        "Subscriber-Profile-Name",
+        "Acct-Status-Type",
+        "Acct-Session-Id",
+        "Acct-Input-Packets",
+        "Acct-Output-Packets",
+        "Acct-Input-Octets",
+        "Acct-Output-Octets",
+        "Acct-Delay-Time",
+        "Error-Cause"
+    };
+    for( size_t i = 0; i < names.size(); i++ ) {
+        auto &desc = compiled[ i ];
+        auto const &it = by_name.find( names[ i ] );
+        if( it == by_name.end() ) {
+            continue;
+        }
+        desc.found = true;
+        std::tie( desc.id, desc.vendor ) = it->second;
+        desc.type = getAttrById( desc.id, desc.vendor ).second;
+        if( auto const &vit = values_by_name.find( names[ i ] ); vit != values_by_name.end() ) {
+            desc.values = vit->second;
+        }
+    }
+}
+
+namespace {
+    // Splits a dictionary line on blanks, everything after '#' is a comment
+    size_t tokenize( std::string_view line, std::array<std::string_view,4> &out ) {
+        if( auto pos = line.find( '#' ); pos != std::string_view::npos ) {
+            line = line.substr( 0, pos );
+        }
+        size_t n = 0;
+        size_t i = 0;
+        while( n < out.size() ) {
+            while( i < line.size() && ( line[ i ] == ' ' || line[ i ] == '\t' || line[ i ] == '\r' ) ) {
+                i++;
+            }
+            if( i == line.size() ) {
+                break;
+            }
+            size_t start = i;
+            while( i < line.size() && line[ i ] != ' ' && line[ i ] != '\t' && line[ i ] != '\r' ) {
+                i++;
+            }
+            out[ n++ ] = line.substr( start, i - start );
+        }
+        return n;
+    }
+
+    template<typename T>
+    std::optional<T> parseNumber( std::string_view s ) {
+        int base = 10;
+        if( s.size() > 2 && s[ 0 ] == '0' && ( s[ 1 ] == 'x' || s[ 1 ] == 'X' ) ) {
+            s.remove_prefix( 2 );
+            base = 16;
+        }
+        T val;
+        if( auto [ ptr, ec ] = std::from_chars( s.data(), s.data() + s.size(), val, base ); ec != std::errc() || ptr != s.data() + s.size() ) {
+            return std::nullopt;
+        }
+        return val;
+    }
+
+    RADIUS_TYPE_T parseType( std::string_view s ) {
+        // Type may carry options like "integer encrypt=1"
+        s = s.substr( 0, s.find( ',' ) );
+        if( s == "string" ) { return RADIUS_TYPE_T::STRING; }
+        if( s == "octets" ) { return RADIUS_TYPE_T::OCTETS; }
+        if( s == "ipaddr" ) { return RADIUS_TYPE_T::IPADDR; }
+        if( s == "integer" ) { return RADIUS_TYPE_T::INTEGER; }
+        if( s == "vsa" ) { return RADIUS_TYPE_T::VSA; }
+        return RADIUS_TYPE_T::ERROR;
+    }
+}
+
+void RadiusDict::parseFreeradDict( const std::string &path, std::unordered_map<std::string,radius_attribute_t*> &names ) {
+    std::ifstream file { path, std::ios::binary };
     if( !file.is_open() ) {
         return;
     }
+    std::string content { std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() };
 
-    std::string line; 
     uint32_t current_vendor = 0;
+    std::array<std::string_view,4> out;
+    std::string_view rest { content };
 
-    while( getline( file, line ) ) {
-        if( line.front() == '#' ) {
-            continue;
-        }
-        if( line.find( "ATTRIBUTE" ) == std::string::npos &&
-            line.find( "VALUE" ) == std::string::npos &&
-            line.find( "VENDOR" ) == std::string::npos && 
-            line.find( "BEGIN-VENDOR" ) == std::string::npos &&
-            line.find( "END-VENDOR" ) == std::string::npos ) {
+    while( !rest.empty() ) {
+        auto eol = rest.find( '\n' );
+        auto line = rest.substr( 0, eol );
+        rest.remove_prefix( eol == std::string_view::npos ? rest.size() : eol + 1 );
+
+        auto n = tokenize( line, out );
+        if( n == 0 ) {
             continue;
         }
-        std::vector<std::string> out;
-        boost::split( out, line, boost::is_any_of(" \t") );
-        std::remove_if( out.begin(), out.end(), []( const std::string &r )->bool { return r.size() == 0; } );
-        
-        if( out[ 0 ].find( "ATTRIBUTE" ) == 0 ) {
-            if( out.size() < 4 ) {
+        if( out[ 0 ] == "ATTRIBUTE" ) {
+            if( n < 4 ) {
                 continue;
             }
-            uint8_t attr_id = std::stoi( out[ 2 ] );
-            RADIUS_TYPE_T type { RADIUS_TYPE_T::ERROR };
-            if( out[ 3 ].find( "string" ) == 0 ) { type = RADIUS_TYPE_T::STRING; }
-            if( out[ 3 ].find( "octets" ) == 0 ) { type = RADIUS_TYPE_T::OCTETS; }
-            if( out[ 3 ].find( "ipaddr" ) == 0 ) { type = RADIUS_TYPE_T::IPADDR; }
-            if( out[ 3 ].find( "integer" ) == 0 ) { type = RADIUS_TYPE_T::INTEGER; }
-            if( out[ 3 ].find( "vsa" ) == 0 ) { type = RADIUS_TYPE_T::VSA; }
-            if( current_vendor == 0 ) {
-                attrs.emplace( std::piecewise_construct, std::forward_as_tuple( attr_id ), std::forward_as_tuple( out[1], type ) );
-            } else {
-                vsa[ current_vendor ].emplace( std::piecewise_construct, std::forward_as_tuple( attr_id ), std::forward_as_tuple( out[1], type ) );
-            }
-        } else if( out[ 0 ].find( "VALUE" ) == 0 ) {
-            if( out.size() < 4 ) {
+            auto attr_id = parseNumber<uint32_t>( out[ 2 ] );
+            if( !attr_id || *attr_id > 255 ) {
                 continue;
             }
-            int32_t attr_val = std::stoi( out[ 3 ] );
-            attributes_t &attrs_to_find = current_vendor == 0 ? attrs : vsa[ current_vendor ];
-            for( auto &[ k, v ]: attrs_to_find ) {
-                if( out[ 1 ].find( v.name ) == 0 ) {
-                    v.values.emplace( attr_val, out[ 2 ] );
-                }
+            auto &table = current_vendor == 0 ? attrs : vsa[ current_vendor ];
+            auto [ it, ret ] = table.emplace( std::piecewise_construct, std::forward_as_tuple( *attr_id ), std::forward_as_tuple( std::string { out[ 1 ] }, parseType( out[ 3 ] ) ) );
+            if( ret ) {
+                names.emplace( it->second.name, &it->second );
+            }
+        } else if( out[ 0 ] == "VALUE" ) {
+            if( n < 4 ) {
+                continue;
+            }
+            auto attr_val = parseNumber<int32_t>( out[ 3 ] );
+            if( !attr_val ) {
+                continue;
+            }
+            if( auto const &it = names.find( std::string { out[ 1 ] } ); it != names.end() ) {
+                it->second->values.emplace( *attr_val, out[ 2 ] );
+            }
+        } else if( out[ 0 ] == "VENDOR" ) {
+            if( n < 3 ) {
+                continue;
             }
-        } else if( out[ 0 ].find( "VENDOR" ) == 0 ) {
-            if( out.size() < 3 ) {
+            auto vend_id = parseNumber<uint32_t>( out[ 2 ] );
+            if( !vend_id ) {
                 continue;
             }
-            uint32_t vend_id = std::stoi( out[ 2 ] );
-            if( auto const &[ it, ret ] = vendors.emplace( out[ 1 ], vend_id ); !ret ) {
+            if( auto const &[ it, ret ] = vendors.emplace( out[ 1 ], *vend_id ); !ret ) {
                 runtime->logger->logError() << LOGS::RADIUS << "Cannot emplace vendor " << out[ 1 ] << " with id " << out[ 2 ] << std::endl;
             }
-        } else if( out[ 0 ].find( "BEGIN-VENDOR" ) == 0 ) {
-            if( out.size() < 2 ) {
+        } else if( out[ 0 ] == "BEGIN-VENDOR" ) {
+            if( n < 2 ) {
                 continue;
             }
-            if( auto const &it = vendors.find( out[ 1 ] ); it != vendors.end() ) {
+            if( auto const &it = vendors.find( std::string { out[ 1 ] } ); it != vendors.end() ) {
                 current_vendor = it->second;
             }
-        } else if( out[ 0 ].find( "END-VENDOR" ) == 0 ) {
+        } else if( out[ 0 ] == "END-VENDOR" ) {
             current_vendor = 0;
         }
     }
 }
 
-std::tuple<uint8_t,uint32_t> RadiusDict::getIdByName( const std::string &attr ) const {
-    for( auto const &[ k, v ]: attrs ) {
-        if( v.name == attr ) {
-            return { k, 0 };
+// Compiled dictionary image: header, the source files it was built from, then vendors and
+// attribute tables. Host byte order, it is never meant to leave the machine
+namespace {
+    constexpr char CACHE_MAGIC[ 8 ] { 'P', 'P', 'P', 'D', 'I', 'C', 'T', '1' };
+
+    struct SourceStamp {
+        int64_t mtime_ns { -1 };
+        uint64_t size { 0 };
+
+        bool operator==( const SourceStamp &r ) const {
+            return mtime_ns == r.mtime_ns && size == r.size;
+        }
+    };
+
+    // Missing files get a stamp of their own so that creating one invalidates the image
+    SourceStamp stampFile( const std::string &path ) {
+        struct stat st;
+        if( stat( path.c_str(), &st ) != 0 ) {
+            return {};
         }
+        return { static_cast<int64_t>( st.st_mtim.tv_sec ) * 1'000'000'000 + st.st_mtim.tv_nsec, static_cast<uint64_t>( st.st_size ) };
     }
-    for( auto const &[ vendid, vendattr ]: vsa ) {
-        for( auto const &[ k, v ]: vendattr) {
-            if( v.name == attr ) {
-                return { k, vendid };
+
+    class CacheWriter {
+    public:
+        template<typename T>
+        void put( T v ) {
+            buf.append( reinterpret_cast<const char*>( &v ), sizeof( v ) );
+        }
+
+        void put( std::string_view s ) {
+            put<uint32_t>( s.size() );
+            buf.append( s );
+        }
+
+        std::string buf;
+    };
+
+    class CacheReader {
+    public:
+        CacheReader( const char *b, size_t len ):
+            pos( b ),
+            end( b + len )
+        {}
+
+        template<typename T>
+        bool get( T &v ) {
+            if( static_cast<size_t>( end - pos ) < sizeof( v ) ) {
+                return false;
             }
+            std::memcpy( &v, pos, sizeof( v ) );
+            pos += sizeof( v );
+            return true;
         }
+
+        bool get( std::string_view &s ) {
+            uint32_t len;
+            if( !get( len ) || static_cast<size_t>( end - pos ) < len ) {
+                return false;
+            }
+            s = { pos, len };
+            pos += len;
+            return true;
+        }
+
+        bool done() const {
+            return pos == end;
+        }
+
+    private:
+        const char *pos;
+        const char *end;
+    };
+
+    struct MappedFile {
+        const char *data { nullptr };
+        size_t size { 0 };
+
+        MappedFile( const std::string &path ) {
+            int fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+            if( fd < 0 ) {
+                return;
+            }
+            struct stat st;
+            if( fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+                if( void *m = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 ); m != MAP_FAILED ) {
+                    data = static_cast<const char*>( m );
+                    size = st.st_size;
+                }
+            }
+            close( fd );
+        }
+
+        ~MappedFile() {
+            if( data != nullptr ) {
+                munmap( const_cast<char*>( data ), size );
+            }
+        }
+    };
+}
+
+bool RadiusDict::loadCache( const std::string &cache_path, const std::vector<std::string> &files ) {
+    MappedFile image { cache_path };
+    if( image.data == nullptr ) {
+        return false;
+    }
+    CacheReader in { image.data, image.size };
+
+    char magic[ sizeof( CACHE_MAGIC ) ];
+    if( !in.get( magic ) || std::memcmp( magic, CACHE_MAGIC, sizeof( magic ) ) != 0 ) {
+        return false;
+    }
+    uint32_t nfiles;
+    if( !in.get( nfiles ) || nfiles != files.size() ) {
+        return false;
+    }
+    for( auto const &f: files ) {
+        std::string_view path;
+        SourceStamp stamp;
+        if( !in.get( path ) || !in.get( stamp.mtime_ns ) || !in.get( stamp.size ) ) {
+            return false;
+        }
+        if( path != f || !( stamp == stampFile( f ) ) ) {
+            return false;
+        }
+    }
+
+    uint32_t nvendors;
+    if( !in.get( nvendors ) ) {
+        return false;
+    }
+    for( uint32_t i = 0; i < nvendors; i++ ) {
+        std::string_view name;
+        uint32_t id;
+        if( !in.get( name ) || !in.get( id ) ) {
+            return false;
+        }
+        vendors.emplace( name, id );
+    }
+
+    uint32_t nattrs;
+    if( !in.get( nattrs ) ) {
+        return false;
+    }
+    for( uint32_t i = 0; i < nattrs; i++ ) {
+        uint32_t vendor;
+        uint8_t id;
+        RADIUS_TYPE_T type;
+        std::string_view name;
+        uint32_t nvalues;
+        if( !in.get( vendor ) || !in.get( id ) || !in.get( type ) || !in.get( name ) || !in.get( nvalues ) ) {
+            return false;
+        }
+        auto &table = vendor == 0 ? attrs : vsa[ vendor ];
+        auto &attr = table.emplace( std::piecewise_construct, std::forward_as_tuple( id ), std::forward_as_tuple( std::string { name }, type ) ).first->second;
+        for( uint32_t j = 0; j < nvalues; j++ ) {
+            int32_t val;
+            std::string_view text;
+            if( !in.get( val ) || !in.get( text ) ) {
+                return false;
+            }
+            attr.values.emplace( val, text );
+        }
+    }
+    return in.done();
+}
+
+void RadiusDict::saveCache( const std::string &cache_path, const std::vector<std::string> &files ) const {
+    CacheWriter out;
+    out.buf.append( CACHE_MAGIC, sizeof( CACHE_MAGIC ) );
+    out.put<uint32_t>( files.size() );
+    for( auto const &f: files ) {
+        auto stamp = stampFile( f );
+        out.put( std::string_view { f } );
+        out.put( stamp.mtime_ns );
+        out.put( stamp.size );
+    }
+    out.put<uint32_t>( vendors.size() );
+    for( auto const &[ name, id ]: vendors ) {
+        out.put( std::string_view { name } );
+        out.put( id );
+    }
+    auto put_attrs = [ &out ]( uint32_t vendor, const attributes_t &table ) {
+        for( auto const &[ id, attr ]: table ) {
+            out.put( vendor );
+            out.put( id );
+            out.put( attr.type );
+            out.put( std::string_view { attr.name } );
+            out.put<uint32_t>( attr.values.size() );
+            for( auto const &[ val, text ]: attr.values ) {
+                out.put( val );
+                out.put( std::string_view { text } );
+            }
+        }
+    };
+    size_t nattrs = attrs.size();
+    for( auto const &[ vendor, table ]: vsa ) {
+        nattrs += table.size();
+    }
+    out.put<uint32_t>( nattrs );
+    put_attrs( 0, attrs );
+    for( auto const &[ vendor, table ]: vsa ) {
+        put_attrs( vendor, table );
+    }
+
+    // Written aside and renamed so a concurrent start never maps a half written image.
+    // Failing to write the cache is not fatal, the next start just parses the sources again
+    auto tmp = cache_path + ".tmp";
+    {
+        std::ofstream file { tmp, std::ios::binary | std::ios::trunc };
+        if( !file.write( out.buf.data(), out.buf.size() ) ) {
+            return;
+        }
+    }
+    if( std::rename( tmp.c_str(), cache_path.c_str() ) != 0 ) {
+        std::remove( tmp.c_str() );
+    }
+}
+
+std::tuple<uint8_t,uint32_t> RadiusDict::getIdByName( const std::string &attr ) const {
+    if( auto const &it = by_name.find( attr ); it != by_name.end() ) {
+        return it->second;
     }
     return { 0, 0 };
 }
@@ -131,16 +472,12 @@ std::string radius_attribute_t::getValueString( uint8_t attr_id, int value ) con
 }
 
 int RadiusDict::getValueByName( const std::string &attr, const std::string &text ) const {
-    for( auto const &[ k, v ]: attrs ) {
-        if( v.name != attr ) {
-            continue;
-        }
-
-        for( auto const &[ index, value ]: v.values ) {
-            if( value == text ) {
-                return index;
-            }
-        }
+    auto const &it = values_by_name.find( attr );
+    if( it == values_by_name.end() ) {
+        return 0;
+    }
+    if( auto const &vit = it->second.find( text ); vit != it->second.end() ) {
+        return vit->second;
     }
     return 0;
 }
\ No newline at end of file
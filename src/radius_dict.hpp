@@ -1,6 +1,10 @@
 #ifndef RADIUS_DICT_HPP
 #define RADIUS_DICT_HPP
 
+#include <array>
+#include <unordered_map>
+#include <memory>
+
 enum class RADIUS_TYPE_T : uint8_t {
     STRING,
     INTEGER,
@@ -25,20 +29,88 @@ struct radius_attribute_t {
 
 using attributes_t = std::map<uint8_t,radius_attribute_t>;
 
+// Attributes we put into every request or look for in every answer,
+// resolved once when the dictionary is loaded
+enum class RADIUS_ATTR: uint8_t {
+    USER_NAME,
+    USER_PASSWORD,
+    CHAP_PASSWORD,
+    CHAP_CHALLENGE,
+    NAS_IDENTIFIER,
+    NAS_PORT_ID,
+    SERVICE_TYPE,
+    FRAMED_PROTOCOL,
+    FRAMED_IP_ADDRESS,
+    FRAMED_POOL,
+    CALLING_STATION_ID,
+    CLIENT_DNS_PRI,
+    CLIENT_DNS_SEC,
+    SUBSCRIBER_PROFILE_NAME,
+    ACCT_STATUS_TYPE,
+    ACCT_SESSION_ID,
+    ACCT_INPUT_PACKETS,
+    ACCT_OUTPUT_PACKETS,
+    ACCT_INPUT_OCTETS,
+    ACCT_OUTPUT_OCTETS,
+    ACCT_DELAY_TIME,
+    ERROR_CAUSE,
+    MAX
+};
+
+struct RadiusAttrDesc {
+    bool found { false };
+    uint8_t id { 0 };
+    uint32_t vendor { 0 };
+    RADIUS_TYPE_T type { RADIUS_TYPE_T::ERROR };
+    std::unordered_map<std::string,int32_t> values;
+
+    bool is( uint8_t i, uint32_t v ) const {
+        return found && id == i && vendor == v;
+    }
+
+    // 0 if there is no such value, as RadiusDict::getValueByName
+    int32_t value( const std::string &text ) const {
+        if( auto const &it = values.find( text ); it != values.end() ) {
+            return it->second;
+        }
+        return 0;
+    }
+};
+
+// Immutable once built, shared by AAA and every AuthClient
 class RadiusDict {
 public:
     RadiusDict( const std::vector<std::string> &files );
+
+    // Loads the compiled image from cache_path if it is newer than all the source files,
+    // otherwise parses the sources and rewrites the image. Empty cache_path disables caching.
+    // Runs while the runtime is being built, so cache problems are silently ignored
+    static std::shared_ptr<const RadiusDict> load( const std::vector<std::string> &files, const std::string &cache_path );
+
     std::tuple<uint8_t,uint32_t> getIdByName( const std::string &attr ) const;
     std::pair<std::string,RADIUS_TYPE_T> getAttrById( uint8_t id, uint32_t vendor = 0 ) const;
 
     int getValueByName( const std::string &attr, const std::string &text ) const;
+
+    const RadiusAttrDesc& attr( RADIUS_ATTR a ) const {
+        return compiled[ static_cast<size_t>( a ) ];
+    }
     
 private:
-    void parseFreeradDict( const std::string &path );
+    RadiusDict() = default;
+
+    void parseFreeradDict( const std::string &path, std::unordered_map<std::string,radius_attribute_t*> &names );
+    void buildIndex();
+    bool loadCache( const std::string &cache_path, const std::vector<std::string> &files );
+    void saveCache( const std::string &cache_path, const std::vector<std::string> &files ) const;
 
     attributes_t attrs;
     std::map<std::string,uint32_t> vendors;
     std::map<uint32_t,attributes_t> vsa;
+
+    std::unordered_map<std::string,std::tuple<uint8_t,uint32_t>> by_name;
+    std::unordered_map<std::string,std::unordered_map<std::string,int32_t>> values_by_name;
+    std::array<RadiusAttrDesc,static_cast<size_t>( RADIUS_ATTR::MAX )> compiled;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <iterator>
+
+#include "radius_group.hpp"
+#include "runtime.hpp"
+#include "string_helpers.hpp"
+
+extern std::shared_ptr<PPPOERuntime> runtime;
+
+RadiusServerGroup::RadiusServerGroup( io_service &i, RADIUS_BALANCE b, uint32_t t, std::chrono::seconds d ):
+    io( i ),
+    balance( b ),
+    dead_threshold( std::max<uint32_t>( t, 1 ) ),
+    dead_time( d )
+{}
+
+void RadiusServerGroup::add( std::string name, std::shared_ptr<AuthClient> client, uint16_t weight ) {
+    servers.emplace_back( std::move( name ), std::move( client ), weight );
+}
+
+bool RadiusServerGroup::empty() const {
+    return servers.empty();
+}
+
+const std::vector<RadiusGroupMember>& RadiusServerGroup::members() const {
+    return servers;
+}
+
+void RadiusServerGroup::setRate( uint32_t per_second ) {
+    rate = per_second;
+}
+
+void RadiusServerGroup::refill( std::chrono::steady_clock::time_point now ) {
+    // A tenth of a second worth of requests may go out at once
+    double burst = std::max( rate / 10.0, 1.0 );
+    for( auto &s: servers ) {
+        if( s.refilled != std::chrono::steady_clock::time_point {} ) {
+            s.tokens = std::min( burst, s.tokens + std::chrono::duration<double>( now - s.refilled ).count() * rate );
+        } else {
+            s.tokens = burst;
+        }
+        s.refilled = now;
+    }
+}
+
+size_t RadiusServerGroup::credit() {
+    if( rate == 0 ) {
+        return SIZE_MAX;
+    }
+    auto now = std::chrono::steady_clock::now();
+    refill( now );
+    size_t total = 0;
+    for( auto const &s: servers ) {
+        if( !s.dead( now ) && s.tokens >= 1 ) {
+            total += static_cast<size_t>( s.tokens );
+        }
+    }
+    return total;
+}
+
+std::optional<size_t> RadiusServerGroup::select( const std::vector<bool> &tried ) {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<size_t> candidates;
+    for( size_t i = 0; i < servers.size(); i++ ) {
+        if( !tried[ i ] && !servers[ i ].dead( now ) ) {
+            candidates.push_back( i );
+        }
+    }
+    if( rate != 0 ) {
+        refill( now );
+        std::vector<size_t> allowed;
+        std::copy_if( candidates.begin(), candidates.end(), std::back_inserter( allowed ), [ this ]( size_t i ) { return servers[ i ].tokens >= 1; } );
+        if( !allowed.empty() ) {
+            candidates = std::move( allowed );
+        }
+    }
+    if( candidates.empty() ) {
+        // Everything left is held down, probe the one which is going to come back first
+        std::optional<size_t> probe;
+        for( size_t i = 0; i < servers.size(); i++ ) {
+            if( !tried[ i ] && ( !probe || servers[ i ].dead_until < servers[ *probe ].dead_until ) ) {
+                probe = i;
+            }
+        }
+        return probe;
+    }
+
+    size_t best = candidates.front();
+    switch( balance ) {
+    case RADIUS_BALANCE::ROUND_ROBIN: {
+        int32_t total = 0;
+        for( auto i: candidates ) {
+            auto &s = servers[ i ];
+            s.current_weight += s.effective_weight;
+            total += s.effective_weight;
+            if( s.current_weight > servers[ best ].current_weight ) {
+                best = i;
+            }
+        }
+        servers[ best ].current_weight -= total;
+        break;
+    }
+    case RADIUS_BALANCE::LEAST_OUTSTANDING: {
+        // Expected wait on the server, slow and unhealthy servers get less
+        auto score = [ this ]( size_t i ) {
+            auto const &s = servers[ i ];
+            return static_cast<double>( s.client->outstanding() + 1 ) * std::max<uint64_t>( s.srtt_us, 1 ) / s.effective_weight;
+        };
+        for( auto i: candidates ) {
+            if( score( i ) < score( best ) ) {
+                best = i;
+            }
+        }
+        break;
+    }
+    }
+    return best;
+}
+
+void RadiusServerGroup::dispatch( std::shared_ptr<Sender> send, ResponseHandler handler, ErrorHandler error, std::vector<bool> tried ) {
+    auto idx = select( tried );
+    if( !idx.has_value() ) {
+        boost::asio::post( io, std::bind( std::move( error ), "No RADIUS servers configured" ) );
+        return;
+    }
+    tried[ *idx ] = true;
+    if( rate != 0 ) {
+        servers[ *idx ].tokens -= 1;
+    }
+    auto sent = std::chrono::steady_clock::now();
+
+    (*send)( *servers[ *idx ].client,
+        [ this, idx = *idx, sent, handler ]( RADIUS_CODE code, AVPReader avps ) {
+            on_answer( idx, std::chrono::steady_clock::now() - sent );
+            handler( code, avps );
+        },
+        [ this, idx = *idx, send, handler, error, tried ]( RADIUS_FAILURE kind, std::string err ) {
+            if( kind == RADIUS_FAILURE::ENCODING ) {
+                error( std::move( err ) );
+                return;
+            }
+            if( kind == RADIUS_FAILURE::TIMEOUT ) {
+                on_failure( idx );
+            }
+            if( std::find( tried.begin(), tried.end(), false ) == tried.end() ) {
+                error( std::move( err ) );
+                return;
+            }
+            servers[ idx ].failovers++;
+            runtime->logger->logInfo() << LOGS::RADIUS << "Server " << servers[ idx ].name << " failed: " << err << ", retrying on another server" << std::endl;
+            dispatch( send, handler, error, tried );
+        }
+    );
+}
+
+void RadiusServerGroup::on_answer( size_t idx, std::chrono::steady_clock::duration latency ) {
+    auto &s = servers[ idx ];
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>( latency ).count();
+    s.srtt_us = s.srtt_us == 0 ? us : ( s.srtt_us * 7 + us ) / 8;
+    s.effective_weight = std::min<int32_t>( s.effective_weight + 1, s.weight );
+    if( s.timeouts_in_row >= dead_threshold ) {
+        runtime->logger->logInfo() << LOGS::RADIUS << "Server " << s.name << " is answering again" << std::endl;
+    }
+    s.timeouts_in_row = 0;
+    s.dead_until = {};
+}
+
+void RadiusServerGroup::on_failure( size_t idx ) {
+    auto &s = servers[ idx ];
+    s.effective_weight = std::max<int32_t>( s.effective_weight / 2, 1 );
+    if( ++s.timeouts_in_row < dead_threshold ) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if( !s.dead( now ) ) {
+        s.dead_until = now + dead_time;
+        runtime->logger->logError() << LOGS::RADIUS << "Server " << s.name << " failed " << s.timeouts_in_row << " requests in a row, holding it down for " << dead_time.count() << " seconds" << std::endl;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef RADIUS_GROUP_HPP
+#define RADIUS_GROUP_HPP
+
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include "auth_client.hpp"
+
+enum class RADIUS_BALANCE: uint8_t {
+    ROUND_ROBIN,
+    LEAST_OUTSTANDING
+};
+
+struct RadiusGroupMember {
+    std::string name;
+    std::shared_ptr<AuthClient> client;
+    uint16_t weight;
+    // Weight lowered by timeouts and restored by answers, used by both selection modes
+    int32_t effective_weight;
+    // Smooth weighted round robin state
+    int32_t current_weight { 0 };
+    // Smoothed reply latency in microseconds
+    uint64_t srtt_us { 0 };
+    uint32_t timeouts_in_row { 0 };
+    std::chrono::steady_clock::time_point dead_until {};
+    uint64_t failovers { 0 };
+    // Token bucket of the group rate limit
+    double tokens { 0 };
+    std::chrono::steady_clock::time_point refilled {};
+
+    RadiusGroupMember( std::string n, std::shared_ptr<AuthClient> c, uint16_t w ):
+        name( std::move( n ) ),
+        client( std::move( c ) ),
+        weight( std::max<uint16_t>( w, 1 ) ),
+        effective_weight( weight )
+    {}
+
+    bool dead( std::chrono::steady_clock::time_point now ) const {
+        return now < dead_until;
+    }
+};
+
+// Set of RADIUS servers serving the same purpose. A request goes to one server chosen by
+// the balancing mode, on failure it is retried on every other server before the error
+// is reported. Servers failing dead_threshold requests in a row are skipped for dead_time
+class RadiusServerGroup {
+public:
+    RadiusServerGroup( io_service &i, RADIUS_BALANCE b, uint32_t dead_threshold, std::chrono::seconds dead_time );
+
+    void add( std::string name, std::shared_ptr<AuthClient> client, uint16_t weight );
+    bool empty() const;
+    const std::vector<RadiusGroupMember>& members() const;
+    // Caps requests per second to every server, 0 for no limit. Selection prefers servers
+    // with tokens left, the caller keeps within credit() to stay under the limit
+    void setRate( uint32_t per_second );
+    size_t credit();
+
+    template<typename T>
+    void request( const T &req, ResponseHandler handler, ErrorHandler error ) {
+        dispatch(
+            std::make_shared<Sender>( [ req ]( AuthClient &c, ResponseHandler h, FailureHandler e ) { c.request( req, std::move( h ), std::move( e ) ); } ),
+            std::move( handler ), std::move( error ), std::vector<bool>( servers.size(), false )
+        );
+    }
+
+    template<typename T>
+    void acct_request( const T &req, ResponseHandler handler, ErrorHandler error ) {
+        dispatch(
+            std::make_shared<Sender>( [ req ]( AuthClient &c, ResponseHandler h, FailureHandler e ) { c.acct_request( req, std::move( h ), std::move( e ) ); } ),
+            std::move( handler ), std::move( error ), std::vector<bool>( servers.size(), false )
+        );
+    }
+
+private:
+    using Sender = std::function<void( AuthClient&, ResponseHandler, FailureHandler )>;
+
+    void dispatch( std::shared_ptr<Sender> send, ResponseHandler handler, ErrorHandler error, std::vector<bool> tried );
+    std::optional<size_t> select( const std::vector<bool> &tried );
+    void on_answer( size_t idx, std::chrono::steady_clock::duration latency );
+    void on_failure( size_t idx );
+    void refill( std::chrono::steady_clock::time_point now );
+
+    io_service &io;
+    RADIUS_BALANCE balance;
+    uint32_t dead_threshold;
+    std::chrono::seconds dead_time;
+    uint32_t rate { 0 };
+    std::vector<RadiusGroupMember> servers;
+};
+
+#endif
@@ -11,6 +11,13 @@ enum class RADIUS_CODE : uint8_t {
     ACCOUNTING_REQUEST = 4,
     ACCOUNTING_RESPONSE = 5,
     ACCESS_CHALLENGE = 11,
+    // Dynamic Authorization, RFC 5176
+    DISCONNECT_REQUEST = 40,
+    DISCONNECT_ACK = 41,
+    DISCONNECT_NAK = 42,
+    COA_REQUEST = 43,
+    COA_ACK = 44,
+    COA_NAK = 45,
     RESERVED = 255
 };
 
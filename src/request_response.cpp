@@ -2,6 +2,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <algorithm>
 
 #include <boost/asio/ip/address_v4.hpp>
 #include <boost/asio/ip/network_v4.hpp>
@@ -14,175 +15,220 @@ using network_v4_t = boost::asio::ip::network_v4;
 #include "radius_dict.hpp"
 #include "radius_avp.hpp"
 
-static std::string password_pap_process( const authenticator_t &auth, const std::string secret, std::string pass ) {
-    std::string result;
-
-    auto nlen = pass.length();
-    if( nlen % 16 != 0 ) {
-        nlen += 16 - pass.length() % 16;
-    }
-
-    while( pass.size() != nlen ) {
-        pass.push_back( '\0' );
-    }
-
-    auto b1 = secret;
-    b1.insert( b1.end(), auth.begin(), auth.end() );
-    b1 = md5( b1 );
-
-    for( int i = 0; i < nlen / 16; i++ ) {
-        std::array<uint8_t,16> c1;
-        for( int j = 0; j < 16; j++ ) {
-            c1[ j ] = b1[ j ] ^ pass[ 16*i + j ];
-        }    
-        result.insert( result.end(), c1.begin(), c1.end() );
-        b1 = secret;
-        b1.insert( b1.end(), c1.begin(), c1.end() );
-        b1 = md5( b1 );
-    }
-
-    return result;
-}
-
 template<>
-std::vector<uint8_t> serialize<RadiusRequest>( const RadiusDict &dict, const RadiusRequest &req, const authenticator_t &a, const std::string &secret ) {
-    std::set<AVP> avp_set { 
-        AVP { dict, "User-Name", req.username },
-        AVP { dict, "User-Password", password_pap_process( a, secret, req.password ) }
-    };
+void serialize<RadiusRequest>( const RadiusDict &dict, const RadiusRequest &req, AVPWriter &out ) {
+    out.string( dict.attr( RADIUS_ATTR::USER_NAME ), req.username );
+    out.password( dict.attr( RADIUS_ATTR::USER_PASSWORD ), req.password );
 
     if( !req.nas_id.empty() ) {
-        avp_set.emplace( dict, "NAS-Identifier", req.nas_id );
+        out.string( dict.attr( RADIUS_ATTR::NAS_IDENTIFIER ), req.nas_id );
     }
 
     if( !req.framed_protocol.empty() ) {
-        if( uint32_t val = dict.getValueByName( "Framed-Protocol", req.framed_protocol ); val != 0 ) {
-            avp_set.emplace( dict, "Framed-Protocol", BE32{ val } );
+        if( uint32_t val = dict.attr( RADIUS_ATTR::FRAMED_PROTOCOL ).value( req.framed_protocol ); val != 0 ) {
+            out.integer( dict.attr( RADIUS_ATTR::FRAMED_PROTOCOL ), val );
         }
     }
 
     if( !req.service_type.empty() ) {
-        if( uint32_t val = dict.getValueByName( "Service-Type", req.service_type ); val != 0 ) {
-            avp_set.emplace( dict, "Service-Type", BE32{ val } );
+        if( uint32_t val = dict.attr( RADIUS_ATTR::SERVICE_TYPE ).value( req.service_type ); val != 0 ) {
+            out.integer( dict.attr( RADIUS_ATTR::SERVICE_TYPE ), val );
         }
     }
 
     if( !req.calling_station_id.empty() ) {
-        avp_set.emplace( dict, "Calling-Station-Id", req.calling_station_id );
+        out.string( dict.attr( RADIUS_ATTR::CALLING_STATION_ID ), req.calling_station_id );
     }
 
     if( !req.nas_port_id.empty() ) {
-        avp_set.emplace( dict, "NAS-Port-Id", req.nas_port_id );
+        out.string( dict.attr( RADIUS_ATTR::NAS_PORT_ID ), req.nas_port_id );
     }
-
-    return serializeAVP( avp_set );
 }
 
 template<>
-std::vector<uint8_t> serialize<RadiusRequestChap>( const RadiusDict &dict, const RadiusRequestChap &req, const authenticator_t &a, const std::string &secret ) {
-    std::set<AVP> avp_set { 
-        AVP { dict, "User-Name", req.username },
-        AVP { dict, "CHAP-Password", req.chap_response },
-        AVP { dict, "CHAP-Challenge", req.chap_challenge },
-    };
+void serialize<RadiusRequestChap>( const RadiusDict &dict, const RadiusRequestChap &req, AVPWriter &out ) {
+    out.string( dict.attr( RADIUS_ATTR::USER_NAME ), req.username );
+    out.string( dict.attr( RADIUS_ATTR::CHAP_PASSWORD ), req.chap_response );
+    out.string( dict.attr( RADIUS_ATTR::CHAP_CHALLENGE ), req.chap_challenge );
 
     if( !req.nas_id.empty() ) {
-        avp_set.emplace( dict, "NAS-Identifier", req.nas_id );
+        out.string( dict.attr( RADIUS_ATTR::NAS_IDENTIFIER ), req.nas_id );
     }
 
     if( !req.framed_protocol.empty() ) {
-        if( uint32_t val = dict.getValueByName( "Framed-Protocol", req.framed_protocol ); val != 0 ) {
-            avp_set.emplace( dict, "Framed-Protocol", BE32{ val } );
+        if( uint32_t val = dict.attr( RADIUS_ATTR::FRAMED_PROTOCOL ).value( req.framed_protocol ); val != 0 ) {
+            out.integer( dict.attr( RADIUS_ATTR::FRAMED_PROTOCOL ), val );
         }
     }
 
     if( !req.service_type.empty() ) {
-        if( uint32_t val = dict.getValueByName( "Service-Type", req.service_type ); val != 0 ) {
-            avp_set.emplace( dict, "Service-Type", BE32{ val } );
+        if( uint32_t val = dict.attr( RADIUS_ATTR::SERVICE_TYPE ).value( req.service_type ); val != 0 ) {
+            out.integer( dict.attr( RADIUS_ATTR::SERVICE_TYPE ), val );
         }
     }
 
     if( !req.calling_station_id.empty() ) {
-        avp_set.emplace( dict, "Calling-Station-Id", req.calling_station_id );
+        out.string( dict.attr( RADIUS_ATTR::CALLING_STATION_ID ), req.calling_station_id );
     }
 
     if( !req.nas_port_id.empty() ) {
-        avp_set.emplace( dict, "NAS-Port-Id", req.nas_port_id );
+        out.string( dict.attr( RADIUS_ATTR::NAS_PORT_ID ), req.nas_port_id );
     }
-
-    return serializeAVP( avp_set );
 }
 
 template<>
-RadiusResponse deserialize<RadiusResponse>( const RadiusDict &dict, std::vector<uint8_t> &v ) {
+RadiusResponse deserialize<RadiusResponse>( const RadiusDict &dict, AVPReader avps ) {
     RadiusResponse res;
 
-    auto avp_set = parseAVP( v );
-    for( auto const &avp: avp_set ) {
-        auto const &attr = dict.getAttrById( avp.type, avp.vendor ); 
-        if( attr.first == "Framed-IP-Address" ) {
-            if( auto const &[ ip, success ] = avp.getVal<BE32>(); success ) {
-                res.framed_ip = address_v4_t{ ip.native() };
+    AVPView avp;
+    while( avps.next( avp ) ) {
+        if( dict.attr( RADIUS_ATTR::FRAMED_IP_ADDRESS ).is( avp.type, avp.vendor ) ) {
+            if( auto ip = avp.integer(); ip.has_value() ) {
+                res.framed_ip = address_v4_t{ *ip };
             } 
-        } else if( attr.first == "Client-DNS-Pri" ) {
-            if( auto const &[ ip, success ] = avp.getVal<BE32>(); success ) {
-                res.dns1 = address_v4_t{ ip.native() };
+        } else if( dict.attr( RADIUS_ATTR::CLIENT_DNS_PRI ).is( avp.type, avp.vendor ) ) {
+            if( auto ip = avp.integer(); ip.has_value() ) {
+                res.dns1 = address_v4_t{ *ip };
             } 
-        } else if( attr.first == "Client-DNS-Sec" ) {
-            if( auto const &[ ip, success ] = avp.getVal<BE32>(); success ) {
-                res.dns2 = address_v4_t{ ip.native() };
+        } else if( dict.attr( RADIUS_ATTR::CLIENT_DNS_SEC ).is( avp.type, avp.vendor ) ) {
+            if( auto ip = avp.integer(); ip.has_value() ) {
+                res.dns2 = address_v4_t{ *ip };
             } 
-        } else if( attr.first == "Framed-Pool" ) {
-            res.framed_pool = { avp.value.begin(), avp.value.end() };
-        } else if( attr.first == "Subscriber-Profile-Name" ) {
-            res.pppoe_template = { avp.value.begin(), avp.value.end() };
+        } else if( dict.attr( RADIUS_ATTR::FRAMED_POOL ).is( avp.type, avp.vendor ) ) {
+            res.framed_pool = avp.string();
+        } else if( dict.attr( RADIUS_ATTR::SUBSCRIBER_PROFILE_NAME ).is( avp.type, avp.vendor ) ) {
+            res.pppoe_template = avp.string();
         }
     }
     return res;
 }
 
+// Server side of an Access-Accept, used by bench/radius_responder
 template<>
-std::vector<uint8_t> serialize<AcctRequest>( const RadiusDict &dict, const AcctRequest &req, const authenticator_t &a, const std::string &secret ) {
-    std::set<AVP> avp_set {
-        AVP { dict, "Acct-Session-Id", req.session_id },
-        AVP { dict, "User-Name", req.username },
-        AVP { dict, "Acct-Input-Packets", BE32( req.in_pkts ) },
-        AVP { dict, "Acct-Output-Packets", BE32( req.out_pkts ) },
-        AVP { dict, "Acct-Input-Octets", BE32( req.in_bytes ) },
-        AVP { dict, "Acct-Output-Octets", BE32( req.out_bytes ) }
-    };
-
-    if( !req.acct_status_type.empty() ) {
-        avp_set.emplace( dict, "Acct-Status-Type", req.acct_status_type );
+void serialize<RadiusResponse>( const RadiusDict &dict, const RadiusResponse &res, AVPWriter &out ) {
+    if( !res.framed_ip.is_unspecified() ) {
+        out.ipaddr( dict.attr( RADIUS_ATTR::FRAMED_IP_ADDRESS ), res.framed_ip.to_uint() );
+    }
+    if( !res.dns1.is_unspecified() ) {
+        out.ipaddr( dict.attr( RADIUS_ATTR::CLIENT_DNS_PRI ), res.dns1.to_uint() );
+    }
+    if( !res.dns2.is_unspecified() ) {
+        out.ipaddr( dict.attr( RADIUS_ATTR::CLIENT_DNS_SEC ), res.dns2.to_uint() );
+    }
+    if( !res.framed_pool.empty() ) {
+        out.string( dict.attr( RADIUS_ATTR::FRAMED_POOL ), res.framed_pool );
+    }
+    if( !res.pppoe_template.empty() ) {
+        out.string( dict.attr( RADIUS_ATTR::SUBSCRIBER_PROFILE_NAME ), res.pppoe_template );
     }
+}
+
+template<>
+void serialize<AcctRequest>( const RadiusDict &dict, const AcctRequest &req, AVPWriter &out ) {
+    out.string( dict.attr( RADIUS_ATTR::USER_NAME ), req.username );
 
     if( !req.nas_id.empty() ) {
-        avp_set.emplace( dict, "NAS-Identifier", req.nas_id );
+        out.string( dict.attr( RADIUS_ATTR::NAS_IDENTIFIER ), req.nas_id );
     }
 
     if( !req.calling_station_id.empty() ) {
-        avp_set.emplace( dict, "Calling-Station-Id", req.calling_station_id );
+        out.string( dict.attr( RADIUS_ATTR::CALLING_STATION_ID ), req.calling_station_id );
+    }
+
+    if( !req.acct_status_type.empty() ) {
+        out.value( dict.attr( RADIUS_ATTR::ACCT_STATUS_TYPE ), req.acct_status_type );
     }
 
+    out.integer( dict.attr( RADIUS_ATTR::ACCT_INPUT_OCTETS ), req.in_bytes );
+    out.integer( dict.attr( RADIUS_ATTR::ACCT_OUTPUT_OCTETS ), req.out_bytes );
+    out.string( dict.attr( RADIUS_ATTR::ACCT_SESSION_ID ), req.session_id );
+    out.integer( dict.attr( RADIUS_ATTR::ACCT_INPUT_PACKETS ), req.in_pkts );
+    out.integer( dict.attr( RADIUS_ATTR::ACCT_OUTPUT_PACKETS ), req.out_pkts );
+
     if( !req.nas_port_id.empty() ) {
-        avp_set.emplace( dict, "NAS-Port-Id", req.nas_port_id );
+        out.string( dict.attr( RADIUS_ATTR::NAS_PORT_ID ), req.nas_port_id );
+    }
+
+    if( req.delay_time != 0 ) {
+        out.integer( dict.attr( RADIUS_ATTR::ACCT_DELAY_TIME ), req.delay_time );
+    }
+}
+
+template<>
+AcctResponse deserialize<AcctResponse>( const RadiusDict &dict, AVPReader avps ) {
+    // Nothing in Accounting-Response is used yet
+    return {};
+}
+template<>
+CoARequest deserialize<CoARequest>( const RadiusDict &dict, AVPReader avps ) {
+    CoARequest req;
+
+    AVPView avp;
+    while( avps.next( avp ) ) {
+        if( dict.attr( RADIUS_ATTR::ACCT_SESSION_ID ).is( avp.type, avp.vendor ) ) {
+            req.session_id = avp.string();
+        } else if( dict.attr( RADIUS_ATTR::USER_NAME ).is( avp.type, avp.vendor ) ) {
+            req.username = avp.string();
+        } else if( dict.attr( RADIUS_ATTR::FRAMED_IP_ADDRESS ).is( avp.type, avp.vendor ) ) {
+            if( auto ip = avp.integer(); ip.has_value() ) {
+                req.framed_ip = address_v4_t{ *ip };
+            }
+        } else if( dict.attr( RADIUS_ATTR::SUBSCRIBER_PROFILE_NAME ).is( avp.type, avp.vendor ) ) {
+            req.pppoe_template = avp.string();
+        } else if( dict.attr( RADIUS_ATTR::CLIENT_DNS_PRI ).is( avp.type, avp.vendor ) ) {
+            if( auto ip = avp.integer(); ip.has_value() ) {
+                req.dns1 = address_v4_t{ *ip };
+            }
+        } else if( dict.attr( RADIUS_ATTR::CLIENT_DNS_SEC ).is( avp.type, avp.vendor ) ) {
+            if( auto ip = avp.integer(); ip.has_value() ) {
+                req.dns2 = address_v4_t{ *ip };
+            }
+        }
+    }
+    return req;
+}
+
+template<>
+void serialize<CoAResponse>( const RadiusDict &dict, const CoAResponse &res, AVPWriter &out ) {
+    if( res.error_cause != 0 ) {
+        out.integer( dict.attr( RADIUS_ATTR::ERROR_CAUSE ), res.error_cause );
     }
+}
 
-    return serializeAVP( avp_set );
+// Client side of Disconnect and CoA, used by bench/coa_sender
+template<>
+void serialize<CoARequest>( const RadiusDict &dict, const CoARequest &req, AVPWriter &out ) {
+    if( !req.session_id.empty() ) {
+        out.string( dict.attr( RADIUS_ATTR::ACCT_SESSION_ID ), req.session_id );
+    }
+    if( !req.username.empty() ) {
+        out.string( dict.attr( RADIUS_ATTR::USER_NAME ), req.username );
+    }
+    if( !req.framed_ip.is_unspecified() ) {
+        out.ipaddr( dict.attr( RADIUS_ATTR::FRAMED_IP_ADDRESS ), req.framed_ip.to_uint() );
+    }
+    if( !req.pppoe_template.empty() ) {
+        out.string( dict.attr( RADIUS_ATTR::SUBSCRIBER_PROFILE_NAME ), req.pppoe_template );
+    }
+    if( !req.dns1.is_unspecified() ) {
+        out.ipaddr( dict.attr( RADIUS_ATTR::CLIENT_DNS_PRI ), req.dns1.to_uint() );
+    }
+    if( !req.dns2.is_unspecified() ) {
+        out.ipaddr( dict.attr( RADIUS_ATTR::CLIENT_DNS_SEC ), req.dns2.to_uint() );
+    }
 }
 
 template<>
-AcctResponse deserialize<AcctResponse>( const RadiusDict &dict, std::vector<uint8_t> &v ) {
-    AcctResponse res;
-
-    auto avp_set = parseAVP( v );
-    for( auto const &avp: avp_set ) {
-        auto const &attr = dict.getAttrById( avp.type, avp.vendor ); 
-        // if( attr.first == "Framed-IP-Address" ) {
-        //     if( auto const &[ ip, success ] = avp.getVal<BE32>(); success ) {
-        //         res.framed_ip = address_v4_t{ ip.native() };
-        //     } 
-        // } 
+CoAResponse deserialize<CoAResponse>( const RadiusDict &dict, AVPReader avps ) {
+    CoAResponse res;
+
+    AVPView avp;
+    while( avps.next( avp ) ) {
+        if( dict.attr( RADIUS_ATTR::ERROR_CAUSE ).is( avp.type, avp.vendor ) ) {
+            if( auto cause = avp.integer(); cause.has_value() ) {
+                res.error_cause = *cause;
+            }
+        }
     }
     return res;
-}
\ No newline at end of file
+}
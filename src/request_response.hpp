@@ -4,12 +4,15 @@
 #include "utils.hpp"
 
 class RadiusDict;
+class AVPWriter;
+class AVPReader;
 
 template<typename T>
-std::vector<uint8_t> serialize( const RadiusDict &dict, const T &v, const authenticator_t &a, const std::string &secret );
+void serialize( const RadiusDict &dict, const T &v, AVPWriter &out );
 
+// avps point into the receive buffer and are only valid during the answer callback
 template<typename T>
-T deserialize( const RadiusDict &dict, std::vector<uint8_t> &v );
+T deserialize( const RadiusDict &dict, AVPReader avps );
 
 struct RadiusRequest {
     std::string username;
@@ -51,10 +54,28 @@ struct AcctRequest {
     uint32_t out_pkts;
     uint32_t in_bytes;
     uint32_t out_bytes;
+    // Seconds the record waited before it was sent
+    uint32_t delay_time { 0 };
 };
 
 struct AcctResponse {
 
 };
 
+// Disconnect-Request or CoA-Request from RFC 5176. The session is identified by
+// session_id, username and framed_ip, the rest is what a CoA changes
+struct CoARequest {
+    std::string session_id;
+    std::string username;
+    address_v4_t framed_ip;
+    std::string pppoe_template;
+    address_v4_t dns1;
+    address_v4_t dns2;
+};
+
+// ACK or NAK, a NAK tells why in error_cause
+struct CoAResponse {
+    uint32_t error_cause { 0 };
+};
+
 #endif
\ No newline at end of file
@@ -12,8 +12,15 @@
 #include "ethernet.hpp"
 #include "encap.hpp"
 #include "vpp_types.hpp"
+#include "dp_backend.hpp"
+#include "fake_backend.hpp"
+#ifdef WITH_VPP
 #include "vpp.hpp"
+#endif
 #include "session.hpp"
+#include "provision_queue.hpp"
+#include "admission.hpp"
+#include "coa_server.hpp"
 
 PPPOERuntime::PPPOERuntime( std::string cp, io_service &i ) : 
     conf_path( cp ),
@@ -40,10 +47,41 @@ PPPOERuntime::PPPOERuntime( std::string cp, io_service &i ) :
         logger->setLevel( conf.log_level );
     }
     
+    admission = std::make_shared<AdmissionControl>( io, conf.admission );
     aaa = std::make_shared<AAA>( io, conf.aaa_conf );
 
     logger->logInfo() << LOGS::MAIN << "Starting PPP control plane daemon..." << std::endl;
-    vpp = std::make_shared<VPPAPI>( io, logger );
+    if( auto const &msg = aaa->reloadLocalUsers(); !msg.empty() ) {
+        logger->logInfo() << LOGS::AAA << msg << std::endl;
+    }
+    if( auto const &msg = aaa->openAcctSpool(); !msg.empty() ) {
+        logger->logInfo() << LOGS::AAA << msg << std::endl;
+    }
+    if( conf.vpp_conf.backend == DP_BACKEND::VPP ) {
+#ifdef WITH_VPP
+        vpp = std::make_shared<VPPAPI>( io, logger );
+#else
+        logger->logError() << LOGS::MAIN << "pppcpd is built without VPP support, using in-memory data plane" << std::endl;
+#endif
+    }
+    if( !vpp ) {
+        vpp = std::make_shared<FakeBackend>( io, logger, conf.vpp_conf, conf.interfaces );
+    }
+    provision = std::make_shared<ProvisionQueue>( io, *vpp, logger, conf.vpp_conf );
+    setupDataplane();
+    vpp->set_restore_handler( std::bind( &PPPOERuntime::replayDataplane, this ) );
+
+    if( !conf.aaa_conf.coa_clients.empty() ) {
+        coa = std::make_shared<CoAServer>( io, conf.aaa_conf, aaa->dict );
+        if( auto const &err = coa->open(); !err.empty() ) {
+            logger->logError() << LOGS::RADIUS << err << std::endl;
+        } else {
+            logger->logInfo() << LOGS::RADIUS << "Listening for Disconnect and CoA requests on port " << conf.aaa_conf.coa_port << std::endl;
+        }
+    }
+}
+
+void PPPOERuntime::setupDataplane() {
     for( auto const &tapid: vpp->get_tap_interfaces() ) {
         logger->logInfo() << LOGS::MAIN << "Deleting TAP interface with id " << tapid << std::endl;
         auto ret = vpp->delete_tap( tapid );
@@ -112,6 +150,51 @@ PPPOERuntime::PPPOERuntime( std::string cp, io_service &i ) :
     }
 }
 
+void PPPOERuntime::replayDataplane() {
+    // Data plane came back empty: configuration first, then sessions through the provision queue
+    logger->logInfo() << LOGS::MAIN << "Data plane was restarted, replaying configuration and " << activeSessions.size() << " sessions" << std::endl;
+    auto started = std::chrono::steady_clock::now();
+    dataplane_epoch++;
+    replay.in_progress = true;
+    replay.sessions = 0;
+    replay.failed = 0;
+    setupDataplane();
+
+    auto left = std::make_shared<size_t>( 1 );
+    auto done = [ this, left, started ]() {
+        if( --*left > 0 ) {
+            return;
+        }
+        replay.in_progress = false;
+        replay.count++;
+        replay.duration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - started );
+        logger->logInfo() << LOGS::MAIN << "Data plane replay finished in " << replay.duration.count() << " ms: " 
+            << replay.sessions << " sessions, " << replay.failed << " failed" << std::endl;
+    };
+    for( auto &[ key, session ]: activeSessions ) {
+        // Not yet negotiated or already queued after reconnect
+        if( session->address == 0 || session->dp_pending ) {
+            continue;
+        }
+        ++*left;
+        replay.sessions++;
+        session->replay_dp( [ this, done, weak = std::weak_ptr<PPPOESession>( session ) ]( const std::string &err ) {
+            if( auto session = weak.lock(); session ) {
+                if( err.empty() ) {
+                    aaa->mapIfaceToSession( session->aaa_session_id, session->ifindex );
+                } else {
+                    // Can't be restored, let the subscriber connect again
+                    logger->logError() << LOGS::MAIN << "Cannot replay session " << session->session_id << ": " << err << std::endl;
+                    replay.failed++;
+                    deallocateSession( session->session_id );
+                }
+            }
+            done();
+        });
+    }
+    done();
+}
+
 void PPPOERuntime::reloadConfig() {
     try {
         YAML::Node config = YAML::LoadFile( conf_path );
@@ -119,6 +202,13 @@ void PPPOERuntime::reloadConfig() {
     } catch( std::exception &e ) {
         logger->logError() << LOGS::MAIN << "Error on reloading config: " << e.what() << std::endl;
     }
+    templates.build( conf );
+    // Not built yet on the first load
+    if( aaa ) {
+        if( auto const &msg = aaa->reloadLocalUsers(); !msg.empty() ) {
+            logger->logInfo() << LOGS::AAA << msg << std::endl;
+        }
+    }
 }
 
 bool operator<( const pppoe_key_t &l, const pppoe_key_t &r ) {
@@ -198,6 +288,15 @@ std::tuple<uint16_t,std::string> PPPOERuntime::allocateSession( const encapsulat
     return { 0, "Maximum of sessions" };
 }
 
+std::map<pppoe_key_t,std::shared_ptr<PPPOESession>>::iterator PPPOERuntime::findSession( uint16_t sid ) {
+    // Keys are ordered by session id first and session ids are unique
+    auto it = activeSessions.lower_bound( pppoe_key_t { mac_t {}, sid, 0, 0 } );
+    if( it != activeSessions.end() && it->second->session_id == sid ) {
+        return it;
+    }
+    return activeSessions.end();
+}
+
 std::string PPPOERuntime::deallocateSession( uint16_t sid ) {
     auto const &it = sessionSet.find( sid );
     if( it == sessionSet.end() ) {
@@ -213,7 +312,7 @@ std::string PPPOERuntime::deallocateSession( uint16_t sid ) {
     
     if (time_diff <= 10) {  // 10-second detection window
         dealloc_count_in_window++;
-        if (dealloc_count_in_window >= 10) {  // Alert if 10+ deallocations in 10 seconds
+        if (dealloc_count_in_window == 10) {  // Alert once per window when 10 deallocations happen in 10 seconds
             logger->logError() << LOGS::MAIN << "⚠️  BATCH DEALLOCATION DETECTED: " 
                                << dealloc_count_in_window << " sessions released in " 
                                << time_diff << " seconds!" << std::endl;
@@ -223,10 +322,7 @@ std::string PPPOERuntime::deallocateSession( uint16_t sid ) {
         last_dealloc_time = now;
     }
 
-    // More efficient: find session by iterating only once and using iterator
-    auto session_it = std::find_if( activeSessions.begin(), activeSessions.end(),
-        [sid]( const auto& pair ) { return pair.second->session_id == sid; } );
-    
+    auto session_it = findSession( sid );
     if( session_it != activeSessions.end() ) {
         aaa->stopSession( session_it->second->aaa_session_id );
         activeSessions.erase( session_it );
@@ -255,6 +351,9 @@ void PPPOERuntime::cleanup() {
     
     // 清理活动会话
     activeSessions.clear();
+    if( provision ) {
+        provision->flush();
+    }
     sessionSet.clear();
     pendingSession.clear();
     
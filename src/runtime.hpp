@@ -2,11 +2,16 @@
 #define RUNTIME_HPP
 
 #include <memory>
+#include <chrono>
 
 #include "config.hpp"
+#include "subscriber_templates.hpp"
 
 class AAA;
-class VPPAPI;
+class DPBackend;
+class ProvisionQueue;
+class AdmissionControl;
+class CoAServer;
 struct PPPOEQ;
 
 class pppoe_conn_t {
@@ -52,6 +57,15 @@ public:
     friend std::ostream& operator<<( std::ostream &stream, const pppoe_key_t &key ); 
 };
 
+// Outcome of replaying state into a restarted data plane
+struct DPReplayStats {
+    uint64_t count { 0 };
+    size_t sessions { 0 };
+    size_t failed { 0 };
+    std::chrono::milliseconds duration { 0 };
+    bool in_progress { false };
+};
+
 class PPPOERuntime {
 public:
     PPPOERuntime() = delete;
@@ -63,23 +77,33 @@ public:
     PPPOERuntime& operator=( PPPOERuntime&& ) = default;
 
     PPPOEGlobalConf conf;
+    SubscriberTemplates templates;
     mac_t hwaddr { 0, 0, 0, 0, 0, 0 };
     std::unique_ptr<Logger> logger;
     std::map<pppoe_key_t,std::shared_ptr<PPPOESession>> activeSessions;
     std::shared_ptr<LCPPolicy> lcp_conf;
     std::shared_ptr<AAA> aaa;
-    std::shared_ptr<VPPAPI> vpp;
+    std::shared_ptr<DPBackend> vpp;
+    std::shared_ptr<ProvisionQueue> provision;
+    std::shared_ptr<AdmissionControl> admission;
+    std::shared_ptr<CoAServer> coa;
     PPPOEQ pppoe_incoming;
     PPPOEQ pppoe_outcoming;
     PPPOEQ ppp_incoming;
     PPPOEQ ppp_outcoming;
+    // Bumped every time the data plane is set up again, things bound to it must be rebound
+    uint64_t dataplane_epoch { 0 };
+    DPReplayStats replay;
 
     void clearPendingSession( std::shared_ptr<boost::asio::steady_timer> timer, pppoe_conn_t key );
     std::string pendeSession( mac_t mac, uint16_t outer_vlan, uint16_t inner_vlan, const std::string &cookie );
     bool checkSession( mac_t mac, uint16_t outer_vlan, uint16_t inner_vlan, const std::string &cookie );
     std::tuple<uint16_t,std::string> allocateSession( const encapsulation_t &encap );
     std::string deallocateSession( uint16_t sid );
+    std::map<pppoe_key_t,std::shared_ptr<PPPOESession>>::iterator findSession( uint16_t sid );
     void reloadConfig();
+    void setupDataplane();
+    void replayDataplane();
     void cleanup();
 
 private:
@@ -1,14 +1,24 @@
 #include "session.hpp"
 #include "runtime.hpp"
 #include "vpp_types.hpp"
-#include "vpp.hpp"
+#include "dp_backend.hpp"
+#include "provision_queue.hpp"
+#include "pppoe.hpp"
+#include "string_helpers.hpp"
 #include <random>
 
 extern std::shared_ptr<PPPOERuntime> runtime;
 
+namespace {
+    // RFC 1661 4.6 default Restart timer
+    constexpr std::chrono::seconds restart_interval { 3 };
+}
+
 PPPOESession::PPPOESession( io_service &i, const encapsulation_t &e, uint16_t sid ): 
     io( i ),
     timer( io ),
+    lcp_restart( io ),
+    ipcp_restart( io ),
     encap( e ),
     session_id( sid ),
     ifindex( UINT32_MAX ),
@@ -22,40 +32,118 @@ PPPOESession::PPPOESession( io_service &i, const encapsulation_t &e, uint16_t si
 
 PPPOESession::~PPPOESession() {
     timer.cancel(); // Cancel any pending timer operations
+    lcp_restart.cancel();
+    ipcp_restart.cancel();
     deprovision_dp();
 }
 
-std::string PPPOESession::provision_dp() {
-    if( auto const &[ ret, ifi ] = runtime->vpp->add_pppoe_session( address, session_id, encap.source_mac, vrf, true ); !ret ) {
-        return "Cannot add new session to vpp ";
-    } else {
-        ifindex = ifi;
+void PPPOESession::provision_dp( dp_callback callback ) {
+    if( ifindex != UINT32_MAX ) {
+        // IPCP was renegotiated, dataplane is already set up
+        callback( {} );
+        return;
     }
-    if( !vrf.empty() ) {
-        if( !runtime->vpp->set_interface_table( ifindex, vrf ) ) {
-            return "Cannot move new session to vrf";
-        }
+    dp_callbacks.push_back( std::move( callback ) );
+    if( dp_pending ) {
+        return;
     }
-    if( !unnumbered.empty() ) {
-        auto [ sw_ifi, success ] = runtime->vpp->get_iface_by_name( unnumbered );
-        if( !success ) {
-            return "Cannot set unnumbered to new session: can't find interface with such name";
-        }
-        if( !runtime->vpp->set_unnumbered( ifindex, sw_ifi ) ) {
-            return "Cannot set unnumbered to new session";
+    dp_pending = true;
+    auto seq = ++dp_seq;
+
+    // Session may go away while it waits in the queue, so keep only weak reference
+    runtime->provision->add( { address, session_id, encap.source_mac, vrf, unnumbered }, 
+        [ weak = weak_from_this(), seq ]( const std::string &err, const DPBindings &bindings ) {
+            auto session = weak.lock();
+            if( !session ) {
+                return;
+            }
+            // Moved away by move_dp() or torn down, its callers wait for the newer add if there is one
+            if( session->dp_seq != seq ) {
+                return;
+            }
+            session->dp_pending = false;
+            if( bindings.ifindex != UINT32_MAX ) {
+                session->ifindex = bindings.ifindex;
+            }
+            session->unnumbered_ifindex = bindings.unnumbered_ifindex;
+            auto callbacks = std::move( session->dp_callbacks );
+            session->dp_callbacks.clear();
+            for( auto const &cb: callbacks ) {
+                cb( err );
+            }
         }
+    );
+}
+
+void PPPOESession::replay_dp( dp_callback callback ) {
+    // Data plane was restarted, the old bindings point to nothing
+    ifindex = UINT32_MAX;
+    unnumbered_ifindex.reset();
+    provision_dp( std::move( callback ) );
+}
+
+void PPPOESession::deprovision_dp() {
+    dp_callbacks.clear();
+    if( !dp_pending && ifindex == UINT32_MAX ) {
+        return;
+    }
+    // A new interface counts from zero, accounting carries on from the totals of this one
+    runtime->aaa->mapIfaceToSession( aaa_session_id, UINT32_MAX );
+    // If the add is still queued, the queue drops both; if in flight, the queue holds the delete until the add chain stops
+    runtime->provision->del( { address, session_id, encap.source_mac, vrf, unnumbered, { ifindex, unnumbered_ifindex } } );
+    // Completion of that add must not bring the bindings back
+    dp_seq++;
+    dp_pending = false;
+    ifindex = UINT32_MAX;
+    unnumbered_ifindex.reset();
+}
+
+void PPPOESession::move_dp( const InternedString &new_vrf, const InternedString &new_unnumbered, dp_callback callback ) {
+    if( new_vrf == vrf && new_unnumbered == unnumbered ) {
+        callback( {} );
+        return;
+    }
+    // Not provisioned yet, IPCP picks the new values up
+    bool provisioned = dp_pending || ifindex != UINT32_MAX;
+    // Whoever waited for the old add (IPCP) gets the answer of the new one
+    auto waiting = std::move( dp_callbacks );
+    deprovision_dp();
+    vrf = new_vrf;
+    unnumbered = new_unnumbered;
+    if( !provisioned ) {
+        callback( {} );
+        return;
+    }
+    dp_callbacks = std::move( waiting );
+    provision_dp( std::move( callback ) );
+}
+
+void PPPOESession::restart_timer( PPP_PROTO proto, bool run ) {
+    auto &restart = proto == PPP_PROTO::LCP ? lcp_restart : ipcp_restart;
+    if( !run ) {
+        restart.cancel();
+        return;
     }
-    return {};
+    restart.expires_from_now( restart_interval );
+    restart.async_wait( [ weak = weak_from_this(), proto ]( const boost::system::error_code &ec ) {
+        if( auto session = weak.lock(); session && !ec ) {
+            session->restart_expired( proto );
+        }
+    });
 }
 
-std::string PPPOESession::deprovision_dp() {
-    for( auto const &el: runtime->vpp->dump_unnumbered( ifindex ) ) {
-        runtime->vpp->set_unnumbered( el.unnumbered_sw_if_index, el.iface_sw_if_index, false );
+void PPPOESession::restart_expired( PPP_PROTO proto ) {
+    auto const &[ action, err ] = proto == PPP_PROTO::LCP ? lcp.timeout() : ipcp.timeout();
+    if( !err.empty() ) {
+        runtime->logger->logDebug() << LOGS::SESSION << "Restart timer of " << proto << " for session " << session_id << ": " << err << std::endl;
+        return;
     }
-    if( auto const &[ ret, ifi ] = runtime->vpp->add_pppoe_session( address, session_id, encap.source_mac, vrf, false ); !ret ) {
-        return "Cannot delete session from vpp ";
+    // TO- finishes the layer: the peer did not answer Max-Configure or Max-Terminate times
+    if( action == PPP_FSM_ACTION::LAYER_FINISHED ) {
+        runtime->logger->logError() << LOGS::SESSION << proto << " got no answer, terminate session " << session_id << std::endl;
+        pppoe::sendPADT( encap, session_id );
+        runtime->deallocateSession( session_id );
     }
-    return {};
 }
 
 void PPPOESession::startEcho() {
@@ -73,7 +161,10 @@ void PPPOESession::startEcho() {
 
 void PPPOESession::sendEchoReq( const boost::system::error_code& ec ) {
     if( ec ) {
-        runtime->logger->logError() << LOGS::SESSION << "Error on timer for LCP ECHO REQ: " << ec.message() << std::endl;
+        // Aborted when IPCP opened again and restarted the interval
+        if( ec != boost::asio::error::operation_aborted ) {
+            runtime->logger->logError() << LOGS::SESSION << "Error on timer for LCP ECHO REQ: " << ec.message() << std::endl;
+        }
         return;
     }
 
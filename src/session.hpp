@@ -2,6 +2,7 @@
 #define SESSION_HPP
 
 #include <memory>
+#include <optional>
 
 #include "evloop.hpp"
 #include "ppp_fsm.hpp"
@@ -10,6 +11,10 @@
 #include "ppp_lcp.hpp"
 #include "ppp_chap.hpp"
 #include "encap.hpp"
+#include "interner.hpp"
+
+// Called on control loop when dataplane work is done, empty string on success
+using dp_callback = std::function<void(const std::string&)>;
 
 struct PPPOESession : public std::enable_shared_from_this<PPPOESession> {
     // General Data
@@ -22,11 +27,17 @@ struct PPPOESession : public std::enable_shared_from_this<PPPOESession> {
     std::string cookie;
     
     // Various data
-    std::string username;
-    uint32_t address;
+    InternedString username;
+    uint32_t address { 0 };
     uint32_t ifindex;
-    std::string vrf;
-    std::string unnumbered;
+    std::optional<uint32_t> unnumbered_ifindex;
+    InternedString vrf;
+    InternedString unnumbered;
+    bool dp_pending { false };
+    // Latest provision_dp(), completions of earlier ones are dropped
+    uint64_t dp_seq { 0 };
+    // Callers waiting for the data plane, answered by the latest add
+    std::vector<dp_callback> dp_callbacks;
 
     // PPP FSM for all the protocols we support
     struct LCP_FSM lcp;
@@ -43,12 +54,21 @@ struct PPPOESession : public std::enable_shared_from_this<PPPOESession> {
     // EVLoop
     io_service &io;
     boost::asio::steady_timer timer;
+    // RFC 1661 restart timers, armed by LCP and IPCP while they wait for an answer
+    boost::asio::steady_timer lcp_restart;
+    boost::asio::steady_timer ipcp_restart;
 
     PPPOESession( io_service &i, const encapsulation_t &e, uint16_t sid );
     ~PPPOESession();
 
-    std::string provision_dp();
-    std::string deprovision_dp();
+    void provision_dp( dp_callback callback );
+    void replay_dp( dp_callback callback );
+    void deprovision_dp();
+    // Binds the session to another VRF or unnumbered interface, nothing is done if neither changed
+    void move_dp( const InternedString &new_vrf, const InternedString &new_unnumbered, dp_callback callback );
+    // Started on every Configure or Terminate-Request of proto, stopped when run is false
+    void restart_timer( PPP_PROTO proto, bool run );
+    void restart_expired( PPP_PROTO proto );
     void startEcho();
     void sendEchoReq( const boost::system::error_code &ec );
 };
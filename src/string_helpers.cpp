@@ -26,6 +26,29 @@ std::ostream& operator<<( std::ostream &stream, const PPP_FSM_STATE &state ) {
     return stream;
 }
 
+std::ostream& operator<<( std::ostream &stream, const PPP_FSM_EVENT &event ) {
+    switch( event ) {
+    case PPP_FSM_EVENT::Up:         stream << "Up"; break;
+    case PPP_FSM_EVENT::Down:       stream << "Down"; break;
+    case PPP_FSM_EVENT::Open:       stream << "Open"; break;
+    case PPP_FSM_EVENT::Close:      stream << "Close"; break;
+    case PPP_FSM_EVENT::TO_Plus:    stream << "TO+"; break;
+    case PPP_FSM_EVENT::TO_Minus:   stream << "TO-"; break;
+    case PPP_FSM_EVENT::RCR_Plus:   stream << "RCR+"; break;
+    case PPP_FSM_EVENT::RCR_Minus:  stream << "RCR-"; break;
+    case PPP_FSM_EVENT::RCA:        stream << "RCA"; break;
+    case PPP_FSM_EVENT::RCN:        stream << "RCN"; break;
+    case PPP_FSM_EVENT::RTR:        stream << "RTR"; break;
+    case PPP_FSM_EVENT::RTA:        stream << "RTA"; break;
+    case PPP_FSM_EVENT::RUC:        stream << "RUC"; break;
+    case PPP_FSM_EVENT::RXJ_Plus:   stream << "RXJ+"; break;
+    case PPP_FSM_EVENT::RXJ_Minus:  stream << "RXJ-"; break;
+    case PPP_FSM_EVENT::RXR:        stream << "RXR"; break;
+    }
+
+    return stream;
+}
+
 std::ostream& operator<<( std::ostream &stream, const PPPOEDISC_HDR &disc ) {
     stream << "discovery packet: ";
     stream << "Type = " << disc.type << " ";
@@ -54,6 +77,12 @@ std::ostream& operator<<( std::ostream &stream, const RADIUS_CODE &code ) {
     case RADIUS_CODE::ACCOUNTING_REQUEST: stream << "ACCOUNTING_REQUEST"; break;
     case RADIUS_CODE::ACCOUNTING_RESPONSE: stream << "ACCOUNTING_RESPONSE"; break;
     case RADIUS_CODE::ACCESS_CHALLENGE: stream << "ACCESS_CHALLENGE"; break;
+    case RADIUS_CODE::DISCONNECT_REQUEST: stream << "DISCONNECT_REQUEST"; break;
+    case RADIUS_CODE::DISCONNECT_ACK: stream << "DISCONNECT_ACK"; break;
+    case RADIUS_CODE::DISCONNECT_NAK: stream << "DISCONNECT_NAK"; break;
+    case RADIUS_CODE::COA_REQUEST: stream << "COA_REQUEST"; break;
+    case RADIUS_CODE::COA_ACK: stream << "COA_ACK"; break;
+    case RADIUS_CODE::COA_NAK: stream << "COA_NAK"; break;
     case RADIUS_CODE::RESERVED: stream << "RESERVED"; break;
     }
     return stream;
@@ -231,6 +260,90 @@ std::ostream& operator<<( std::ostream &os, const GET_VERSION_RESP &resp ) {
     return os;
 }
 
+std::ostream& operator<<( std::ostream &os, const GET_VPP_STATUS_RESP &resp ) {
+    os << "Connected: " << ( resp.connected ? "yes" : "no" ) << std::endl;
+    os << "Data plane epoch: " << resp.dataplane_epoch << std::endl;
+    os << "Replays: " << resp.replays << ( resp.replay_in_progress ? " (in progress)" : "" ) << std::endl;
+    os << "Last replay: " << resp.replay_sessions << " sessions, " << resp.replay_failed << " failed, " << resp.replay_duration_ms << " ms";
+    return os;
+}
+
+std::ostream& operator<<( std::ostream &os, const GET_VPP_API_STATS_RESP &resp ) {
+    auto flags = os.flags();
+    os << std::left;
+    os << " ";
+    os << std::setw( 30 ) << "Command";
+    os << std::setw( 10 ) << "Count";
+    os << std::setw( 10 ) << "Mean";
+    os << std::setw( 10 ) << "P50";
+    os << std::setw( 10 ) << "P90";
+    os << std::setw( 10 ) << "P99";
+    os << std::setw( 10 ) << "Max";
+    os << std::endl;
+    std::vector<HISTOGRAM_DUMP> rows { resp.queue_depth };
+    rows.insert( rows.end(), resp.latency_us.begin(), resp.latency_us.end() );
+    for( auto const &h: rows ) {
+        os << std::setw( 30 ) << h.name;
+        os << std::setw( 10 ) << h.count;
+        os << std::setw( 10 ) << h.mean;
+        os << std::setw( 10 ) << h.p50;
+        os << std::setw( 10 ) << h.p90;
+        os << std::setw( 10 ) << h.p99;
+        os << std::setw( 10 ) << h.max;
+        os << std::endl;
+    }
+    os << "Latency in microseconds, queue depth in commands";
+
+    os.flags( flags );
+    return os;
+}
+
+std::ostream& operator<<( std::ostream &os, const GET_RADIUS_SERVERS_RESP &resp ) {
+    auto flags = os.flags();
+    os << std::left;
+    os << " ";
+    os << std::setw( 16 ) << "Name";
+    os << std::setw( 6 ) << "Type";
+    os << std::setw( 22 ) << "Address";
+    os << std::setw( 7 ) << "State";
+    os << std::setw( 8 ) << "Weight";
+    os << std::setw( 10 ) << "Failover";
+    os << std::setw( 8 ) << "Queue";
+    os << std::setw( 10 ) << "Requests";
+    os << std::setw( 10 ) << "Replies";
+    os << std::setw( 10 ) << "Retrans";
+    os << std::setw( 10 ) << "Timeouts";
+    os << std::setw( 10 ) << "Dropped";
+    os << std::setw( 10 ) << "SRTT";
+    os << std::setw( 10 ) << "P50";
+    os << std::setw( 10 ) << "P99";
+    os << std::setw( 10 ) << "Max";
+    os << std::endl;
+    for( auto const &s: resp.servers ) {
+        os << std::setw( 16 ) << s.name;
+        os << std::setw( 6 ) << s.type;
+        os << std::setw( 22 ) << s.address;
+        os << std::setw( 7 ) << ( s.dead ? "dead" : "up" );
+        os << std::setw( 8 ) << ( std::to_string( s.effective_weight ) + "/" + std::to_string( s.weight ) );
+        os << std::setw( 10 ) << s.failovers;
+        os << std::setw( 8 ) << s.outstanding;
+        os << std::setw( 10 ) << s.requests;
+        os << std::setw( 10 ) << s.replies;
+        os << std::setw( 10 ) << s.retransmits;
+        os << std::setw( 10 ) << s.timeouts;
+        os << std::setw( 10 ) << s.dropped;
+        os << std::setw( 10 ) << s.srtt_us;
+        os << std::setw( 10 ) << s.latency_us.p50;
+        os << std::setw( 10 ) << s.latency_us.p99;
+        os << std::setw( 10 ) << s.latency_us.max;
+        os << std::endl;
+    }
+    os << "Reply latency in microseconds, weight is effective/configured";
+
+    os.flags( flags );
+    return os;
+}
+
 std::ostream& operator<<( std::ostream &os, const GET_AAA_SESSIONS_RESP &resp ) {
     auto flags = os.flags();
     os << std::left;
@@ -258,4 +371,26 @@ std::ostream& operator<<( std::ostream &os, const GET_AAA_SESSIONS_RESP &resp )
 
     os.flags( flags );
     return os;
+}
+std::ostream& operator<<( std::ostream &os, const GET_ADMISSION_RESP &resp ) {
+    os << "State: " << resp.state << std::endl;
+    os << "Authentications in flight: " << resp.inflight << " (peak " << resp.peak_inflight << ", total " << resp.auths << ")" << std::endl;
+    os << "RADIUS latency: " << resp.srtt_us / 1000 << " ms" << std::endl;
+    os << "PADO delayed: " << resp.pado_delayed << ", waiting now: " << resp.held << std::endl;
+    os << "Not answered: " << resp.padi_dropped << " PADI, " << resp.padr_dropped << " PADR" << std::endl;
+    os << "State changes: " << resp.transitions << std::endl;
+    os << "PADO delay " << resp.pado_delay << " ms from " << resp.delay_inflight << " in flight or " << resp.delay_latency << " ms latency, ";
+    os << "shedding from " << resp.high_water << " to " << resp.low_water << " in flight";
+    return os;
+}
+
+std::ostream& operator<<( std::ostream &os, const GET_COA_RESP &resp ) {
+    if( !resp.listening ) {
+        os << "Not listening, no CoA clients configured";
+        return os;
+    }
+    os << "Listening on port " << resp.port << " for " << resp.clients << " clients" << std::endl;
+    os << "Requests: " << resp.requests << ", NAK: " << resp.naks << ", retransmitted: " << resp.duplicates << ", dropped: " << resp.dropped << std::endl;
+    os << "Sessions disconnected: " << resp.disconnected << ", changed: " << resp.changed;
+    return os;
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 class pppoe_key_t;
 class pppoe_conn_t;
 enum class PPP_FSM_STATE: uint8_t;
+enum class PPP_FSM_EVENT: uint8_t;
 struct PPPOEDISC_HDR;
 struct ETHERNET_HDR;
 enum class RADIUS_CODE : uint8_t;
@@ -23,10 +24,16 @@ struct GET_PPPOE_SESSION_RESP;
 struct GET_VPP_IFACES_RESP;
 struct GET_VERSION_RESP;
 struct GET_AAA_SESSIONS_RESP;
+struct GET_VPP_STATUS_RESP;
+struct GET_VPP_API_STATS_RESP;
+struct GET_RADIUS_SERVERS_RESP;
+struct GET_ADMISSION_RESP;
+struct GET_COA_RESP;
 
 using mac_t = std::array<uint8_t,6>;
 
 std::ostream& operator<<( std::ostream &stream, const PPP_FSM_STATE &state );
+std::ostream& operator<<( std::ostream &stream, const PPP_FSM_EVENT &event );
 std::ostream& operator<<( std::ostream &stream, const PPPOEDISC_HDR &disc ); 
 std::ostream& operator<<( std::ostream &stream, const ETHERNET_HDR &disc ); 
 std::ostream& operator<<( std::ostream &stream, const RADIUS_CODE &code ); 
@@ -46,5 +53,10 @@ std::ostream& operator<<( std::ostream &stream, const GET_PPPOE_SESSION_RESP &re
 std::ostream& operator<<( std::ostream &stream, const GET_VPP_IFACES_RESP &resp );
 std::ostream& operator<<( std::ostream &stream, const GET_VERSION_RESP &resp );
 std::ostream& operator<<( std::ostream &stream, const GET_AAA_SESSIONS_RESP &resp );
+std::ostream& operator<<( std::ostream &stream, const GET_VPP_STATUS_RESP &resp );
+std::ostream& operator<<( std::ostream &stream, const GET_VPP_API_STATS_RESP &resp );
+std::ostream& operator<<( std::ostream &stream, const GET_RADIUS_SERVERS_RESP &resp );
+std::ostream& operator<<( std::ostream &stream, const GET_ADMISSION_RESP &resp );
+std::ostream& operator<<( std::ostream &stream, const GET_COA_RESP &resp );
 
 #endif
\ No newline at end of file
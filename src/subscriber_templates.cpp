@@ -0,0 +1,63 @@
+#include <algorithm>
+
+#include "subscriber_templates.hpp"
+
+namespace {
+    const std::string no_name;
+}
+
+void SubscriberTemplates::build( PPPOEGlobalConf &conf ) {
+    std::fill( pools.begin(), pools.end(), nullptr );
+    for( auto &[ name, pool ]: conf.aaa_conf.pools ) {
+        auto const &[ it, added ] = pool_index.emplace( name, pool_names.size() );
+        if( added ) {
+            pool_names.push_back( name );
+            pools.push_back( nullptr );
+        }
+        pools[ it->second ] = &pool;
+    }
+
+    for( auto &t: templates ) {
+        t.removed = true;
+    }
+    for( auto const &[ name, conf_template ]: conf.pppoe_templates ) {
+        auto const &[ it, added ] = template_index.emplace( name, templates.size() );
+        if( added ) {
+            templates.emplace_back();
+        }
+        auto &t = templates[ it->second ];
+        t.name = name;
+        t.pool = findPool( conf_template.framed_pool );
+        t.dns1 = conf_template.dns1;
+        t.dns2 = conf_template.dns2;
+        t.vrf = conf_template.vrf;
+        t.unnumbered = conf_template.unnumbered;
+        t.removed = false;
+    }
+}
+
+template_handle_t SubscriberTemplates::findTemplate( const std::string &name ) const {
+    if( auto const &it = template_index.find( name ); it != template_index.end() && !templates[ it->second ].removed ) {
+        return it->second;
+    }
+    return NO_HANDLE;
+}
+
+pool_handle_t SubscriberTemplates::findPool( const std::string &name ) const {
+    if( auto const &it = pool_index.find( name ); it != pool_index.end() && pools[ it->second ] != nullptr ) {
+        return it->second;
+    }
+    return NO_HANDLE;
+}
+
+const SubscriberTemplate* SubscriberTemplates::get( template_handle_t h ) const {
+    return h < templates.size() ? &templates[ h ] : nullptr;
+}
+
+FRAMED_POOL* SubscriberTemplates::pool( pool_handle_t h ) const {
+    return h < pools.size() ? pools[ h ] : nullptr;
+}
+
+const std::string& SubscriberTemplates::poolName( pool_handle_t h ) const {
+    return h < pool_names.size() ? pool_names[ h ] : no_name;
+}
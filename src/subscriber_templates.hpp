@@ -0,0 +1,53 @@
+#ifndef SUBSCRIBER_TEMPLATES_HPP
+#define SUBSCRIBER_TEMPLATES_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "config.hpp"
+#include "interner.hpp"
+
+// Index of a template or a pool. A name keeps its handle across reloads
+using template_handle_t = uint32_t;
+using pool_handle_t = uint32_t;
+inline constexpr uint32_t NO_HANDLE { UINT32_MAX };
+
+struct SubscriberTemplate {
+    std::string name;
+    pool_handle_t pool { NO_HANDLE };
+    address_v4_t dns1;
+    address_v4_t dns2;
+    InternedString vrf;
+    InternedString unnumbered;
+    // Gone from the configuration, sessions using it keep the last content
+    bool removed { false };
+};
+
+// pppoe_templates and aaa_conf.pools resolved once per configuration load, sessions keep
+// handles to them. Names are only hashed when they come from RADIUS, a CoA or a local user
+class SubscriberTemplates {
+public:
+    // Called after every load of conf, pool handles point into conf.aaa_conf.pools
+    void build( PPPOEGlobalConf &conf );
+
+    // NO_HANDLE if the name is not configured
+    template_handle_t findTemplate( const std::string &name ) const;
+    pool_handle_t findPool( const std::string &name ) const;
+
+    // nullptr for NO_HANDLE
+    const SubscriberTemplate* get( template_handle_t h ) const;
+    // nullptr for NO_HANDLE and for a pool which is not configured anymore
+    FRAMED_POOL* pool( pool_handle_t h ) const;
+    const std::string& poolName( pool_handle_t h ) const;
+
+private:
+    std::vector<SubscriberTemplate> templates;
+    std::unordered_map<std::string,template_handle_t> template_index;
+    std::vector<std::string> pool_names;
+    std::vector<FRAMED_POOL*> pools;
+    std::unordered_map<std::string,pool_handle_t> pool_index;
+};
+
+#endif
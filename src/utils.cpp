@@ -1,18 +1,15 @@
 #include <string>
 #include <algorithm>
 #include <random>
-
-#define BOOST_UUID_COMPAT_PRE_1_71_MD5
+#include <cstring>
 
 #include <boost/random/random_device.hpp>
-#include <boost/uuid/detail/md5.hpp>
 #include <boost/algorithm/hex.hpp>
 
 #include "utils.hpp"
+#include "md5.hpp"
 #include "radius_packet.hpp"
 
-using md5_t = boost::uuids::detail::md5;
-
 authenticator_t generateAuthenticator() {
     boost::random::random_device rng;
     authenticator_t ret;
@@ -23,14 +20,15 @@ authenticator_t generateAuthenticator() {
 }
 
 std::string md5( const std::string &v ) {
-    md5_t hash;
-    md5_t::digest_type digest;
-
-    hash.process_bytes( v.data(), v.size() );
-    hash.get_digest( digest );
-    const auto charDigest = reinterpret_cast<const char *>(&digest);
+    auto digest = md5( { v } );
+    return { digest.begin(), digest.end() };
+}
 
-    return { charDigest, charDigest + sizeof( md5_t::digest_type ) };
+authenticator_t md5( std::initializer_list<std::string_view> parts ) {
+    authenticator_t ret;
+    Md5Job job { parts, ret };
+    md5_batch( &job, 1 );
+    return ret;
 }
 
 std::string md5_hex( const std::string &v ) {
@@ -4,11 +4,15 @@
 #include <array>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <initializer_list>
 
 using authenticator_t = std::array<uint8_t,16>;
 
 authenticator_t generateAuthenticator();
 std::string md5( const std::string &v );
+// Digest of the concatenated parts, at most four of them. Many digests at once: md5_batch()
+authenticator_t md5( std::initializer_list<std::string_view> parts );
 std::string md5_hex( const std::string &v );
 std::string random_string( size_t length );
 uint32_t random_uin32_t();
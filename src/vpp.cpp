@@ -1,13 +1,15 @@
 #include <iostream>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include "string_helpers.hpp"
 #include "vpp.hpp"
 #include "vpp_types.hpp"
 #include "log.hpp"
-#include "string_helpers.hpp"
-
-extern "C" {
-    #include "vpp-api/client/stat_client.h"
-}
 
 DEFINE_VAPI_MSG_IDS_VPE_API_JSON
 DEFINE_VAPI_MSG_IDS_MEMCLNT_API_JSON
@@ -17,62 +19,277 @@ DEFINE_VAPI_MSG_IDS_PPPOE_API_JSON
 DEFINE_VAPI_MSG_IDS_POLICER_API_JSON
 DEFINE_VAPI_MSG_IDS_IP_API_JSON
 
+// Upper bound of requests pipelined to VPP at once, must fit into VAPI queues
+static constexpr size_t VPP_MAX_INFLIGHT { 512 };
+
+// Reconnect attempts start at the minimal delay and back off up to the maximal one
+static constexpr std::chrono::seconds VPP_RECONNECT_MIN { 1 };
+static constexpr std::chrono::seconds VPP_RECONNECT_MAX { 30 };
+
 VPPAPI::VPPAPI( boost::asio::io_context &i, std::unique_ptr<Logger> &l ):
-        io( i ),
-        timer( io ),
-        logger( l )
+        DPBackend( i, l ),
+        wake( worker_io ),
+        timer( worker_io ),
+        reconnect_timer( worker_io ),
+        reconnect_backoff( VPP_RECONNECT_MIN ),
+        dispatch_timer( worker_io )
 {
-    auto ret = con.connect( "vbng", nullptr, 32, 32 );
-    if( ret == VAPI_OK ) {
-        logger->logInfo() << LOGS::VPP << "Connected to VPP API" << std::endl;
-    } else {
-        logger->logError() << LOGS::VPP << "Cannot connect to VPP API" << std::endl;
+    wake.assign( eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) );
+    wait_commands();
+    worker = std::thread( [ this ]() { worker_io.run(); } );
+
+    call( __func__, [ this ]() {
+        auto ret = con.connect( "vbng", nullptr, VPP_MAX_INFLIGHT, VPP_MAX_INFLIGHT );
+        if( ret == VAPI_OK ) {
+            logger->logInfo() << LOGS::VPP << "Connected to VPP API" << std::endl;
+            on_connected();
+        } else {
+            logger->logError() << LOGS::VPP << "Cannot connect to VPP API" << std::endl;
+        }
+        timer.expires_after( std::chrono::seconds( 10 ) );
+        timer.async_wait( std::bind( &VPPAPI::process_msgs, this, std::placeholders::_1 ) );
+    });
+    get_ifaces();
+}
+
+VPPAPI::~VPPAPI() {
+    call( __func__, [ this ]() {
+        timer.cancel();
+        reconnect_timer.cancel();
+        if( !alive ) {
+            return;
+        }
+        drain();
+        dispatch_timer.cancel();
+        if( vapi_fd ) {
+            // fd is owned by VAPI, don't close it
+            vapi_fd->release();
+        }
+        iface_events.reset();
+        close_stats();
+        auto ret = con.disconnect();
+        if( ret == VAPI_OK ) {
+            logger->logInfo() << LOGS::VPP << "Disconnected from VPP API" << std::endl;
+        } else {
+            logger->logError() << LOGS::VPP << "Something went wrong, cannot disconnect from VPP API" << std::endl;
+        }
+    });
+    worker_io.stop();
+    worker.join();
+}
+
+bool VPPAPI::on_worker() const {
+    return std::this_thread::get_id() == worker.get_id();
+}
+
+void VPPAPI::submit( std::function<void()> command ) {
+    stats.queue_depth.record( ++queued );
+    commands.push( std::move( command ) );
+    // Only the first command after the worker has drained the queue needs to wake it up
+    if( !wake_pending.exchange( true ) ) {
+        uint64_t one = 1;
+        if( ::write( wake.native_handle(), &one, sizeof( one ) ) < 0 ) {
+            logger->logError() << LOGS::VPP << "Cannot wake up VPP API worker: " << strerror( errno ) << std::endl;
+        }
     }
-    timer.expires_after( std::chrono::seconds( 10 ) );
-    timer.async_wait( std::bind( &VPPAPI::process_msgs, this, std::placeholders::_1 ) );
 }
 
-void VPPAPI::process_msgs( boost::system::error_code err ) {
-    logger->logDebug() << LOGS::VPP << "Periodic timer to ping VPP API" << std::endl;
-    vapi::Control_ping ping { con };
+void VPPAPI::wait_commands() {
+    wake.async_wait( boost::asio::posix::stream_descriptor::wait_read, std::bind( &VPPAPI::run_commands, this, std::placeholders::_1 ) );
+}
 
-    auto ret = ping.execute(); 
-    if( ret != VAPI_OK ) {
-        logger->logError() << LOGS::VPP << "Error on executing Control_ping api method" << std::endl;
+void VPPAPI::run_commands( boost::system::error_code ec ) {
+    if( ec ) {
+        return;
+    }
+    uint64_t cnt;
+    if( ::read( wake.native_handle(), &cnt, sizeof( cnt ) ) < 0 && errno != EAGAIN ) {
+        log_async( LOGL::ERROR, std::string{ "Cannot read VPP API worker eventfd: " } + strerror( errno ) );
     }
+    // Clear the flag before draining: a command pushed meanwhile wakes us up again
+    wake_pending = false;
+    while( auto command = commands.pop() ) {
+        queued--;
+        ( *command )();
+    }
+    wait_commands();
+}
 
-    do {
-        ret = con.wait_for_response( ping );
-    } while( ret == VAPI_EAGAIN );
+template<typename F>
+auto VPPAPI::call( const char *name, F &&fn ) -> decltype( fn() ) {
+    using R = decltype( fn() );
+    auto started = std::chrono::steady_clock::now();
+    std::packaged_task<R()> task { std::forward<F>( fn ) };
+    auto result = task.get_future();
+    submit( [ &task ]() { task(); } );
+    result.wait();
+    record( name, started );
+    return result.get();
+}
 
-    collect_counters();
+void VPPAPI::record( const std::string &name, std::chrono::steady_clock::time_point started ) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - started ).count();
+    stats.latency_us[ name ].record( us );
+}
 
-    for( auto const &[ ifi, ctrs ]: counters ) {
-        // logger->logError() << LOGS::VPP << "Interface ifindex: " << ifi << " Counters: " << ctrs << std::endl;
+void VPPAPI::log_async( LOGL level, std::string msg ) {
+    // Logger is not thread safe: worker hands its messages over to the event loop. Bodies of
+    // synchronous methods log directly, which is fine only because call() blocks the loop meanwhile
+    boost::asio::post( io, [ this, level, msg = std::move( msg ) ]() {
+        switch( level ) {
+        case LOGL::ERROR:
+            logger->logError() << LOGS::VPP << msg << std::endl;
+            break;
+        case LOGL::INFO:
+            logger->logInfo() << LOGS::VPP << msg << std::endl;
+            break;
+        default:
+            logger->logDebug() << LOGS::VPP << msg << std::endl;
+            break;
+        }
+    });
+}
+
+DPApiStats VPPAPI::api_stats() const {
+    return stats;
+}
+
+void VPPAPI::on_connected() {
+    alive = true;
+    if( int fd = -1; con.get_fd( &fd ) == VAPI_OK && fd >= 0 ) {
+        vapi_fd.emplace( worker_io, fd );
+        log_async( LOGL::DEBUG, "Dispatching VPP API replies on fd " + std::to_string( fd ) );
+    } else {
+        log_async( LOGL::DEBUG, "VPP API has no fd to wait on, polling for async replies" );
+    }
+    iface_events = std::make_unique<vapi::Sw_interface_event_registration>( con, std::bind( &VPPAPI::on_iface_event, this, std::placeholders::_1 ) );
+    if( !want_interface_events() ) {
+        log_async( LOGL::ERROR, "Cannot subscribe to interface events, interface table may go stale" );
+    }
+    arm_dispatch();
+}
+
+bool VPPAPI::connected() const {
+    return alive;
+}
+
+void VPPAPI::process_msgs( boost::system::error_code err ) {
+    if( err == boost::asio::error::operation_aborted ) {
+        return;
+    }
+    // While disconnected the reconnect timer owns the connection
+    if( alive ) {
+        log_async( LOGL::DEBUG, "Periodic timer to ping VPP API" );
+        vapi::Control_ping ping { con };
+
+        auto ret = ping.execute(); 
+        if( ret == VAPI_OK ) {
+            do {
+                ret = con.wait_for_response( ping );
+            } while( ret == VAPI_EAGAIN );
+        }
+        if( ret != VAPI_OK ) {
+            log_async( LOGL::ERROR, "Error on executing Control_ping api method: " + std::to_string( ret ) );
+        }
+
+        if( ret == VAPI_OK ) {
+            collect_counters();
+            arm_dispatch();
+        } else {
+            connection_lost();
+        }
     }
 
     timer.expires_after( std::chrono::seconds( 10 ) );
     timer.async_wait( std::bind( &VPPAPI::process_msgs, this, std::placeholders::_1 ) );
 }
 
-VPPAPI::~VPPAPI() {
-    auto ret = con.disconnect();
-    if( ret == VAPI_OK ) {
-        logger->logInfo() << LOGS::VPP << "Disconnected from VPP API" << std::endl;
-    } else {
-        logger->logError() << LOGS::VPP << "Something went wrong, cannot disconnect from VPP API" << std::endl;
+void VPPAPI::connection_lost() {
+    if( !alive ) {
+        return;
+    }
+    alive = false;
+    log_async( LOGL::ERROR, "Lost connection to VPP API, all data plane state is dropped" );
+
+    fail_requests();
+    iface_events.reset();
+    dispatch_timer.cancel();
+    if( vapi_fd ) {
+        vapi_fd->release();
+        vapi_fd.reset();
     }
+    close_stats();
+    con.disconnect();
+
+    // Nothing of it survives VPP restart: indexes and tables are assigned anew
+    boost::asio::post( io, [ this ]() {
+        ifaces.clear();
+        iface_names.clear();
+        vrfs.clear();
+        vrf_generation = InternedString::newGeneration();
+        counters.clear();
+    });
+
+    reconnect_backoff = VPP_RECONNECT_MIN;
+    reconnect_timer.expires_after( reconnect_backoff );
+    reconnect_timer.async_wait( std::bind( &VPPAPI::reconnect, this, std::placeholders::_1 ) );
 }
 
-std::tuple<bool,uint32_t> VPPAPI::add_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const std::string &vrf, bool is_add ) {
-    vapi::Pppoe_add_del_session pppoe( con );
+void VPPAPI::reconnect( boost::system::error_code ec ) {
+    if( ec ) {
+        return;
+    }
+    if( con.connect( "vbng", nullptr, VPP_MAX_INFLIGHT, VPP_MAX_INFLIGHT ) != VAPI_OK ) {
+        reconnect_backoff = std::min( reconnect_backoff * 2, VPP_RECONNECT_MAX );
+        log_async( LOGL::ERROR, "Cannot reconnect to VPP API, next attempt in " + std::to_string( reconnect_backoff.count() ) + "s" );
+        reconnect_timer.expires_after( reconnect_backoff );
+        reconnect_timer.async_wait( std::bind( &VPPAPI::reconnect, this, std::placeholders::_1 ) );
+        return;
+    }
+    log_async( LOGL::INFO, "Reconnected to VPP API" );
+    on_connected();
+    boost::asio::post( io, [ this ]() {
+        get_ifaces();
+        if( restore_handler ) {
+            restore_handler();
+        }
+    });
+}
 
-    logger->logInfo() << LOGS::VPP << 
-        "Set up PPPoE session " << session_id << ": " << 
-        mac << " " << boost::asio::ip::address_v4( ip_address ).to_string() << 
-        " vrf: " << ( vrf.empty() ? "global" : vrf ) <<
-        " action: " << ( is_add ? "add" : "del" ) << std::endl;
+void VPPAPI::fail_requests() {
+    // Callbacks may queue new requests, they fail immediately as we are not alive
+    auto failed = std::move( pending );
+    pending.clear();
+    for( auto &[ ptr, req ]: inflight ) {
+        failed.push_back( std::move( req ) );
+    }
+    inflight.clear();
+    completed.clear();
+    if( !failed.empty() ) {
+        log_async( LOGL::ERROR, "Failing " + std::to_string( failed.size() ) + " VPP API requests" );
+    }
+    for( auto &req: failed ) {
+        boost::asio::post( io, std::move( req.fail ) );
+    }
+}
 
+bool VPPAPI::resolve_vrf( const InternedString &vrf, uint32_t &vrf_id ) const {
+    if( vrf.empty() ) {
+        vrf_id = 0;
+        return true;
+    }
+    if( vrf.cachedId( vrf_generation, vrf_id ) ) {
+        return true;
+    }
+    if( auto const &it = vrfs.find( vrf.str() ); it != vrfs.end() ) {
+        vrf_id = it->second;
+        vrf.cacheId( vrf_generation, vrf_id );
+        return true;
+    }
+    return false;
+}
+
+void VPPAPI::fill_pppoe_session( vapi::Pppoe_add_del_session &pppoe, uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, uint32_t vrf_id, bool is_add ) {
     auto &req = pppoe.get_request().get_payload();
 
     req.client_ip.af = vapi_enum_address_family::ADDRESS_IP4;
@@ -85,21 +302,31 @@ std::tuple<bool,uint32_t> VPPAPI::add_pppoe_session( uint32_t ip_address, uint16
     req.client_mac[0] = mac[0]; req.client_mac[1] = mac[1]; req.client_mac[2] = mac[2]; 
     req.client_mac[3] = mac[3]; req.client_mac[4] = mac[4]; req.client_mac[5] = mac[5]; 
 
-    if( vrf.empty() ) {
-        req.decap_vrf_id = 0;
-    } else {
-        if( auto vrfIt = vrfs.find( vrf ); vrfIt == vrfs.end() ) {
-            return { false, 0 };
-        } else {
-            req.decap_vrf_id = vrfIt->second;
-        }
-    }
+    req.decap_vrf_id = vrf_id;
     req.session_id = session_id;
     if( is_add ) {
         req.is_add = 1;
     } else {
         req.is_add = 0;
     }
+}
+
+std::tuple<bool,uint32_t> VPPAPI::add_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add ) {
+    if( !on_worker() ) {
+        logger->logInfo() << LOGS::VPP << 
+            "Set up PPPoE session " << session_id << ": " << 
+            mac << " " << boost::asio::ip::address_v4( ip_address ).to_string() << 
+            " vrf: " << ( vrf.empty() ? "global" : vrf.str() ) <<
+            " action: " << ( is_add ? "add" : "del" ) << std::endl;
+        return call( __func__, [ & ]() { return add_pppoe_session( ip_address, session_id, mac, vrf, is_add ); } );
+    }
+    vapi::Pppoe_add_del_session pppoe( con );
+
+    uint32_t vrf_id;
+    if( !resolve_vrf( vrf, vrf_id ) ) {
+        return { false, 0 };
+    }
+    fill_pppoe_session( pppoe, ip_address, session_id, mac, vrf_id, is_add );
     
     auto ret = pppoe.execute();
     if( ret != VAPI_OK ) {
@@ -120,6 +347,9 @@ std::tuple<bool,uint32_t> VPPAPI::add_pppoe_session( uint32_t ip_address, uint16
 }
 
 std::tuple<bool,int32_t> VPPAPI::add_subif( int32_t interface, uint16_t unit, uint16_t outer_vlan, uint16_t inner_vlan ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return add_subif( interface, unit, outer_vlan, inner_vlan ); } );
+    }
     vapi::Create_subif subif{ con };
 
     auto &req = subif.get_request().get_payload();
@@ -151,19 +381,29 @@ std::tuple<bool,int32_t> VPPAPI::add_subif( int32_t interface, uint16_t unit, ui
         return { false, 0 };
     }
 
+    // VPP names subinterfaces as <parent>.<sub_id>, no need to dump them
+    if( auto const &it = ifaces.find( interface ); it != ifaces.end() ) {
+        VPPInterface iface = it->second;
+        iface.name += "." + std::to_string( unit );
+        iface.sw_if_index = repl.sw_if_index;
+        iface.type = IfaceType::SUBIF;
+        cache_iface( iface );
+    }
+
     return { true, uint32_t{ repl.sw_if_index } };
 }
 
-bool VPPAPI::set_interface_table( int32_t ifi, const std::string &vrf ) {
+bool VPPAPI::set_interface_table( int32_t ifi, const InternedString &vrf ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return set_interface_table( ifi, vrf ); } );
+    }
     vapi::Sw_interface_set_table set_table{ con };
 
     auto &req = set_table.get_request().get_payload();
     req.sw_if_index = ifi;
     req.is_ipv6 = false;
 
-    if( auto const &it = vrfs.find( vrf ); it != vrfs.end() ) {
-        req.vrf_id = it->second;
-    } else {
+    if( !resolve_vrf( vrf, req.vrf_id ) ) {
         req.vrf_id = 0;
     }
     
@@ -186,6 +426,9 @@ bool VPPAPI::set_interface_table( int32_t ifi, const std::string &vrf ) {
 }
 
 std::tuple<bool,uint32_t> VPPAPI::create_tap( const std::string &host_name ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return create_tap( host_name ); } );
+    }
     try {
         vapi::Tap_create_v2 tap{ con };
 
@@ -242,6 +485,9 @@ std::tuple<bool,uint32_t> VPPAPI::create_tap( const std::string &host_name ) {
 }
 
 bool VPPAPI::delete_tap( uint32_t id ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return delete_tap( id ); } );
+    }
     // Check if the message ID is available before using it
     if( vapi_msg_id_tap_delete_v2 == 0 ) {
         logger->logError() << LOGS::VPP << "Tap_delete_v2 message ID not initialized" << std::endl;
@@ -278,6 +524,9 @@ bool VPPAPI::delete_tap( uint32_t id ) {
 }
 
 std::set<uint32_t> VPPAPI::get_tap_interfaces() {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return get_tap_interfaces(); } );
+    }
     std::set<uint32_t> output;
     
     try {
@@ -308,6 +557,19 @@ std::set<uint32_t> VPPAPI::get_tap_interfaces() {
 }
 
 std::vector<VPPInterface> VPPAPI::get_ifaces() {
+    auto dumped = call( __func__, [ this ]() { return dump_ifaces(); } );
+    if( !dumped ) {
+        return {};
+    }
+    cache_ifaces( *dumped );
+    return std::move( *dumped );
+}
+
+// Runs on the worker and leaves the interface table to the event loop, so it can go without blocking it
+std::optional<std::vector<VPPInterface>> VPPAPI::dump_ifaces() {
+    if( !alive ) {
+        return std::nullopt;
+    }
     std::vector<VPPInterface> output;
     vapi::Sw_interface_dump dump{ con };
 
@@ -315,7 +577,7 @@ std::vector<VPPInterface> VPPAPI::get_ifaces() {
 
     auto ret = dump.execute();
     if( ret != VAPI_OK ) {
-        logger->logError() << LOGS::VPP << "Error on executing Sw_interface_dump api method" << std::endl;
+        log_async( LOGL::ERROR, "Error on executing Sw_interface_dump api method" );
     }
 
     do {
@@ -345,14 +607,26 @@ std::vector<VPPInterface> VPPAPI::get_ifaces() {
             new_iface.type = IfaceType::SUBIF;
         }
 
-        logger->logDebug() << LOGS::VPP << "Dumped interface: " << new_iface << std::endl;
         output.push_back( std::move( new_iface ) );
     }
 
     return output;
 }
 
+void VPPAPI::cache_ifaces( const std::vector<VPPInterface> &dumped ) {
+    ifaces.clear();
+    iface_names.clear();
+    last_iface_dump = std::chrono::steady_clock::now();
+    for( auto const &iface: dumped ) {
+        logger->logDebug() << LOGS::VPP << "Dumped interface: " << iface << std::endl;
+        cache_iface( iface );
+    }
+}
+
 bool VPPAPI::set_ip( uint32_t id, network_v4_t address, bool is_add ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return set_ip( id, address, is_add ); } );
+    }
     vapi::Sw_interface_add_del_address setaddr{ con };
 
     auto &req = setaddr.get_request().get_payload();
@@ -380,6 +654,9 @@ bool VPPAPI::set_ip( uint32_t id, network_v4_t address, bool is_add ) {
 }
 
 std::vector<VPPIP> VPPAPI::dump_ip( uint32_t id ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return dump_ip( id ); } );
+    }
     std::vector<VPPIP> output;
     vapi::Ip_address_dump dumpaddr{ con };
 
@@ -410,6 +687,9 @@ std::vector<VPPIP> VPPAPI::dump_ip( uint32_t id ) {
 }
 
 std::vector<VPPUnnumbered> VPPAPI::dump_unnumbered( uint32_t id ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return dump_unnumbered( id ); } );
+    }
     std::vector<VPPUnnumbered> output;
     vapi::Ip_unnumbered_dump dump_unn{ con };
 
@@ -438,6 +718,9 @@ std::vector<VPPUnnumbered> VPPAPI::dump_unnumbered( uint32_t id ) {
 }
 
 bool VPPAPI::set_state( uint32_t ifi, bool admin_state ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return set_state( ifi, admin_state ); } );
+    }
     vapi::Sw_interface_set_flags setstate{ con };
 
     auto &req = setstate.get_request().get_payload();
@@ -465,69 +748,86 @@ bool VPPAPI::set_state( uint32_t ifi, bool admin_state ) {
     return true;
 }
 
-bool VPPAPI::setup_interfaces( std::vector<InterfaceConf> ifaces ) {
-    auto vpp_ifs { get_ifaces() };
+std::tuple<uint32_t,bool> VPPAPI::get_iface_by_name( const std::string &name ) {
+    if( auto const &it = iface_names.find( name ); it != iface_names.end() ) {
+        return { it->second, true };
+    }
+    // Interfaces created outside of us don't generate events, refresh the table but not too often
+    if( std::chrono::steady_clock::now() - last_iface_dump < std::chrono::seconds( 1 ) ) {
+        return { 0, false };
+    }
+    get_ifaces();
+    if( auto const &it = iface_names.find( name ); it != iface_names.end() ) {
+        return { it->second, true };
+    }
+    return { 0, false };
+}
 
-    for( auto &iface: ifaces ) {
-        auto find_lambda = [ &, iface ]( const VPPInterface &vpp_if ) -> bool {
-            if( iface.device == vpp_if.name ) {
-                return true;
-            }
-            return false;
-        };
-        auto if_it = std::find_if( vpp_ifs.begin(), vpp_ifs.end(), find_lambda );                    
-        if( if_it == vpp_ifs.end() ) {
-            logger->logError() << LOGS::VPP << "Cannot find interface with device: " << iface.device << std::endl;
-            continue;
-        }
-        auto const &vppif = *if_it;
-        // Actual configuration process
-        set_state( vppif.sw_if_index, iface.admin_state );
-        if( iface.mtu.has_value() ) {
-            set_mtu( vppif.sw_if_index, iface.mtu.value() );
-        }
-        for( auto &[ id, unit ]: iface.units ) {
-            if( auto [ ret, ifi ] = add_subif( vppif.sw_if_index, id, unit.vlan, 0 ); !ret ) {
-                logger->logError() << LOGS::VPP << "Cannot create unit: " << iface.device << "." << id << std::endl;
-                continue;
-            } else {
-                unit.sw_if_index = ifi;
-            }
-            if( !set_state( unit.sw_if_index, unit.admin_state ) ) {
-                logger->logError() << LOGS::VPP << "Cannot set admin state to interface: " << iface.device << "." << id << std::endl;
-            }
-            if( !unit.vrf.empty() ) {
-                if( !set_interface_table( unit.sw_if_index, unit.vrf ) ) {
-                    logger->logError() << LOGS::VPP << "Cannot move interface: " << iface.device << "." << id << "to VRF " << unit.vrf << std::endl;
-                }
-            }
-            if( unit.address ) {
-                if( !set_ip( unit.sw_if_index, *unit.address ) ) {
-                    logger->logError() << LOGS::VPP << "Cannot set IP on interface: " << iface.device << "." << id << std::endl;
-                }
+void VPPAPI::get_iface_by_name_async( const std::string &name, vpp_ifindex_cb callback ) {
+    if( auto const &it = iface_names.find( name ); it != iface_names.end() ) {
+        boost::asio::post( io, std::bind( std::move( callback ), true, it->second ) );
+        return;
+    }
+    // Lookups missing the table meanwhile wait for the dump already running
+    if( !iface_lookups.empty() ) {
+        iface_lookups.emplace_back( name, std::move( callback ) );
+        return;
+    }
+    if( std::chrono::steady_clock::now() - last_iface_dump < std::chrono::seconds( 1 ) ) {
+        boost::asio::post( io, std::bind( std::move( callback ), false, 0 ) );
+        return;
+    }
+    iface_lookups.emplace_back( name, std::move( callback ) );
+    submit( [ this, started = std::chrono::steady_clock::now() ]() {
+        boost::asio::post( io, [ this, started, dumped = dump_ifaces() ]() {
+            record( "get_ifaces", started );
+            if( dumped ) {
+                cache_ifaces( *dumped );
             }
-            if( !unit.unnumbered.empty() ) {
-                if( auto [ ip_iface, success ] = get_iface_by_name( unit.unnumbered ); success ) {
-                    set_unnumbered( unit.sw_if_index, ip_iface );
-                } else {
-                    logger->logError() << LOGS::VPP << "Cannot set unnumbered on wan (it's not found) to unit: " << iface.device << "." << id << std::endl;
-                }
+            auto lookups = std::move( iface_lookups );
+            iface_lookups.clear();
+            for( auto &[ name, callback ]: lookups ) {
+                auto const &it = iface_names.find( name );
+                callback( it != iface_names.end(), it != iface_names.end() ? it->second : 0 );
             }
-        }
+        });
+    });
+}
+
+void VPPAPI::cache_iface( const VPPInterface &iface ) {
+    if( auto const &it = ifaces.find( iface.sw_if_index ); it != ifaces.end() ) {
+        iface_names.erase( it->second.name );
     }
-    return true;
+    ifaces[ iface.sw_if_index ] = iface;
+    iface_names[ iface.name ] = iface.sw_if_index;
 }
 
-std::tuple<uint32_t,bool> VPPAPI::get_iface_by_name( const std::string &name ) {
-    for( auto const &iface: get_ifaces() ) {
-        if( iface.name == name ) {
-            return { iface.sw_if_index, true };
+void VPPAPI::uncache_iface( uint32_t sw_if_index ) {
+    if( auto const &it = ifaces.find( sw_if_index ); it != ifaces.end() ) {
+        iface_names.erase( it->second.name );
+        ifaces.erase( it );
+    }
+}
+
+vapi_error_e VPPAPI::on_iface_event( vapi::Sw_interface_event_registration &reg ) {
+    auto &events = reg.get_result_set();
+    for( auto &el: events ) {
+        auto const &ev = el.get_payload();
+        if( ev.deleted ) {
+            boost::asio::post( io, [ this, sw_if_index = ev.sw_if_index ]() {
+                logger->logDebug() << LOGS::VPP << "Interface " << sw_if_index << " was deleted" << std::endl;
+                uncache_iface( sw_if_index );
+            });
         }
     }
-    return { 0, false };
+    events.free_all_responses();
+    return VAPI_OK;
 }
 
 bool VPPAPI::set_mtu( uint32_t ifi, uint16_t mtu ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return set_mtu( ifi, mtu ); } );
+    }
     vapi::Sw_interface_set_mtu setmtu{ con };
 
     auto &req = setmtu.get_request().get_payload();
@@ -555,6 +855,9 @@ bool VPPAPI::set_mtu( uint32_t ifi, uint16_t mtu ) {
 }
 
 bool VPPAPI::set_unnumbered( uint32_t unnumbered, uint32_t iface, bool is_add ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return set_unnumbered( unnumbered, iface, is_add ); } );
+    }
     vapi::Sw_interface_set_unnumbered unn { con };
 
     auto &req = unn.get_request().get_payload();
@@ -581,6 +884,9 @@ bool VPPAPI::set_unnumbered( uint32_t unnumbered, uint32_t iface, bool is_add )
 
 
 std::tuple<bool,int32_t> VPPAPI::add_route( const network_v4_t &prefix, const address_v4_t &nexthop, uint32_t table_id ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return add_route( prefix, nexthop, table_id ); } );
+    }
     vapi::Ip_route_add_del route { con, 0 };
 
     auto &req = route.get_request().get_payload();
@@ -615,6 +921,9 @@ std::tuple<bool,int32_t> VPPAPI::add_route( const network_v4_t &prefix, const ad
 }
 
 bool VPPAPI::del_subif( int32_t sw_if_index ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return del_subif( sw_if_index ); } );
+    }
     vapi::Delete_subif del_subif{ con };
 
     auto &req = del_subif.get_request().get_payload();
@@ -634,10 +943,14 @@ bool VPPAPI::del_subif( int32_t sw_if_index ) {
         return false;
     }
 
+    uncache_iface( sw_if_index );
     return true;
 }
 
 std::vector<VPP_PPPOE_Session> VPPAPI::dump_pppoe_sessions() {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return dump_pppoe_sessions(); } );
+    }
     std::vector<VPP_PPPOE_Session> output;
     vapi::Pppoe_session_dump dump{ con };
 
@@ -673,31 +986,38 @@ std::vector<VPP_PPPOE_Session> VPPAPI::dump_pppoe_sessions() {
     return output;
 }
 
-void VPPAPI::get_stats( uint32_t sw_if_index ) {
-    vapi::Want_interface_events get_stats{ con };
+bool VPPAPI::want_interface_events( bool enable ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return want_interface_events( enable ); } );
+    }
+    vapi::Want_interface_events events{ con };
 
-    auto &req = get_stats.get_request().get_payload();
-    req.enable_disable = 1;
+    auto &req = events.get_request().get_payload();
+    req.enable_disable = enable ? 1 : 0;
     req.pid = getpid();
     
-    auto ret = get_stats.execute();
+    auto ret = events.execute();
     if( ret != VAPI_OK ) {
-        logger->logError() << LOGS::VPP << "Error on executing Collect_detailed_interface_stats api method" << std::endl;
+        log_async( LOGL::ERROR, "Error on executing Want_interface_events api method" );
+        return false;
     }
 
     do {
-        ret = con.wait_for_response( get_stats );
+        ret = con.wait_for_response( events );
     } while( ret == VAPI_EAGAIN );
 
-    auto repl = get_stats.get_response().get_payload();
+    auto repl = events.get_response().get_payload();
     if( repl.retval < 0 ) {
-        return ;
+        return false;
     }
 
-    return ;
+    return true;
 }
 
 bool VPPAPI::add_pppoe_cp( uint32_t sw_if_index, bool to_del ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return add_pppoe_cp( sw_if_index, to_del ); } );
+    }
     vapi::Pppoe_add_del_cp set_cp_iface{ con };
 
     auto &req = set_cp_iface.get_request().get_payload();
@@ -721,78 +1041,123 @@ bool VPPAPI::add_pppoe_cp( uint32_t sw_if_index, bool to_del ) {
     return true;
 }
 
-void VPPAPI::collect_counters() {
-    logger->logDebug() << LOGS::VPP << "Trying to get stats" << std::endl;
-    auto client = stat_client_get();
-    stat_segment_connect_r( STAT_SEGMENT_SOCKET_FILE, client );
-    auto ls = stat_segment_ls_r( nullptr, client );
-    for( int i = 0; i < stat_segment_vec_len( ls ); i++ ) {
-        auto stat = stat_segment_dump_entry_r( ls[ i ], client );
-        if( ! ( strcmp( stat->name, "/if/drops" ) == 0 ||
-            strcmp( stat->name, "/if/tx" ) == 0 ||
-            strcmp( stat->name, "/if/rx" ) == 0 ) ) {
-                stat_segment_data_free( stat );
-                continue;
-        }
-        logger->logDebug() << LOGS::VPP << stat->name << std::endl;
-        
-        switch( stat->type ) {
-        case stat_directory_type_t::STAT_DIR_TYPE_NAME_VECTOR:
-        {
-            auto vec_size = stat_segment_vec_len( stat->name_vector );
-            for( int j = 0; j < vec_size; j++ ) {
-                // logger->logInfo() << LOGS::VPP << (char*)stat->name_vector[j] << std::endl;
-            }
-            break;
+static void sum_simple( counter_t **vec, std::vector<uint64_t> &out ) {
+    for( int j = 0; j < stat_segment_vec_len( vec ); j++ ) {
+        size_t len = stat_segment_vec_len( vec[ j ] );
+        if( out.size() < len ) {
+            out.resize( len );
         }
-        case stat_directory_type_t::STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
-        {
-            auto vec_size = stat_segment_vec_len( stat->simple_counter_vec );
-            for( int j = 0; j < vec_size; j++ ) {
-                for( int k = 0; k < stat_segment_vec_len( stat->simple_counter_vec[j] ); k++ ) {
-                    auto cIt = counters.find( k );
-                    if( cIt == counters.end() ) {
-                        counters.emplace( std::piecewise_construct, std::forward_as_tuple( k ), std::forward_as_tuple() );
-                        cIt = counters.find( k );
-                    }
-                    if( strcmp( stat->name, "/if/drops" ) == 0 ) {
-                        auto &counters = cIt->second;
-                        counters.drops = stat->simple_counter_vec[j][k];
-                    }
-                }
-            }
-            break;
+        const counter_t *in = vec[ j ];
+        uint64_t *sum = out.data();
+        for( size_t k = 0; k < len; k++ ) {
+            sum[ k ] += in[ k ];
         }
-        case stat_directory_type_t::STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
-        {
-            auto vec_size = stat_segment_vec_len( stat->combined_counter_vec );
-            for( int j = 0; j < vec_size; j++ ) {
-                for( int k = 0; k < stat_segment_vec_len( stat->simple_counter_vec[j] ); k++ ) {
-                    auto cIt = counters.find( k );
-                    if( cIt == counters.end() ) {
-                        counters.emplace( std::piecewise_construct, std::forward_as_tuple( k ), std::forward_as_tuple() );
-                        cIt = counters.find( k );
-                    }
-                    auto &counters = cIt->second;
-                    if( strcmp( stat->name, "/if/tx" ) == 0 ) {
-                        counters.txBytes = stat->combined_counter_vec[j][k].bytes;
-                        counters.txPkts = stat->combined_counter_vec[j][k].packets;
-                    } else if( strcmp( stat->name, "/if/rx" ) == 0 ) {
-                        counters.rxBytes = stat->combined_counter_vec[j][k].bytes;
-                        counters.rxPkts = stat->combined_counter_vec[j][k].packets;
-                    }
-                }
-            }
-            break;
+    }
+}
+
+static void sum_combined( vlib_counter_t **vec, std::vector<uint64_t> &pkts, std::vector<uint64_t> &bytes ) {
+    for( int j = 0; j < stat_segment_vec_len( vec ); j++ ) {
+        size_t len = stat_segment_vec_len( vec[ j ] );
+        if( pkts.size() < len ) {
+            pkts.resize( len );
+            bytes.resize( len );
+        }
+        const vlib_counter_t *in = vec[ j ];
+        uint64_t *p = pkts.data();
+        uint64_t *b = bytes.data();
+        for( size_t k = 0; k < len; k++ ) {
+            p[ k ] += in[ k ].packets;
+            b[ k ] += in[ k ].bytes;
+        }
+    }
+}
+
+bool VPPAPI::resolve_counters() {
+    if( stat_client == nullptr ) {
+        stat_client = stat_client_get();
+        if( stat_segment_connect_r( STAT_SEGMENT_SOCKET_FILE, stat_client ) != 0 ) {
+            log_async( LOGL::ERROR, "Cannot connect to VPP stats segment" );
+            stat_client_free( stat_client );
+            stat_client = nullptr;
+            return false;
+        }
+    }
+    if( stat_dirs != nullptr ) {
+        stat_segment_vec_free( stat_dirs );
+        stat_dirs = nullptr;
+    }
+
+    uint8_t **patterns = nullptr;
+    patterns = stat_segment_string_vector( patterns, "^/if/rx$" );
+    patterns = stat_segment_string_vector( patterns, "^/if/tx$" );
+    patterns = stat_segment_string_vector( patterns, "^/if/drops$" );
+    stat_dirs = stat_segment_ls_r( patterns, stat_client );
+    for( int i = 0; i < stat_segment_vec_len( patterns ); i++ ) {
+        stat_segment_vec_free( patterns[ i ] );
+    }
+    stat_segment_vec_free( patterns );
+
+    log_async( LOGL::DEBUG, "Resolved " + std::to_string( stat_segment_vec_len( stat_dirs ) ) + " interface stat directories" );
+    return stat_dirs != nullptr;
+}
+
+void VPPAPI::close_stats() {
+    if( stat_dirs != nullptr ) {
+        stat_segment_vec_free( stat_dirs );
+        stat_dirs = nullptr;
+    }
+    if( stat_client != nullptr ) {
+        stat_segment_disconnect_r( stat_client );
+        stat_client_free( stat_client );
+        stat_client = nullptr;
+    }
+}
+
+void VPPAPI::collect_counters() {
+    if( stat_dirs == nullptr && !resolve_counters() ) {
+        return;
+    }
+    auto stats = stat_segment_dump_r( stat_dirs, stat_client );
+    if( stats == nullptr ) {
+        // Stat directory was changed (epoch bump) or VPP was restarted: look the entries up again
+        if( !resolve_counters() || ( stats = stat_segment_dump_r( stat_dirs, stat_client ) ) == nullptr ) {
+            log_async( LOGL::ERROR, "Cannot dump interface counters, reconnecting to stats segment" );
+            close_stats();
+            return;
         }
+    }
+
+    std::vector<uint64_t> rxPkts, rxBytes, txPkts, txBytes, drops;
+    for( int i = 0; i < stat_segment_vec_len( stats ); i++ ) {
+        auto const &stat = stats[ i ];
+        if( stat.type == STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED && strcmp( stat.name, "/if/rx" ) == 0 ) {
+            sum_combined( stat.combined_counter_vec, rxPkts, rxBytes );
+        } else if( stat.type == STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED && strcmp( stat.name, "/if/tx" ) == 0 ) {
+            sum_combined( stat.combined_counter_vec, txPkts, txBytes );
+        } else if( stat.type == STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE && strcmp( stat.name, "/if/drops" ) == 0 ) {
+            sum_simple( stat.simple_counter_vec, drops );
         }
-        stat_segment_data_free( stat );
     }
-    stat_segment_vec_free( ls );
-    stat_client_free( client );
+    stat_segment_data_free( stats );
+
+    auto len = std::max( { rxPkts.size(), txPkts.size(), drops.size() } );
+    rxPkts.resize( len ); rxBytes.resize( len );
+    txPkts.resize( len ); txBytes.resize( len );
+    drops.resize( len );
+
+    std::vector<VPPIfaceCounters> collected( len );
+    for( size_t k = 0; k < len; k++ ) {
+        collected[ k ] = { rxPkts[ k ], rxBytes[ k ], txPkts[ k ], txBytes[ k ], drops[ k ] };
+    }
+    boost::asio::post( io, [ this, collected = std::move( collected ) ]() mutable {
+        counters = std::move( collected );
+    });
 }
 
 bool VPPAPI::set_vrf( const std::string &name, uint32_t id, bool is_add ) {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return set_vrf( name, id, is_add ); } );
+    }
     vapi::Ip_table_add_del table { con };
 
     auto &req = table.get_request().get_payload();
@@ -821,11 +1186,15 @@ bool VPPAPI::set_vrf( const std::string &name, uint32_t id, bool is_add ) {
     }
 
     vrfs.emplace( name, id );
+    vrf_generation = InternedString::newGeneration();
 
     return true;
 }
 
 std::vector<VPPVRF> VPPAPI::dump_vrfs() {
+    if( !on_worker() ) {
+        return call( __func__, [ & ]() { return dump_vrfs(); } );
+    }
     std::vector<VPPVRF> output;
     vapi::Ip_table_dump dump { con };
 
@@ -850,9 +1219,191 @@ std::vector<VPPVRF> VPPAPI::dump_vrfs() {
 }
 
 std::tuple<bool,VPPIfaceCounters> VPPAPI::get_counters_by_index( uint32_t ifindex ) {
-    auto it = counters.find( ifindex );
-    if( it == counters.end() ) {
+    if( ifindex >= counters.size() ) {
         return { false, {} };
     }
-    return { true, it->second };
-}
\ No newline at end of file
+    return { true, counters[ ifindex ] };
+}
+
+template<typename MSG>
+void VPPAPI::execute_async( const char *name, std::function<void(MSG&)> fill, std::function<std::function<void()>(MSG&)> on_reply, std::function<void()> on_fail ) {
+    auto started = std::chrono::steady_clock::now();
+    // Completions run on the event loop, so is the accounting
+    auto fail = [ this, name, started, on_fail = std::move( on_fail ) ]() {
+        outstanding--;
+        record( name, started );
+        on_fail();
+    };
+    outstanding++;
+    if( !alive ) {
+        boost::asio::post( io, std::move( fail ) );
+        return;
+    }
+    submit( [ this, name, started, fill = std::move( fill ), on_reply = std::move( on_reply ), fail = std::move( fail ) ]() mutable {
+        if( !alive ) {
+            boost::asio::post( io, std::move( fail ) );
+            return;
+        }
+        auto msg = std::make_shared<MSG>( con, [ this, name, started, on_reply = std::move( on_reply ) ]( MSG &m ) -> vapi_error_e {
+            boost::asio::post( io, [ this, name, started, done = on_reply( m ) ]() {
+                outstanding--;
+                record( name, started );
+                done();
+            });
+            retire( &m );
+            return VAPI_OK;
+        });
+        fill( *msg );
+
+        auto send = [ msg ]() -> vapi_error_e {
+            return msg->execute();
+        };
+        pending.push_back( { msg, std::move( send ), std::move( fail ) } );
+        pump();
+    });
+}
+
+void VPPAPI::retire( const void *msg ) {
+    if( auto const &it = inflight.find( msg ); it != inflight.end() ) {
+        // VAPI still touches the request after the callback, so free it after dispatch
+        completed.push_back( std::move( it->second.msg ) );
+        inflight.erase( it );
+    }
+}
+
+void VPPAPI::pump() {
+    while( !pending.empty() && inflight.size() < VPP_MAX_INFLIGHT ) {
+        auto &req = pending.front();
+        auto ret = req.send();
+        if( ret == VAPI_EAGAIN ) {
+            // VAPI queue is full, try again after next dispatch
+            break;
+        }
+        if( ret == VAPI_OK ) {
+            auto ptr = req.msg.get();
+            inflight.emplace( ptr, std::move( req ) );
+        } else {
+            log_async( LOGL::ERROR, "Cannot execute async api method: " + std::to_string( ret ) );
+            boost::asio::post( io, std::move( req.fail ) );
+        }
+        pending.pop_front();
+    }
+    arm_dispatch();
+}
+
+void VPPAPI::arm_dispatch() {
+    if( dispatch_armed ) {
+        return;
+    }
+    // Interface events may come at any time, but we can wait for them only on fd
+    bool events = iface_events && vapi_fd;
+    if( inflight.empty() && pending.empty() && !events ) {
+        return;
+    }
+    dispatch_armed = true;
+    if( vapi_fd ) {
+        vapi_fd->async_wait( boost::asio::posix::stream_descriptor::wait_read, std::bind( &VPPAPI::on_dispatch, this, std::placeholders::_1 ) );
+    } else {
+        dispatch_timer.expires_after( std::chrono::milliseconds( 1 ) );
+        dispatch_timer.async_wait( std::bind( &VPPAPI::on_dispatch, this, std::placeholders::_1 ) );
+    }
+}
+
+void VPPAPI::on_dispatch( boost::system::error_code ec ) {
+    dispatch_armed = false;
+    if( ec ) {
+        if( ec != boost::asio::error::operation_aborted ) {
+            log_async( LOGL::ERROR, "Error on waiting for VPP API replies: " + ec.message() );
+        }
+        return;
+    }
+    // Zero timeout: take only what is already queued, never block the loop
+    if( auto ret = con.dispatch( nullptr, 0 ); ret != VAPI_OK && ret != VAPI_EAGAIN ) {
+        log_async( LOGL::ERROR, "Error on dispatching VPP API replies: " + std::to_string( ret ) );
+        // Check the connection right away instead of spinning on a broken fd
+        timer.expires_after( std::chrono::seconds( 0 ) );
+        timer.async_wait( std::bind( &VPPAPI::process_msgs, this, std::placeholders::_1 ) );
+        return;
+    }
+    completed.clear();
+    pump();
+}
+
+void VPPAPI::drain() {
+    while( !pending.empty() || !inflight.empty() ) {
+        pump();
+        if( inflight.empty() ) {
+            break;
+        }
+        if( auto ret = con.dispatch( nullptr, 1 ); ret != VAPI_OK && ret != VAPI_EAGAIN ) {
+            logger->logError() << LOGS::VPP << "Cannot drain VPP API requests: " << ret << std::endl;
+            break;
+        }
+        completed.clear();
+    }
+    completed.clear();
+}
+
+size_t VPPAPI::inflight_requests() const {
+    return outstanding;
+}
+
+void VPPAPI::add_pppoe_session_async( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add, vpp_ifindex_cb callback ) {
+    uint32_t vrf_id;
+    if( !resolve_vrf( vrf, vrf_id ) ) {
+        boost::asio::post( io, std::bind( callback, false, 0 ) );
+        return;
+    }
+    logger->logInfo() << LOGS::VPP << 
+        "Set up PPPoE session " << session_id << ": " << 
+        mac << " " << boost::asio::ip::address_v4( ip_address ).to_string() << 
+        " vrf: " << ( vrf.empty() ? "global" : vrf.str() ) <<
+        " action: " << ( is_add ? "add" : "del" ) << std::endl;
+    execute_async<vapi::Pppoe_add_del_session>( "add_pppoe_session_async",
+        [ this, ip_address, session_id, mac, vrf_id, is_add ]( vapi::Pppoe_add_del_session &pppoe ) {
+            fill_pppoe_session( pppoe, ip_address, session_id, mac, vrf_id, is_add );
+        },
+        [ callback ]( vapi::Pppoe_add_del_session &pppoe ) -> std::function<void()> {
+            auto const &repl = pppoe.get_response().get_payload();
+            bool success = repl.retval == 0 && static_cast<int>( repl.sw_if_index ) != -1;
+            return std::bind( callback, success, uint32_t{ repl.sw_if_index } );
+        },
+        std::bind( callback, false, 0 )
+    );
+}
+
+void VPPAPI::set_interface_table_async( int32_t ifi, const InternedString &vrf, vpp_result_cb callback ) {
+    uint32_t vrf_id = 0;
+    if( !resolve_vrf( vrf, vrf_id ) ) {
+        vrf_id = 0;
+    }
+    execute_async<vapi::Sw_interface_set_table>( "set_interface_table_async",
+        [ ifi, vrf_id ]( vapi::Sw_interface_set_table &set_table ) {
+            auto &req = set_table.get_request().get_payload();
+            req.sw_if_index = ifi;
+            req.is_ipv6 = false;
+            req.vrf_id = vrf_id;
+        },
+        [ callback ]( vapi::Sw_interface_set_table &set_table ) -> std::function<void()> {
+            auto const &repl = set_table.get_response().get_payload();
+            return std::bind( callback, repl.retval == 0 );
+        },
+        std::bind( callback, false )
+    );
+}
+
+void VPPAPI::set_unnumbered_async( uint32_t unnumbered, uint32_t iface, bool is_add, vpp_result_cb callback ) {
+    execute_async<vapi::Sw_interface_set_unnumbered>( "set_unnumbered_async",
+        [ unnumbered, iface, is_add ]( vapi::Sw_interface_set_unnumbered &unn ) {
+            auto &req = unn.get_request().get_payload();
+            req.is_add = is_add ? 1 : 0;
+            req.sw_if_index = iface;
+            req.unnumbered_sw_if_index = unnumbered;
+        },
+        [ callback ]( vapi::Sw_interface_set_unnumbered &unn ) -> std::function<void()> {
+            auto const &repl = unn.get_response().get_payload();
+            return std::bind( callback, repl.retval == 0 );
+        },
+        std::bind( callback, false )
+    );
+}
@@ -11,70 +11,153 @@
 #include "vapi/ip.api.vapi.hpp"
 #include "vapi/memclnt.api.vapi.hpp"
 
-#include "config.hpp"
-
-struct InterfaceConf;
-enum class IfaceType: uint8_t;
-struct VPPInterface;
-struct VPP_PPPOE_Session;
-struct VPPIfaceCounters;
-struct VPPVRF;
-struct VPPIP;
-struct VPPUnnumbered;
-
-class VPPAPI {
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+extern "C" {
+    #include "vpp-api/client/stat_client.h"
+}
+
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <optional>
+
+#include "dp_backend.hpp"
+#include "mpsc_queue.hpp"
+
+class VPPAPI: public DPBackend {
 public:
     VPPAPI( boost::asio::io_context &io, std::unique_ptr<Logger> &l );
     ~VPPAPI();
 
     // Interface dump methods
-    std::set<uint32_t> get_tap_interfaces();
-    std::vector<VPPInterface> get_ifaces();
-    std::tuple<uint32_t,bool> get_iface_by_name( const std::string &name );
-    void get_stats( uint32_t sw_if_index );
+    std::set<uint32_t> get_tap_interfaces() override;
+    std::vector<VPPInterface> get_ifaces() override;
+    std::tuple<uint32_t,bool> get_iface_by_name( const std::string &name ) override;
+    bool want_interface_events( bool enable = true );
 
     // Subif
-    std::tuple<bool,int32_t> add_subif( int32_t interface, uint16_t unit, uint16_t outer_vlan, uint16_t inner_vlan );
-    bool del_subif( int32_t sw_if_index );
+    std::tuple<bool,int32_t> add_subif( int32_t interface, uint16_t unit, uint16_t outer_vlan, uint16_t inner_vlan ) override;
+    bool del_subif( int32_t sw_if_index ) override;
 
     // Tap
-    std::tuple<bool,uint32_t> create_tap( const std::string &host_name );
-    bool delete_tap( uint32_t id );
+    std::tuple<bool,uint32_t> create_tap( const std::string &host_name ) override;
+    bool delete_tap( uint32_t id ) override;
 
     // Interface configuration
-    bool setup_interfaces( std::vector<InterfaceConf> ifaces );
-    bool set_ip( uint32_t id, network_v4_t address, bool is_add = true );
-    bool set_state( uint32_t ifi, bool admin_state );
-    bool set_mtu( uint32_t ifi, uint16_t mtu );
-    bool set_unnumbered( uint32_t unnumbered, uint32_t iface, bool is_add = true );
-    bool set_interface_table( int32_t ifi, const std::string &vrf );
-    std::vector<VPPIP> dump_ip( uint32_t id );
-    std::vector<VPPUnnumbered> dump_unnumbered( uint32_t id );
+    bool set_ip( uint32_t id, network_v4_t address, bool is_add = true ) override;
+    bool set_state( uint32_t ifi, bool admin_state ) override;
+    bool set_mtu( uint32_t ifi, uint16_t mtu ) override;
+    bool set_unnumbered( uint32_t unnumbered, uint32_t iface, bool is_add = true ) override;
+    bool set_interface_table( int32_t ifi, const InternedString &vrf ) override;
+    std::vector<VPPIP> dump_ip( uint32_t id ) override;
+    std::vector<VPPUnnumbered> dump_unnumbered( uint32_t id ) override;
 
     // Route methods
-    std::tuple<bool,int32_t> add_route( const network_v4_t &prefix, const address_v4_t &nexthop, uint32_t table_id );
+    std::tuple<bool,int32_t> add_route( const network_v4_t &prefix, const address_v4_t &nexthop, uint32_t table_id ) override;
 
     // PPPoE methods
-    std::tuple<bool,uint32_t> add_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const std::string &vrf, bool is_add = true );
-    bool add_pppoe_cp( uint32_t sw_if_index, bool to_del = false );
-    std::vector<VPP_PPPOE_Session> dump_pppoe_sessions();
+    std::tuple<bool,uint32_t> add_pppoe_session( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add = true ) override;
+    bool add_pppoe_cp( uint32_t sw_if_index, bool to_del = false ) override;
+    std::vector<VPP_PPPOE_Session> dump_pppoe_sessions() override;
 
     // VRF methods
-    bool set_vrf( const std::string &name, uint32_t id, bool is_add = true );
-    std::vector<VPPVRF> dump_vrfs();
+    bool set_vrf( const std::string &name, uint32_t id, bool is_add = true ) override;
+    std::vector<VPPVRF> dump_vrfs() override;
 
     // Stats
-    std::tuple<bool,VPPIfaceCounters> get_counters_by_index( uint32_t ifindex );
+    std::tuple<bool,VPPIfaceCounters> get_counters_by_index( uint32_t ifindex ) override;
+
+    // Async methods: requests are pipelined to VPP and callbacks are called from the event loop
+    void add_pppoe_session_async( uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, const InternedString &vrf, bool is_add, vpp_ifindex_cb callback ) override;
+    void set_interface_table_async( int32_t ifi, const InternedString &vrf, vpp_result_cb callback ) override;
+    void set_unnumbered_async( uint32_t unnumbered, uint32_t iface, bool is_add, vpp_result_cb callback ) override;
+    void get_iface_by_name_async( const std::string &name, vpp_ifindex_cb callback ) override;
+    size_t inflight_requests() const override;
+    bool connected() const override;
+    DPApiStats api_stats() const override;
 private:
+    struct AsyncRequest {
+        std::shared_ptr<void> msg;
+        std::function<vapi_error_e()> send;
+        std::function<void()> fail;
+    };
+
+    // Worker thread: owns VAPI connection, all VPP calls are executed there.
+    // Public methods run on the event loop and hand their work over as commands
+    bool on_worker() const;
+    void submit( std::function<void()> command );
+    void wait_commands();
+    void run_commands( boost::system::error_code ec );
+    template<typename F>
+    auto call( const char *name, F &&fn ) -> decltype( fn() );
+    void record( const std::string &name, std::chrono::steady_clock::time_point started );
+    void log_async( LOGL level, std::string msg );
+
+    void on_connected();
+    void connection_lost();
+    void reconnect( boost::system::error_code ec );
+    void fail_requests();
     void collect_counters();
+    bool resolve_counters();
+    void close_stats();
+    // Nothing when VPP is not connected
+    std::optional<std::vector<VPPInterface>> dump_ifaces();
+    void cache_ifaces( const std::vector<VPPInterface> &dumped );
+    void cache_iface( const VPPInterface &iface );
+    void uncache_iface( uint32_t sw_if_index );
+    vapi_error_e on_iface_event( vapi::Sw_interface_event_registration &reg );
+    void fill_pppoe_session( vapi::Pppoe_add_del_session &pppoe, uint32_t ip_address, uint16_t session_id, std::array<uint8_t,6> mac, uint32_t vrf_id, bool is_add );
+    // Table id of an interned VRF name, remembered in the name until vrfs changes
+    bool resolve_vrf( const InternedString &vrf, uint32_t &vrf_id ) const;
 
+    // on_reply is called on the worker and returns completion to run on the event loop
+    template<typename MSG>
+    void execute_async( const char *name, std::function<void(MSG&)> fill, std::function<std::function<void()>(MSG&)> on_reply, std::function<void()> on_fail );
+    void retire( const void *msg );
+    void pump();
+    void arm_dispatch();
+    void on_dispatch( boost::system::error_code ec );
+    void drain();
     void process_msgs( boost::system::error_code err );
-    boost::asio::io_context &io;
-    boost::asio::steady_timer timer;
-    std::unique_ptr<Logger> &logger;
-    std::map<uint32_t,VPPIfaceCounters> counters;
+
+    // Event loop state
+    // Interface counters indexed by sw_if_index
+    std::vector<VPPIfaceCounters> counters;
     std::map<std::string,uint32_t> vrfs;
+    uint64_t vrf_generation { InternedString::newGeneration() };
+    // Interface table, filled by a full dump and kept current by interface events
+    std::unordered_map<uint32_t,VPPInterface> ifaces;
+    std::unordered_map<std::string,uint32_t> iface_names;
+    std::chrono::steady_clock::time_point last_iface_dump;
+    // Names waiting for the interface dump on the worker
+    std::vector<std::pair<std::string,vpp_ifindex_cb>> iface_lookups;
+    size_t outstanding { 0 };
+    DPApiStats stats;
+
+    // Shared between threads
+    std::atomic_bool alive { false };
+    MPSCQueue<std::function<void()>> commands;
+    std::atomic<size_t> queued { 0 };
+    std::atomic_bool wake_pending { false };
+
+    // Worker state
+    boost::asio::io_context worker_io;
+    boost::asio::posix::stream_descriptor wake;
+    std::thread worker;
     vapi::Connection con;
+    boost::asio::steady_timer timer;
+    boost::asio::steady_timer reconnect_timer;
+    std::chrono::seconds reconnect_backoff;
+    stat_client_main_t *stat_client { nullptr };
+    uint32_t *stat_dirs { nullptr };
+    std::unique_ptr<vapi::Sw_interface_event_registration> iface_events;
+    std::deque<AsyncRequest> pending;
+    std::map<const void*,AsyncRequest> inflight;
+    std::vector<std::shared_ptr<void>> completed;
+    std::optional<boost::asio::posix::stream_descriptor> vapi_fd;
+    boost::asio::steady_timer dispatch_timer;
+    bool dispatch_armed { false };
 };
 
 #endif
\ No newline at end of file
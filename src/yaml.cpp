@@ -121,9 +121,28 @@ YAML::Node YAML::convert<AAAConf>::encode( const AAAConf &rhs ) {
     if( !rhs.local_template.empty() ) {
         node[ "local_template" ] = rhs.local_template;
     }
+    if( !rhs.local_users.empty() ) {
+        node[ "local_users" ] = rhs.local_users;
+    }
     node[ "dictionaries" ] = rhs.dictionaries;
+    if( !rhs.dictionary_cache.empty() ) {
+        node[ "dictionary_cache" ] = rhs.dictionary_cache;
+    }
     node[ "auth_servers" ] = rhs.auth_servers;
     node[ "acct_servers" ] = rhs.acct_servers;
+    node[ "server_selection" ] = rhs.server_selection;
+    node[ "dead_threshold" ] = rhs.dead_threshold;
+    node[ "dead_time" ] = rhs.dead_time;
+    node[ "interim_interval" ] = rhs.interim_interval;
+    node[ "acct_rate" ] = rhs.acct_rate;
+    if( !rhs.acct_spool.empty() ) {
+        node[ "acct_spool" ] = rhs.acct_spool;
+        node[ "acct_spool_limit" ] = rhs.acct_spool_limit;
+    }
+    if( !rhs.coa_clients.empty() ) {
+        node[ "coa_port" ] = rhs.coa_port;
+        node[ "coa_clients" ] = rhs.coa_clients;
+    }
     return node;
 }
 
@@ -133,15 +152,48 @@ bool YAML::convert<AAAConf>::decode( const YAML::Node &node, AAAConf &rhs ) {
     if( node[ "local_template" ].IsDefined() ) {
         rhs.local_template = node[ "local_template" ].as<std::string>();
     }
+    if( node[ "local_users" ].IsDefined() ) {
+        rhs.local_users = node[ "local_users" ].as<std::string>();
+    }
     if( node[ "dictionaries" ].IsDefined() ) {
         rhs.dictionaries = node[ "dictionaries" ].as<std::vector<std::string>>();
     }
+    if( node[ "dictionary_cache" ].IsDefined() ) {
+        rhs.dictionary_cache = node[ "dictionary_cache" ].as<std::string>();
+    }
     if( node[ "auth_servers" ].IsDefined() ) {
         rhs.auth_servers = node[ "auth_servers" ].as<std::map<std::string,AAARadConf>>();
     }
     if( node[ "acct_servers" ].IsDefined() ) {
         rhs.acct_servers = node[ "acct_servers" ].as<std::map<std::string,AAARadConf>>();
     }
+    if( node[ "server_selection" ].IsDefined() ) {
+        rhs.server_selection = node[ "server_selection" ].as<RADIUS_BALANCE>();
+    }
+    if( node[ "dead_threshold" ].IsDefined() ) {
+        rhs.dead_threshold = node[ "dead_threshold" ].as<uint32_t>();
+    }
+    if( node[ "dead_time" ].IsDefined() ) {
+        rhs.dead_time = node[ "dead_time" ].as<uint32_t>();
+    }
+    if( node[ "interim_interval" ].IsDefined() ) {
+        rhs.interim_interval = node[ "interim_interval" ].as<uint32_t>();
+    }
+    if( node[ "acct_rate" ].IsDefined() ) {
+        rhs.acct_rate = node[ "acct_rate" ].as<uint32_t>();
+    }
+    if( node[ "acct_spool" ].IsDefined() ) {
+        rhs.acct_spool = node[ "acct_spool" ].as<std::string>();
+    }
+    if( node[ "acct_spool_limit" ].IsDefined() ) {
+        rhs.acct_spool_limit = node[ "acct_spool_limit" ].as<uint32_t>();
+    }
+    if( node[ "coa_port" ].IsDefined() ) {
+        rhs.coa_port = node[ "coa_port" ].as<uint16_t>();
+    }
+    if( node[ "coa_clients" ].IsDefined() ) {
+        rhs.coa_clients = node[ "coa_clients" ].as<std::map<std::string,AAACoAClient>>();
+    }
     return true;
 }
 
@@ -208,6 +260,8 @@ YAML::Node YAML::convert<PPPOEGlobalConf>::encode( const PPPOEGlobalConf &rhs )
     node[ "lcp_conf" ] = rhs.lcp_conf;
     node[ "global_rib" ] = rhs.global_rib;
     node[ "vrfs" ] = rhs.vrfs;
+    node[ "vpp_conf" ] = rhs.vpp_conf;
+    node[ "admission" ] = rhs.admission;
     return node;
 }
 
@@ -233,6 +287,91 @@ bool YAML::convert<PPPOEGlobalConf>::decode( const YAML::Node &node, PPPOEGlobal
     }
     rhs.global_rib = node[ "global_rib" ].as<StaticRIB>();
     rhs.vrfs = node[ "vrfs" ].as<std::vector<VRFConf>>();
+    if( node[ "vpp_conf" ].IsDefined() ) {
+        rhs.vpp_conf = node[ "vpp_conf" ].as<VPPConf>();
+    }
+    if( node[ "admission" ].IsDefined() ) {
+        rhs.admission = node[ "admission" ].as<AdmissionConf>();
+    }
+    return true;
+}
+
+YAML::Node YAML::convert<DP_BACKEND>::encode( const DP_BACKEND &rhs ) {
+    Node node;
+    switch( rhs ) {
+    case DP_BACKEND::VPP:
+        node = "VPP"; break;
+    case DP_BACKEND::FAKE:
+        node = "FAKE"; break;
+    }
+    return node;
+}
+
+bool YAML::convert<DP_BACKEND>::decode( const YAML::Node &node, DP_BACKEND &rhs ) {
+    auto t = node.as<std::string>();
+    if( t == "VPP" ) {
+        rhs = DP_BACKEND::VPP;
+    } else if( t == "FAKE" ) {
+        rhs = DP_BACKEND::FAKE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+YAML::Node YAML::convert<VPPConf>::encode( const VPPConf &rhs ) {
+    Node node;
+    node[ "backend" ] = rhs.backend;
+    if( rhs.fake_latency_us != 0 ) {
+        node[ "fake_latency_us" ] = rhs.fake_latency_us;
+    }
+    node[ "provision_batch" ] = rhs.provision_batch;
+    node[ "provision_window_us" ] = rhs.provision_window_us;
+    return node;
+}
+
+bool YAML::convert<VPPConf>::decode( const YAML::Node &node, VPPConf &rhs ) {
+    if( node[ "backend" ].IsDefined() ) {
+        rhs.backend = node[ "backend" ].as<DP_BACKEND>();
+    }
+    if( node[ "fake_latency_us" ].IsDefined() ) {
+        rhs.fake_latency_us = node[ "fake_latency_us" ].as<uint32_t>();
+    }
+    if( node[ "provision_batch" ].IsDefined() ) {
+        rhs.provision_batch = node[ "provision_batch" ].as<uint32_t>();
+    }
+    if( node[ "provision_window_us" ].IsDefined() ) {
+        rhs.provision_window_us = node[ "provision_window_us" ].as<uint32_t>();
+    }
+    return true;
+}
+
+YAML::Node YAML::convert<AdmissionConf>::encode( const AdmissionConf &rhs ) {
+    Node node;
+    node[ "pado_delay" ] = rhs.pado_delay;
+    node[ "delay_inflight" ] = rhs.delay_inflight;
+    node[ "delay_latency" ] = rhs.delay_latency;
+    node[ "high_water" ] = rhs.high_water;
+    node[ "low_water" ] = rhs.low_water;
+    return node;
+}
+
+bool YAML::convert<AdmissionConf>::decode( const YAML::Node &node, AdmissionConf &rhs ) {
+    if( node[ "pado_delay" ].IsDefined() ) {
+        rhs.pado_delay = node[ "pado_delay" ].as<uint32_t>();
+    }
+    if( node[ "delay_inflight" ].IsDefined() ) {
+        rhs.delay_inflight = node[ "delay_inflight" ].as<uint32_t>();
+    }
+    if( node[ "delay_latency" ].IsDefined() ) {
+        rhs.delay_latency = node[ "delay_latency" ].as<uint32_t>();
+    }
+    if( node[ "high_water" ].IsDefined() ) {
+        rhs.high_water = node[ "high_water" ].as<uint32_t>();
+    }
+    if( node[ "low_water" ].IsDefined() ) {
+        rhs.low_water = node[ "low_water" ].as<uint32_t>();
+    }
     return true;
 }
 
@@ -241,6 +380,11 @@ YAML::Node YAML::convert<AAARadConf>::encode( const AAARadConf &rhs ) {
     node[ "address" ] = rhs.address.to_string();
     node[ "port" ] = rhs.port;
     node[ "secret" ] = rhs.secret;
+    node[ "source_ports" ] = rhs.source_ports;
+    node[ "weight" ] = rhs.weight;
+    node[ "retransmit_interval" ] = rhs.retransmit_interval;
+    node[ "retransmits" ] = rhs.retransmits;
+    node[ "timeout" ] = rhs.timeout;
     return node;
 }
 
@@ -248,6 +392,57 @@ bool YAML::convert<AAARadConf>::decode( const YAML::Node &node, AAARadConf &rhs
     rhs.address = address_v4_t::from_string( node[ "address" ].as<std::string>() );
     rhs.port = node[ "port" ].as<uint16_t>();
     rhs.secret = node[ "secret" ].as<std::string>();
+    if( node[ "source_ports" ].IsDefined() ) {
+        rhs.source_ports = node[ "source_ports" ].as<uint16_t>();
+    }
+    if( node[ "weight" ].IsDefined() ) {
+        rhs.weight = node[ "weight" ].as<uint16_t>();
+    }
+    if( node[ "retransmit_interval" ].IsDefined() ) {
+        rhs.retransmit_interval = node[ "retransmit_interval" ].as<uint32_t>();
+    }
+    if( node[ "retransmits" ].IsDefined() ) {
+        rhs.retransmits = node[ "retransmits" ].as<uint32_t>();
+    }
+    if( node[ "timeout" ].IsDefined() ) {
+        rhs.timeout = node[ "timeout" ].as<uint32_t>();
+    }
+    return true;
+}
+
+YAML::Node YAML::convert<AAACoAClient>::encode( const AAACoAClient &rhs ) {
+    Node node;
+    node[ "address" ] = rhs.address.to_string();
+    node[ "secret" ] = rhs.secret;
+    return node;
+}
+
+bool YAML::convert<AAACoAClient>::decode( const YAML::Node &node, AAACoAClient &rhs ) {
+    rhs.address = address_v4_t::from_string( node[ "address" ].as<std::string>() );
+    rhs.secret = node[ "secret" ].as<std::string>();
+    return true;
+}
+
+YAML::Node YAML::convert<RADIUS_BALANCE>::encode( const RADIUS_BALANCE &rhs ) {
+    Node node;
+    switch( rhs ) {
+    case RADIUS_BALANCE::ROUND_ROBIN:
+        node = "ROUND_ROBIN"; break;
+    case RADIUS_BALANCE::LEAST_OUTSTANDING:
+        node = "LEAST_OUTSTANDING"; break;
+    }
+    return node;
+}
+
+bool YAML::convert<RADIUS_BALANCE>::decode( const YAML::Node &node, RADIUS_BALANCE &rhs ) {
+    auto t = node.as<std::string>();
+    if( t == "ROUND_ROBIN" ) {
+        rhs = RADIUS_BALANCE::ROUND_ROBIN;
+    } else if( t == "LEAST_OUTSTANDING" ) {
+        rhs = RADIUS_BALANCE::LEAST_OUTSTANDING;
+    } else {
+        return false;
+    }
     return true;
 }
 
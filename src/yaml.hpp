@@ -9,6 +9,7 @@ struct FRAMED_POOL;
 enum class AAA_METHODS: uint8_t;
 struct PPPOELocalTemplate;
 struct AAARadConf;
+struct AAACoAClient;
 struct AAAConf;
 struct InterfaceUnit;
 struct InterfaceConf;
@@ -16,6 +17,10 @@ struct PPPOEGlobalConf;
 struct StaticRIB;
 struct StaticRIBEntry;
 struct VRFConf;
+struct VPPConf;
+struct AdmissionConf;
+enum class DP_BACKEND: uint8_t;
+enum class RADIUS_BALANCE: uint8_t;
 enum class LOGL: uint8_t;
 
 namespace YAML {
@@ -61,6 +66,13 @@ namespace YAML {
         static bool decode(const Node &node, AAARadConf &rhs);
     };
 
+    template <>
+    struct convert<AAACoAClient>
+    {
+        static Node encode(const AAACoAClient &rhs);
+        static bool decode(const Node &node, AAACoAClient &rhs);
+    };
+
     template <>
     struct convert<AAAConf>
     {
@@ -110,6 +122,34 @@ namespace YAML {
         static bool decode(const Node &node, VRFConf &rhs);
     };
 
+    template <>
+    struct convert<RADIUS_BALANCE>
+    {
+        static Node encode(const RADIUS_BALANCE &rhs);
+        static bool decode(const Node &node, RADIUS_BALANCE &rhs);
+    };
+
+    template <>
+    struct convert<DP_BACKEND>
+    {
+        static Node encode(const DP_BACKEND &rhs);
+        static bool decode(const Node &node, DP_BACKEND &rhs);
+    };
+
+    template <>
+    struct convert<VPPConf>
+    {
+        static Node encode(const VPPConf &rhs);
+        static bool decode(const Node &node, VPPConf &rhs);
+    };
+
+    template <>
+    struct convert<AdmissionConf>
+    {
+        static Node encode(const AdmissionConf &rhs);
+        static bool decode(const Node &node, AdmissionConf &rhs);
+    };
+
     template <>
     struct convert<LOGL>
     {